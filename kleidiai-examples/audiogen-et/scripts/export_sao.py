@@ -14,6 +14,8 @@ import torch
 from model import (get_dit_module, load_model,
                     get_autoencoder_decoder_module,
                     get_autoencoder_decoder_example_input,
+                    get_autoencoder_encoder_module,
+                    get_autoencoder_encoder_example_input,
                     get_conditioners_module,
                     get_conditioners_example_input,
                     get_dit_example_input_mapping)
@@ -33,10 +35,10 @@ logging.basicConfig(level=logging.INFO)
 
 os.environ["CUDA_VISIBLE_DEVICES"] = ""
 
-def export_conditioners(model, output_path) -> None:
-    logging.info("Starting Conditioners Model conversion...\n")
+def export_conditioners(model, output_path, seq_length=64, file_name="conditioners_model.pte") -> None:
+    logging.info("Starting Conditioners Model conversion (%d tokens)...\n", seq_length)
     conditioners = get_conditioners_module(model=model,dtype=torch.float)
-    conditioners_example_input = get_conditioners_example_input(seq_length=64, seconds_total=10.0, dtype=torch.float)
+    conditioners_example_input = get_conditioners_example_input(seq_length=seq_length, seconds_total=10.0, dtype=torch.float)
 
     # Export the model to ExecuTorch format
     exported_program: ExportedProgram = torch.export.export(conditioners, conditioners_example_input, dynamic_shapes=None)
@@ -46,7 +48,7 @@ def export_conditioners(model, output_path) -> None:
     )
     exec_prog = edge.to_executorch()
 
-    with open(os.path.join(output_path, "conditioners_model.pte"), "wb") as file:
+    with open(os.path.join(output_path, file_name), "wb") as file:
         exec_prog.write_to_file(file)
 
     logging.info("Finished Conditioners Model conversion.\n")
@@ -92,7 +94,7 @@ def export_dit(model, output_path) -> None:
 
     logging.info("Finished Dit Model conversion.\n")
 
-def export_autoencoder(model, output_path) -> None:
+def export_autoencoder(model, output_path, export_encoder=True) -> None:
     # Load the AutoEncoder part of the model
     logging.info("Starting AutoEncoder Decoder conversion...\n")
 
@@ -123,6 +125,27 @@ def export_autoencoder(model, output_path) -> None:
 
     logging.info("Finished AutoEncoder Model conversion.\n")
 
+    if not export_encoder:
+        return
+
+    # The encoder is only needed for style transfer (-i). Like the decoder, it runs in fp16
+    # with fp32 input and output.
+    logging.info("Starting AutoEncoder Encoder conversion...\n")
+    autoencoder_encoder_example_input = get_autoencoder_encoder_example_input(dtype=torch.float)
+    autoencoder_encoder = get_autoencoder_encoder_module(model)
+
+    exported_program: ExportedProgram = torch.export.export(autoencoder_encoder, autoencoder_encoder_example_input, dynamic_shapes=None)
+    edge: EdgeProgramManager = to_edge_transform_and_lower(
+        exported_program,
+        partitioner=[XnnpackPartitioner()],
+    )
+    exec_prog = edge.to_executorch()
+
+    with open(os.path.join(output_path, "autoencoder_encoder_model.pte"), "wb") as file:
+        exec_prog.write_to_file(file)
+
+    logging.info("Finished AutoEncoder Encoder conversion.\n")
+
 def export(args) -> None:
 
     torch.manual_seed(0)
@@ -142,12 +165,15 @@ def export(args) -> None:
 
     # --------- Conditioners Model ---------
     export_conditioners(model, args.output_path)
+    # One more model per token-length bucket, the app runs the shortest one the prompt fits in
+    for seq_length in args.t5_buckets:
+        export_conditioners(model, args.output_path, seq_length, f"conditioners_model_L{seq_length}.pte")
 
     # --------- Dit Model ----------------
     export_dit(model, args.output_path)
 
     # --------- AutoEncoder Model ---------
-    export_autoencoder(model, args.output_path)
+    export_autoencoder(model, args.output_path, export_encoder=not args.no_encoder)
 
 def main():
     parser = argparse.ArgumentParser()
@@ -174,6 +200,21 @@ def main():
         required=False,
     )
 
+    parser.add_argument(
+        "--t5_buckets",
+        type=int,
+        nargs="*",
+        choices=[8, 16, 32],
+        default=[],
+        help="Also export the conditioners for prompts of at most these numbers of tokens.",
+    )
+
+    parser.add_argument(
+        "--no_encoder",
+        action="store_true",
+        help="Do not export the AutoEncoder encoder, which is only needed for style transfer.",
+    )
+
     export(parser.parse_args())
 
 if __name__ == "__main__":
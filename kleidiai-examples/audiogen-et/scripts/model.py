@@ -7,6 +7,7 @@
 import logging
 from typing import Any, Dict, Optional, Tuple
 
+import stable_audio_tools
 import torch
 from einops import rearrange
 
@@ -279,10 +280,18 @@ def get_autoencoder_decoder_module(model):
     """Get the AutoEncoder module from the AudioGen model."""
     return AutoEncoderDecoderModule(model.pretransform)
 
+def get_autoencoder_encoder_module(model):
+    """Get the AutoEncoder encoder module from the AudioGen model."""
+    return AutoEncoderEncoderModule(model.pretransform)
+
 def get_autoencoder_decoder_example_input(dtype=torch.float):
     """Get example input for the AutoEncoder module."""
     return (torch.rand((1, 64, 256), dtype=torch.float),)
 
+def get_autoencoder_encoder_example_input(dtype=torch.float):
+    """Get example input for the AutoEncoder encoder module."""
+    return (torch.rand((1, 2, 524288), dtype=torch.float),)
+
 class AutoEncoderDecoderModule(torch.nn.Module):
     """Wrap the AutoEncoder Module. Takes the AutoEncoder and returns the audio.
     Args:
@@ -307,3 +316,33 @@ class AutoEncoderDecoderModule(torch.nn.Module):
         audio = rearrange(sampled_uncompressed, "b d n -> d (b n)")
         audio = audio.to(torch.float)
         return audio
+
+def vae_sample_mean(mean, scale):
+    # The mean of the posterior instead of a sample of it: the random ops do not lower to XNNPACK,
+    # and the app caches the latent of each input audio, which needs a deterministic encoder
+    return mean, torch.zeros(())
+
+class AutoEncoderEncoderModule(torch.nn.Module):
+    """Wrap the AutoEncoder Module. Takes the stereo audio and returns its latent.
+    Args:
+        autoencoder (torch.nn.Module): The AutoEncoder module.
+    Returns:
+        latent (torch.Tensor): The encoded audio tensor.
+    """
+
+    def __init__(self, autoencoder):
+        super(AutoEncoderEncoderModule, self).__init__()
+        self.autoencoder = autoencoder
+
+        # Use Half
+        self.autoencoder = (
+            self.autoencoder.to(dtype=torch.half).eval().requires_grad_(False)
+        )
+
+        stable_audio_tools.models.bottleneck.vae_sample = vae_sample_mean
+
+    def forward(self, audio: torch.Tensor):
+        audio = audio.to(torch.half)
+        latent = self.autoencoder.encode(audio)
+        latent = latent.to(torch.float)
+        return latent
@@ -0,0 +1,83 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(AUDIOGEN_COUNT_ALLOCATIONS)
+
+static std::atomic<size_t> g_heap_allocation_count{0};
+
+void* operator new(size_t size) {
+    g_heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size != 0 ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace audiogen {
+
+size_t heap_allocation_count() {
+    return g_heap_allocation_count.load(std::memory_order_relaxed);
+}
+
+bool heap_allocation_counting_enabled() {
+    return true;
+}
+
+} // namespace audiogen
+
+#else
+
+namespace audiogen {
+
+size_t heap_allocation_count() {
+    return 0;
+}
+
+bool heap_allocation_counting_enabled() {
+    return false;
+}
+
+} // namespace audiogen
+
+#endif
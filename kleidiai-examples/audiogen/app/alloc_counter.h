@@ -0,0 +1,32 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace audiogen {
+
+// Number of heap allocations (operator new) made by the process so far.
+// They are only counted when the app is built with -DAUDIOGEN_COUNT_ALLOCATIONS=ON,
+// in which case operator new is replaced by a counting version.
+size_t heap_allocation_count();
+
+bool heap_allocation_counting_enabled();
+
+} // namespace audiogen
@@ -0,0 +1,203 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio_io.h"
+#include "common.h"
+#include "metrics.h"
+#include "trace.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace audiogen {
+
+bool try_read_wav(const std::string& path, std::vector<float>& left_ch, std::vector<float>& right_ch, std::string& error) {
+    AUDIOGEN_TRACE("read_wav");
+
+    // You can use this command to convert the file to the expected format:
+    // ffmpeg -i input_audio.mp3 -ar 44100 -ac 2 -c:a pcm_f32le -f wav output.wav
+    const std::string convert_hint =
+        ", use this ffmpeg command to convert your file:\n"
+        "ffmpeg -i input_audio.mp3 -ar 44100 -ac 2 -c:a pcm_f32le -f wav output.wav";
+
+    constexpr uint16_t wave_format_pcm        = 0x0001;
+    constexpr uint16_t wave_format_ieee_float = 0x0003;
+    constexpr uint16_t wave_format_extensible = 0xFFFE;
+
+    std::ifstream input_stream(path, std::ios::binary);
+    if (!input_stream) {
+        error = "Cannot open " + path;
+        return false;
+    }
+
+    char riff[4], wave[4], fmt[4];
+    uint32_t riff_size = 0, fmt_chunk_sz = 0;
+    uint16_t audio_format = 0, audio_num_channels = 0;
+    uint32_t audio_sr = 0, byte_rate = 0, data_chunk_sz = 0;
+    uint16_t block_align = 0, audio_bits_per_sample = 0;
+
+    std::vector<float> data_chunk;
+
+    std::streampos riff_base = input_stream.tellg();
+    input_stream.read(riff, 4);
+    input_stream.read(reinterpret_cast<char*>(&riff_size), 4);
+    input_stream.read(wave, 4);
+    if (!input_stream || riff_size == 0 || std::string(riff, 4) != "RIFF" || std::string(wave, 4) != "WAVE") {
+        error = path + ": BAD file, or unsupported format" + convert_hint;
+        return false;
+    }
+
+    input_stream.read(fmt, 4);
+    input_stream.read(reinterpret_cast<char*>(&fmt_chunk_sz), 4);
+    if (!input_stream || std::string(fmt, 4) != "fmt " || fmt_chunk_sz < 16) {
+        error = path + ": the fmt chunk is missing or invalid";
+        return false;
+    }
+
+    input_stream.read(reinterpret_cast<char*>(&audio_format), 2);
+    input_stream.read(reinterpret_cast<char*>(&audio_num_channels), 2);
+    input_stream.read(reinterpret_cast<char*>(&audio_sr), 4);
+    input_stream.read(reinterpret_cast<char*>(&byte_rate), 4);
+    input_stream.read(reinterpret_cast<char*>(&block_align), 2);
+    input_stream.read(reinterpret_cast<char*>(&audio_bits_per_sample), 2);
+
+    if (!input_stream ||
+        !(audio_format == wave_format_ieee_float || audio_format == wave_format_pcm || audio_format == wave_format_extensible) ||
+        audio_num_channels != k_audio_num_channels ||
+        audio_sr != k_audio_sr ||
+        audio_bits_per_sample != k_bits_per_sample ||
+        block_align != k_audio_num_channels * k_bits_per_sample / 8) {
+        error = path + ": unsupported WAV format (need 44.1kHz, stereo, 32-bit float)" + convert_hint;
+        return false;
+    }
+
+    // Skip any extension bytes in the fmt chunk
+    if (fmt_chunk_sz > 16) {
+        input_stream.seekg(static_cast<std::streamoff>(fmt_chunk_sz - 16), std::ios::cur);
+    }
+
+    // Compute absolute end of this RIFF chunk: 8 (header) + riff_size bytes
+    const std::streampos riff_end = riff_base + static_cast<std::streamoff>(8ull + riff_size);
+
+    // Now we scan for the "data" chunk
+    char chunk_id[4];
+    uint32_t chunk_size = 0;
+    for (;;) {
+        if (!input_stream.read(chunk_id, 4) || !input_stream.read(reinterpret_cast<char*>(&chunk_size), 4)) {
+            error = path + ": no data chunk";
+            return false;
+        }
+
+        if (std::string(chunk_id, 4) == "data") {
+            data_chunk_sz = chunk_size;
+            // Ensure the whole chunk fits in RIFF
+            if (input_stream.tellg() + static_cast<std::streamoff>(data_chunk_sz) > riff_end) {
+                error = path + ": the data chunk overflows the RIFF chunk";
+                return false;
+            }
+            break;
+        }
+        // word-align skip (chunks are padded to even sizes)
+        input_stream.seekg(static_cast<std::streamoff>(chunk_size + (chunk_size & 1)), std::ios::cur);
+    }
+
+    const uint32_t num_frames = data_chunk_sz / block_align;
+    const uint32_t total_samples = num_frames * k_audio_num_channels;
+
+    data_chunk.resize(total_samples);
+    input_stream.read(reinterpret_cast<char*>(data_chunk.data()),
+               static_cast<std::streamsize>(total_samples * sizeof(float)));
+    if (!input_stream) {
+        error = path + ": the file is truncated";
+        return false;
+    }
+
+    // We have the data in interleaved format (L0, R0, L1, R1,....)
+    // We need to unpack the data into two channels, as this is the expected input shape to the encoder
+    left_ch.resize(num_frames);
+    right_ch.resize(num_frames);
+    for(int i = 0; i < num_frames; ++i) {
+        left_ch[i] = data_chunk[i * 2 + 0];
+        right_ch[i] = data_chunk[i * 2 + 1];
+    }
+    return true;
+}
+
+void read_wav(const std::string& path, std::vector<float>& left_ch, std::vector<float>& right_ch) {
+    std::string error;
+    if (!try_read_wav(path, left_ch, right_ch, error)) {
+        fprintf(stderr, "ERROR: %s\n\n", error.c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+void save_as_wav(const std::string& path, const float* left_ch, const float* right_ch, size_t buffer_sz) {
+    AUDIOGEN_TRACE("save_wav");
+
+    constexpr uint16_t audio_format = 3; // IEEE float
+
+    const int32_t byte_rate = k_audio_sr * k_audio_num_channels * (k_bits_per_sample / 8);
+    const int32_t block_align = k_audio_num_channels * (k_bits_per_sample / 8);
+    const int32_t data_chunk_sz = buffer_sz * 2 * sizeof(float);
+    const int32_t fmt_chunk_sz = 16;
+    const int32_t header_sz = 44;
+    const int32_t file_sz = header_sz + data_chunk_sz - 8;
+
+    std::ofstream out_file(path, std::ios::binary);
+
+    // Prepare the header
+    // RIFF header
+    out_file.write("RIFF", 4);
+    out_file.write(reinterpret_cast<const char*>(&file_sz), 4);
+    out_file.write("WAVE", 4);
+    out_file.write("fmt ", 4);
+    out_file.write(reinterpret_cast<const char*>(&fmt_chunk_sz), 4);
+    out_file.write(reinterpret_cast<const char*>(&audio_format), 2);
+    out_file.write(reinterpret_cast<const char*>(&k_audio_num_channels), 2);
+    out_file.write(reinterpret_cast<const char*>(&k_audio_sr), 4);
+    out_file.write(reinterpret_cast<const char*>(&byte_rate), 4);
+    out_file.write(reinterpret_cast<const char*>(&block_align), 2);
+    out_file.write(reinterpret_cast<const char*>(&k_bits_per_sample), 2);
+
+    // Store the data in interleaved format (L0, R0, L1, R1,....)
+    out_file.write("data", 4);
+    out_file.write(reinterpret_cast<const char*>(&data_chunk_sz), 4);
+
+    for (size_t i = 0; i < buffer_sz; ++i) {
+        out_file.write(reinterpret_cast<const char*>(&left_ch[i]), sizeof(float));
+        out_file.write(reinterpret_cast<const char*>(&right_ch[i]), sizeof(float));
+    }
+
+    out_file.close();
+}
+
+static bool ends_with(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void save_audio(const std::string& path, const float* left_ch, const float* right_ch, size_t buffer_sz,
+                const FlacOptions& flac_options) {
+    AUDIOGEN_METRIC_TIMER(MetricStage::AudioWrite);
+    if (ends_with(path, ".flac")) {
+        save_as_flac(path, left_ch, right_ch, buffer_sz, flac_options);
+    } else {
+        save_as_wav(path, left_ch, right_ch, buffer_sz);
+    }
+}
+
+} // namespace audiogen
@@ -0,0 +1,47 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "flac_encoder.h"
+
+namespace audiogen {
+
+constexpr int32_t k_audio_sr = 44100;
+constexpr int32_t k_audio_num_channels = 2;
+constexpr int32_t k_bits_per_sample = 32;
+
+// Read a 44.1kHz stereo 32-bit float WAV file into two planar channels. Exits on an invalid file.
+void read_wav(const std::string& path, std::vector<float>& left_ch, std::vector<float>& right_ch);
+
+// Same, returns false with the reason in error instead of exiting
+bool try_read_wav(const std::string& path, std::vector<float>& left_ch, std::vector<float>& right_ch, std::string& error);
+
+// Write two planar channels into a 44.1kHz stereo 32-bit float WAV file
+void save_as_wav(const std::string& path, const float* left_ch, const float* right_ch, size_t buffer_sz);
+
+// Write a FLAC file if the path ends with ".flac", a 32-bit float WAV file otherwise
+void save_audio(const std::string& path, const float* left_ch, const float* right_ch, size_t buffer_sz,
+                const FlacOptions& flac_options = FlacOptions());
+
+} // namespace audiogen
@@ -16,109 +16,273 @@
  * limitations under the License.
  */
 
-// LiteRT header files
-#include "tensorflow/lite/c/common.h"
-#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
-#include "tensorflow/lite/interpreter.h"
-#include "tensorflow/lite/kernels/register.h"
-#include "tensorflow/lite/model.h"
-#include "tensorflow/lite/tools/gen_op_registration.h"
+#include "alloc_counter.h"
+#include "audio_io.h"
+#include "backend.h"
+#include "common.h"
+#include "latent_io.h"
+#include "memory.h"
+#include "model_registry.h"
+#include "pipeline.h"
+#include "postprocess.h"
+#include "result_cache.h"
+#include "throughput.h"
+#include "metrics.h"
+#include "trace.h"
 
 #include <algorithm>
-#include <cassert>
+#include <atomic>
 #include <cctype>
-#include <chrono>
+#include <cmath>
+#include <csignal>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
-#ifdef _WIN32
-// MSVC does not provide POSIX getopt. Supply a minimal single-char
-// implementation covering exactly the flags used in main().
-static int   optind  = 1;
-static char* optarg  = nullptr;
-static int getopt(int argc, char* const argv[], const char* optstring) {
-    if (optind >= argc || argv[optind] == nullptr || argv[optind][0] != '-')
-        return -1;
-    const char opt = argv[optind][1];
-    const char* p  = strchr(optstring, opt);
-    if (!p) return '?';
-    ++optind;
-    if (*(p + 1) == ':') {
-        if (optind >= argc) return '?';
-        optarg = argv[optind++];
-    }
-    return static_cast<int>(opt);
-}
-#else
-#include <unistd.h>
-#endif
-#include <iterator>
-#include <random>
+#include <functional>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
-#include <sentencepiece_processor.h>
+using namespace audiogen;
 
-constexpr int32_t k_audio_sr = 44100;
-constexpr int32_t k_audio_num_channels = 2;
-constexpr int32_t k_bits_per_sample = 32;
+#if !defined(AUDIOGEN_DEFAULT_BACKEND)
+#if defined(AUDIOGEN_WITH_LITERT)
+#define AUDIOGEN_DEFAULT_BACKEND "litert"
+#else
+#define AUDIOGEN_DEFAULT_BACKEND "executorch"
+#endif
+#endif
 
-constexpr size_t k_seed_default = 99;
-constexpr size_t k_audio_len_sec_default = 10;
-constexpr size_t k_num_steps_default = 8;
+// -- Exit code returned when the generation is cancelled (SIGINT/SIGTERM)
+constexpr int32_t k_exit_cancelled = 2;
 
-// -- Update the tensor index based on your model configuration.
-constexpr size_t k_t5_ids_in_idx = 0;
-constexpr size_t k_t5_attnmask_in_idx = 1;
-constexpr size_t k_t5_audio_len_in_idx = 2;
-constexpr size_t k_t5_crossattn_out_idx = 0;
-constexpr size_t k_t5_globalcond_out_idx = 2;
+// -- Command line options
+struct CliArgs {
+    // Required arguments
+    std::string models_base_path = "";
+    std::string prompt           = "";
+    size_t num_threads           = 0;
+    // Optional arguments
+    std::string backend          = AUDIOGEN_DEFAULT_BACKEND;
+    std::string audio_input_path = "";
+    float input_offset_sec       = 0.0f;
+    std::string encoder_cache_dir = "";
+    std::string result_cache_dir = "";
+    size_t result_cache_size_mb  = 1024;
+    std::string output_file      = "";
+    size_t seed                  = k_seed_default;
+    size_t num_steps             = k_num_steps_default;
+    float audio_len_sec          = static_cast<float>(k_audio_len_sec_default);
+    float sigma_max              = static_cast<float>(k_sigma_max);
+    float convergence_threshold  = 0.0f;
+    long deadline_ms             = 0;
+    bool run_dummy_run           = false;
+    bool verbose                 = false;
+    std::string preview_file     = "";
+    size_t preview_every         = 0;
+    std::string huge_pages       = "off";
+    bool lock_memory             = false;
+    std::string format           = "wav";
+    uint32_t flac_bits           = 16;
+    // Post-processing of the audio, before it is saved
+    PostProcessOptions postprocess;
+    // Throughput mode
+    std::string jobs_file        = "";
+    size_t num_workers           = 1;
+    // Model variants, -m then not needed
+    std::string variants_file    = "";
+    std::string variant          = "";
+    size_t memory_budget_mb      = 0;
+    // Split generation: DiT and autoencoder in different runs
+    std::string save_latent_file = "";
+    std::vector<std::string> decode_latent_files;
+    // Checkpoints of the diffusion, and variations resumed from one of them
+    std::vector<size_t> checkpoint_steps;
+    std::string resume_file      = "";
+    size_t num_variations        = 1;
+    // Machine-readable timings and output checksums, for the performance tests
+    std::string report_json_file = "";
+    // Hot-path tracing
+    std::string trace_file       = "";
+    bool trace_counters          = false;
+    // Inputs and outputs of the DiT steps, for dit_replay
+    std::string dit_capture_file = "";
+    // Live metrics of long-running processes
+    MetricsOptions metrics;
+};
 
-constexpr size_t k_dit_crossattn_in_idx = 2;
-constexpr size_t k_dit_globalcond_in_idx = 1;
-constexpr size_t k_dit_x_in_idx = 3;
-constexpr size_t k_dit_t_in_idx = 0;
-constexpr size_t k_dit_out_idx = 0;
+struct CliOption {
+    const char* short_name;     // e.g. "-m", or nullptr
+    const char* long_name;      // e.g. "--backend", or nullptr
+    const char* value_name;     // nullptr if the option does not take a value
+    std::string help;
+    std::function<void(const char* value)> apply;
+    bool multi_value = false;   // Takes all the following arguments up to the next option
+};
 
-// -- Fill sigmas params
-constexpr float k_logsnr_max = -6.0f;
-constexpr float k_sigma_min = 0.0f;
-constexpr float k_sigma_max = 1.0f;
+static std::vector<CliOption> get_cli_options(CliArgs& args) {
+    return {
+        {"-m", nullptr, "<models_base_path>", "Path to model files",
+            [&](const char* v) { args.models_base_path = v; }},
+        {"-p", nullptr, "<prompt>", "Input prompt text (e.g., warm arpeggios on house beats 120BPM with drums effect)",
+            [&](const char* v) { args.prompt = v; }},
+        {"-t", nullptr, "<num_threads>", "Number of CPU threads to use",
+            [&](const char* v) { args.num_threads = std::stoull(v); }},
+        {"-b", "--backend", "<name>", "(Optional) Runtime used to run the models: litert or executorch (Default: " AUDIOGEN_DEFAULT_BACKEND ")",
+            [&](const char* v) { args.backend = v; }},
+        {"-s", nullptr, "<seed>", "(Optional) Random seed for reproducibility. Different seeds generate different audio samples (Default: " + std::to_string(k_seed_default) + ")",
+            [&](const char* v) { args.seed = std::stoull(v); }},
+        {"-i", nullptr, "<input_audio_path>", "(Optional) Add input audio file for style transfer",
+            [&](const char* v) { args.audio_input_path = v; }},
+        {nullptr, "--input-offset", "<sec>", "(Optional) Start of the part of the input audio used for style transfer (Default: 0)",
+            [&](const char* v) { args.input_offset_sec = std::stof(v); }},
+        {nullptr, "--encoder-cache", "<cache_dir>", "(Optional) Directory caching the encoded input audio, so that a reference track is only encoded once",
+            [&](const char* v) { args.encoder_cache_dir = v; }},
+        {nullptr, "--result-cache", "<cache_dir>", "(Optional) Directory caching the final latent and audio of each generation, keyed by all its inputs, so that an identical request is not run again",
+            [&](const char* v) { args.result_cache_dir = v; }},
+        {nullptr, "--result-cache-size", "<MB>", "(Optional) Size cap of --result-cache, the least recently used results are evicted past it, 0 for none (Default: 1024)",
+            [&](const char* v) { args.result_cache_size_mb = std::stoull(v); }},
+        {"-x", nullptr, "<sigma_max>", "(Optional) Hyper parameter to tweak noise level",
+            [&](const char* v) { args.sigma_max = std::stof(v); }},
+        {"-l", nullptr, "<audio_len_sec>", "(Optional) Length of generated audio (Default: " + std::to_string(k_audio_len_sec_default) + " s)",
+            [&](const char* v) { args.audio_len_sec = static_cast<float>(std::stoull(v)); }},
+        {"-n", nullptr, "<num_steps>", "(Optional) Number of steps (Default: " + std::to_string(k_num_steps_default) + ")",
+            [&](const char* v) { args.num_steps = std::stoull(v); }},
+        {nullptr, "--adaptive", "<threshold>", "(Optional) Skip the remaining steps once the relative change of the denoised latent between two steps is below this threshold, e.g. 0.02 (Default: off)",
+            [&](const char* v) { args.convergence_threshold = std::stof(v); }},
+        {nullptr, "--deadline-ms", "<ms>", "(Optional) Deadline of the generation: the number of steps is reduced to meet it, based on the cost of each stage measured at startup (Default: none)",
+            [&](const char* v) { args.deadline_ms = std::stol(v); }},
+        {"-o", nullptr, "<output_file>", "(Optional) Output audio file name, written as FLAC if it ends with .flac (Default: <prompt>_<seed>.<format>)",
+            [&](const char* v) { args.output_file = v; }},
+        {"-d", nullptr, "<dummy_run>", "(Optional) Run a dummy run to warm up the model (Default: false)",
+            [&](const char* v) { args.run_dummy_run = (std::string(v) == "true"); }},
+        {"-v", nullptr, nullptr, "(Optional) Print the progress and timing of every DiT step",
+            [&](const char*) { args.verbose = true; }},
+        {"-r", nullptr, "<preview_file>", "(Optional) Append a low-resolution envelope of the denoised latent to this file after every DiT step",
+            [&](const char* v) { args.preview_file = v; }},
+        {nullptr, "--preview-every", "<K>", "(Optional) Decode the denoised latent every K DiT steps into <output>.preview.wav, to listen to the clip before the end. Each preview costs one AutoEncoder run",
+            [&](const char* v) { args.preview_every = std::stoull(v); }},
+        {"-j", "--jobs", "<jobs_file>", "(Optional) Throughput mode: generate one clip per prompt of this file (one prompt per line), -p is then not needed",
+            [&](const char* v) { args.jobs_file = v; }},
+        {"-w", "--workers", "<num_workers>", "(Optional) Throughput mode: number of workers, each running <num_threads> threads on its own CPUs (Default: 1)",
+            [&](const char* v) { args.num_workers = std::stoull(v); }},
+        {nullptr, "--variants", "<variants_file>", "(Optional) Model variants, one \"<name> <models_base_path>\" per line. Lines of the jobs file starting with @<name> run on that variant",
+            [&](const char* v) { args.variants_file = v; }},
+        {nullptr, "--variant", "<name>", "(Optional) Variant used by default, instead of -m (Default: the first one of --variants)",
+            [&](const char* v) { args.variant = v; }},
+        {nullptr, "--memory-budget", "<MB>", "(Optional) Throughput mode: memory of the model files each worker keeps loaded, the least recently used variants being unloaded first (Default: no limit)",
+            [&](const char* v) { args.memory_budget_mb = std::stoull(v); }},
+        {nullptr, "--save-latent", "<latent_file>", "(Optional) Save the final latent with the prompt and seed, and skip the autoencoder unless -o is given",
+            [&](const char* v) { args.save_latent_file = v; }},
+        {nullptr, "--decode-latent", "<latent_file>...", "(Optional) Decode-only mode: run the autoencoder on each latent file, -p is then not needed",
+            [&](const char* v) { args.decode_latent_files.push_back(v); }, true},
+        {nullptr, "--checkpoint", "<step>...", "(Optional) Save the latent after each of these steps as <prompt>_<seed>.step<step>.latent, to resume from it later",
+            [&](const char* v) { args.checkpoint_steps.push_back(std::stoull(v)); }, true},
+        {nullptr, "--resume", "<latent_file>", "(Optional) Resume the diffusion from a checkpoint, with the schedule of the checkpoint and the seed (and prompt, if given) of this run",
+            [&](const char* v) { args.resume_file = v; }},
+        {nullptr, "--variations", "<count>", "(Optional) Generate this many clips, with the seeds <seed> to <seed> + <count> - 1 (Default: 1)",
+            [&](const char* v) { args.num_variations = std::stoull(v); }},
+        {nullptr, "--format", "<wav|flac>", "(Optional) Format of the audio files named after the prompt: 32-bit float WAV or lossless FLAC (Default: wav)",
+            [&](const char* v) { args.format = v; }},
+        {nullptr, "--flac-bits", "<16|24>", "(Optional) Bits per sample of the FLAC files (Default: 16)",
+            [&](const char* v) { args.flac_bits = static_cast<uint32_t>(std::stoul(v)); }},
+        {nullptr, "--remove-dc", nullptr, "(Optional) Remove the DC offset of the audio with a 5 Hz high-pass filter",
+            [&](const char*) { args.postprocess.remove_dc = true; }},
+        {nullptr, "--fade-in", "<ms>", "(Optional) Fade the start of the audio in over this duration",
+            [&](const char* v) { args.postprocess.fade_in_ms = std::stof(v); }},
+        {nullptr, "--fade-out", "<ms>", "(Optional) Fade the end of the audio out over this duration",
+            [&](const char* v) { args.postprocess.fade_out_ms = std::stof(v); }},
+        {nullptr, "--loudness", "<lufs>", "(Optional) Normalize the integrated loudness (ITU-R BS.1770) of the audio to this target, e.g. -14",
+            [&](const char* v) { args.postprocess.normalize_loudness = true; args.postprocess.target_lufs = std::stof(v); }},
+        {nullptr, "--true-peak", "<dbtp>", "(Optional) Limit the true peak of the audio to this ceiling, e.g. -1",
+            [&](const char* v) { args.postprocess.limit_true_peak = true; args.postprocess.true_peak_dbtp = std::stof(v); }},
+        {nullptr, "--report-json", "<report_file>", "(Optional) Write the timings of every stage and the checksums of the latent and the audio to this JSON file",
+            [&](const char* v) { args.report_json_file = v; }},
+        {nullptr, "--trace", "<trace_file>", "(Optional) Record nanosecond spans of the hot path and write them as a Chrome trace (chrome://tracing, Perfetto)",
+            [&](const char* v) { args.trace_file = v; }},
+        {nullptr, "--trace-counters", nullptr, "(Optional) Add the cycles, instructions and cache misses of the process to every span of --trace (Linux only)",
+            [&](const char*) { args.trace_counters = true; }},
+        {nullptr, "--capture-dit", "<capture_file>", "(Optional) Write the inputs and the output of the DiT at every step to this file, to benchmark the DiT alone with audiogen_dit_replay",
+            [&](const char* v) { args.dit_capture_file = v; }},
+        {nullptr, "--metrics-port", "<port>", "(Optional) Serve the latency histograms, counters and gauges in the Prometheus text format on http://127.0.0.1:<port>/metrics, 0 to disable (Default: 0)",
+            [&](const char* v) { args.metrics.port = std::stoi(v); }},
+        {nullptr, "--metrics-file", "<metrics_file>", "(Optional) Rewrite this file with the metrics periodically, and once more at exit",
+            [&](const char* v) { args.metrics.file = v; }},
+        {nullptr, "--metrics-interval", "<ms>", "(Optional) Period of the --metrics-file updates (Default: 5000)",
+            [&](const char* v) { args.metrics.interval_ms = std::stol(v); }},
+        {nullptr, "--huge-pages", "<off|thp|explicit>", "(Optional) Back the model weights and the activation arenas with transparent or explicit huge pages (Linux only, Default: off)",
+            [&](const char* v) { args.huge_pages = v; }},
+        {nullptr, "--mlock", nullptr, "(Optional) Lock the model weights and the activation arenas in memory (Linux only)",
+            [&](const char*) { args.lock_memory = true; }},
+    };
+}
 
-#define AUDIOGEN_CHECK(x)                                 \
-    if (!(x)) {                                                 \
-        fprintf(stderr, "Error at %s:%d\n", __FILE__, __LINE__);\
-        exit(1);                                                \
+static std::string get_option_names(const CliOption& option) {
+    std::string names;
+    if (option.short_name != nullptr) {
+        names = option.short_name;
     }
-
-static inline long time_in_ms() {
-    using namespace std::chrono;
-    auto now = time_point_cast<milliseconds>(steady_clock::now());
-    return now.time_since_epoch().count();
+    if (option.long_name != nullptr) {
+        names += names.empty() ? option.long_name : std::string(", ") + option.long_name;
+    }
+    if (option.value_name != nullptr) {
+        names += std::string(" ") + option.value_name;
+    }
+    return names;
 }
 
-static void print_usage(const char *name) {
+static void print_usage(const char *name, const std::vector<CliOption>& options) {
     fprintf(stderr,
         "Usage: %s -m <models_base_path> -p <prompt> -t <num_threads> [-s <seed> -l <audio_len>]\n\n"
-        "Options:\n"
-        "  -m <models_base_path>   Path to model files\n"
-        "  -p <prompt>             Input prompt text (e.g., warm arpeggios on house beats 120BPM with drums effect)\n"
-        "  -t <num_threads>        Number of CPU threads to use\n"
-        "  -s <seed>               (Optional) Random seed for reproducibility. Different seeds generate different audio samples (Default: %zu)\n"
-        "  -i <input_audio_path>   (Optional) Add input audio file for style transfer"
-        "  -x <sigma_max>          (Optional) Hyper parameter to tweak noise level"
-        "  -l <audio_len_sec>      (Optional) Length of generated audio (Default: %zu s)\n"
-        "  -n <num_steps>          (Optional) Number of steps (Default: %zu)\n"
-        "  -o <output_file>        (Optional) Output audio file name (Default: <prompt>_<seed>.wav)\n"
-        "  -h                      Show this help message\n",
-        name,
-        k_seed_default,
-        k_audio_len_sec_default,
-        k_num_steps_default);
+        "Options:\n",
+        name);
+
+    size_t names_width = 0;
+    for (const auto& option : options) {
+        names_width = std::max(names_width, get_option_names(option).size());
+    }
+    for (const auto& option : options) {
+        fprintf(stderr, "  %-*s   %s\n", static_cast<int>(names_width), get_option_names(option).c_str(), option.help.c_str());
+    }
+    fprintf(stderr, "  %-*s   %s\n", static_cast<int>(names_width), "-h", "Show this help message");
+}
+
+// Returns false on -h or on an unknown or incomplete option
+static bool parse_args(int32_t argc, char** argv, const std::vector<CliOption>& options) {
+    for (int32_t i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+
+        auto it = std::find_if(options.begin(), options.end(), [arg](const CliOption& option) {
+            return (option.short_name != nullptr && strcmp(arg, option.short_name) == 0) ||
+                   (option.long_name != nullptr && strcmp(arg, option.long_name) == 0);
+        });
+        if (it == options.end()) {
+            return false;
+        }
+
+        if (it->multi_value) {
+            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+                return false;
+            }
+            while (i + 1 < argc && argv[i + 1][0] != '-') {
+                it->apply(argv[++i]);
+            }
+            continue;
+        }
+
+        const char* value = nullptr;
+        if (it->value_name != nullptr) {
+            if (i + 1 >= argc) {
+                return false;
+            }
+            value = argv[++i];
+        }
+        it->apply(value);
+    }
+    return true;
 }
 
-static std::string get_filename(std::string prompt, size_t seed) {
+static std::string get_filename(std::string prompt, size_t seed, const std::string& format) {
     // Convert spaces to underscores
     std::replace(prompt.begin(), prompt.end(), ' ', '_');
 
@@ -126,596 +290,771 @@ static std::string get_filename(std::string prompt, size_t seed) {
     std::transform(prompt.begin(), prompt.end(), prompt.begin(),
                    [](unsigned char c) { return std::tolower(c); });
 
-    return prompt + "_" + std::to_string(seed) + ".wav";
+    return prompt + "_" + std::to_string(seed) + "." + format;
 }
 
-static std::vector<int32_t> convert_prompt_to_ids(const std::string& prompt, const std::string& spiece_model_path) {
-    sentencepiece::SentencePieceProcessor sp;
-
-    AUDIOGEN_CHECK(sp.Load(spiece_model_path.c_str()).ok());
-
-    std::vector<std::string> pieces;
-    std::vector<int32_t> ids;
+// -- Progress reporting and cancellation
+static std::atomic<bool> g_cancel_requested{false};
 
-    sp.Encode(prompt, &pieces);  // Token strings
-    sp.Encode(prompt, &ids);     // Token IDs
-
-    // Make sure we have 1 at the end
-    if(ids[ids.size() - 1] != 1) {
-        ids.push_back(1);
+// The request is only checked at some points (between the DiT steps, the jobs, the files), so a
+// second signal ends the process right away, e.g. while the models load
+static void on_cancel_signal(int32_t signal_number) {
+    if (g_cancel_requested.exchange(true)) {
+        std::signal(signal_number, SIG_DFL);
+        std::raise(signal_number);
     }
-    return ids;
 }
 
-struct TfLiteDelegateDeleter {
-    void operator()(TfLiteDelegate* delegate) const {
-        TfLiteXNNPackDelegateDelete(delegate);
+static void print_step_progress(const StepProgress& progress) {
+    fprintf(stderr, "Step %zu/%zu: t=%.4f -> %.4f, %ld ms (elapsed %ld ms)",
+        progress.step, progress.num_steps, progress.curr_t, progress.next_t,
+        progress.step_ms, progress.elapsed_ms);
+    if (progress.change >= 0.0f) {
+        fprintf(stderr, ", change %.5f", progress.change);
     }
-};
+    fprintf(stderr, "\n");
+}
 
-static size_t get_num_elems(const TfLiteIntArray* dims) {
-    size_t x = 1;
-    for (size_t i = 0; i < dims->size; ++i) {
-        x *= dims->data[i];
+// Cheap preview of a latent with shape [1, channels, frames]: the RMS over the channels of
+// every latent frame. Each frame covers ~46 ms of audio, which is enough for a UI to show
+// the loudness contour of the clip while the diffusion is still running.
+static void write_latent_preview(std::ofstream& out, size_t step, const float* latent, size_t num_channels, size_t num_frames) {
+    out << step;
+    for (size_t f = 0; f < num_frames; ++f) {
+        float sum_sq = 0.0f;
+        for (size_t c = 0; c < num_channels; ++c) {
+            const float v = latent[c * num_frames + f];
+            sum_sq += v * v;
+        }
+        out << ' ' << std::sqrt(sum_sq / static_cast<float>(num_channels));
     }
-    return x;
+    out << '\n';
+    out.flush();
 }
 
-static void read_wav(const std::string& path, std::vector<float>& left_ch, std::vector<float>& right_ch) {
-    // You can use this command to convert the file to the expected format:
-    // ffmpeg -i input_audio.mp3 -ar 44100 -ac 2 -c:a pcm_f32le -f wav output.wav
-
-    constexpr uint16_t wave_format_pcm        = 0x0001;
-    constexpr uint16_t wave_format_ieee_float = 0x0003;
-    constexpr uint16_t wave_format_extensible = 0xFFFE;
-
-    std::ifstream input_stream(path, std::ios::binary);
-
-    AUDIOGEN_CHECK(input_stream);
-
-    char riff[4], wave[4], fmt[4];
-    uint32_t riff_size, fmt_chunk_sz;
-    uint16_t audio_format, audio_num_channels;
-    uint32_t audio_sr, byte_rate, data_chunk_sz;
-    uint16_t block_align, audio_bits_per_sample;
-
-    std::vector<float> data_chunk;
-
-    std::streampos riff_base = input_stream.tellg();
-    input_stream.read(riff, 4);
-    input_stream.read(reinterpret_cast<char*>(&riff_size), 4);
-    AUDIOGEN_CHECK(bool(riff_size));
-    input_stream.read(wave, 4);
-    if(std::string(riff, 4) != "RIFF" || std::string(wave, 4) != "WAVE") {
-        fprintf(stderr,
-            "BAD file, or unsupported format, use this ffmpeg command to convert your file:\n"
-            "ffmpeg -i input_audio.mp3 -ar 44100 -ac 2 -c:a pcm_f32le -f wav output.wav\n\n");
-        exit(EXIT_FAILURE);
-    }
-
-    input_stream.read(fmt, 4);
-    AUDIOGEN_CHECK(std::string(fmt, 4) == "fmt ");
-    input_stream.read(reinterpret_cast<char*>(&fmt_chunk_sz), 4);
-    AUDIOGEN_CHECK(fmt_chunk_sz >= 16);
-
-    input_stream.read(reinterpret_cast<char*>(&audio_format), 2);
-    input_stream.read(reinterpret_cast<char*>(&audio_num_channels), 2);
-    input_stream.read(reinterpret_cast<char*>(&audio_sr), 4);
-    input_stream.read(reinterpret_cast<char*>(&byte_rate), 4);
-    input_stream.read(reinterpret_cast<char*>(&block_align), 2);
-    input_stream.read(reinterpret_cast<char*>(&audio_bits_per_sample), 2);
-
-    if (!(audio_format == wave_format_ieee_float || audio_format == wave_format_pcm || audio_format == wave_format_extensible) ||
-        audio_num_channels != k_audio_num_channels ||
-        audio_sr != k_audio_sr ||
-        audio_bits_per_sample != k_bits_per_sample) {
-        fprintf(stderr,
-        "Unsupported WAV format (need 44.1kHz, stereo, 32-bit float), use this ffmpeg command to convert your file:\n"
-        "ffmpeg -i input_audio.mp3 -ar 44100 -ac 2 -c:a pcm_f32le -f wav output.wav\n\n");
-        exit(EXIT_FAILURE);
-    }
-
-    // Skip any extension bytes in the fmt chunk
-    if (fmt_chunk_sz > 16) {
-        input_stream.seekg(static_cast<std::streamoff>(fmt_chunk_sz - 16), std::ios::cur);
-        AUDIOGEN_CHECK(bool(input_stream));
-    }
-
-    // Compute absolute end of this RIFF chunk: 8 (header) + riff_size bytes
-    const std::streampos riff_end = riff_base + static_cast<std::streamoff>(8ull + riff_size);
-
-    // Now we scan for the "data" chunk
-    char chunk_id[4];
-    uint32_t chunk_size = 0;
-    for (;;) {
-        std::streampos here = input_stream.tellg();
-        AUDIOGEN_CHECK(here != std::streampos(-1));
-
-        AUDIOGEN_CHECK(input_stream.read(chunk_id, 4));
-        AUDIOGEN_CHECK(input_stream.read(reinterpret_cast<char*>(&chunk_size), 4));
-
-        if (std::string(chunk_id, 4) == "data") {
-            data_chunk_sz = chunk_size;
-            // Ensure the whole chunk fits in RIFF
-            AUDIOGEN_CHECK(input_stream.tellg() + static_cast<std::streamoff>(data_chunk_sz) <= riff_end);
-            break;
-        }
-        // word-align skip (chunks are padded to even sizes)
-        input_stream.seekg(static_cast<std::streamoff>(chunk_size + (chunk_size & 1)), std::ios::cur);
-        AUDIOGEN_CHECK(bool(input_stream));
-    }
-
-    const uint32_t num_frames = data_chunk_sz / block_align;
-    const uint32_t total_samples = num_frames * k_audio_num_channels;
-
-    data_chunk.resize(total_samples);
-    input_stream.read(reinterpret_cast<char*>(data_chunk.data()),
-               static_cast<std::streamsize>(data_chunk_sz));
-
-    // We have the data in interleaved format (L0, R0, L1, R1,....)
-    // We need to unpack the data into two channels, as this is the expected input shape to the encoder
-    left_ch.resize(num_frames);
-    right_ch.resize(num_frames);
-    for(int i = 0; i < num_frames; ++i) {
-        left_ch[i] = data_chunk[i * 2 + 0];
-        right_ch[i] = data_chunk[i * 2 + 1];
-    }
+static void print_memory_report(const MemoryReport& report) {
+    constexpr double k_mb = 1024.0 * 1024.0;
+    fprintf(stderr, "Memory: %.1f MB resident, %.1f MB on transparent huge pages, %.1f MB on explicit huge pages, %.1f MB locked\n",
+        report.rss_bytes / k_mb, report.anon_huge_pages_bytes / k_mb, report.hugetlb_bytes / k_mb, report.locked_bytes / k_mb);
 }
 
-static void prepare_encoder_input(const std::vector<float>& left_ch, const std::vector<float>& right_ch, float* packed, const size_t audio_input_dim0) {
+// One bar per model over the load time, to show how the loading of the models overlapped
+static void print_load_timeline(const std::vector<LoadEvent>& timeline) {
+    constexpr size_t k_bar_width = 40;
 
-    AUDIOGEN_CHECK(left_ch.size() == right_ch.size());
-    const int32_t num_frames = audio_input_dim0 / 2;
+    long total_ms = 1;
+    size_t name_width = 0;
+    for (const auto& event : timeline) {
+        total_ms = std::max(total_ms, event.end_ms);
+        name_width = std::max(name_width, event.name.size());
+    }
 
-    for(int i = 0; i < num_frames; ++i) {
-        packed[i]            = left_ch[i];
-        packed[num_frames+i] = right_ch[i];
+    fprintf(stderr, "Startup timeline (%ld ms):\n", total_ms);
+    for (const auto& event : timeline) {
+        const size_t bar_begin = std::min(k_bar_width - 1, static_cast<size_t>(event.start_ms) * k_bar_width / total_ms);
+        const size_t bar_end = std::max(bar_begin + 1, static_cast<size_t>(event.end_ms) * k_bar_width / total_ms);
+
+        std::string bar(k_bar_width, ' ');
+        std::fill(bar.begin() + bar_begin, bar.begin() + std::min(bar_end, k_bar_width), '#');
+        fprintf(stderr, "  %-*s |%s| %5ld -> %5ld ms\n", static_cast<int32_t>(name_width), event.name.c_str(),
+            bar.c_str(), event.start_ms, event.end_ms);
     }
 }
 
-static void encode_audio(const std::string& audio_input_path, const std::string& encoder_model_path, std::vector<float>& encoded_audio, size_t num_threads) {
+// -- Tracing, started once the models are loaded, so that the counters cover the threads of the delegates
+static void start_tracing(const CliArgs& args) {
+    if (!args.trace_file.empty()) {
+        trace_start(args.trace_counters);
+    }
+}
 
-    std::vector<float> packed;
-    std::vector<float> left_ch_input;
-    std::vector<float> right_ch_input;
+static void finish_tracing(const CliArgs& args) {
+    if (!args.trace_file.empty()) {
+        trace_print_summary();
+        if (trace_write_json(args.trace_file)) {
+            fprintf(stderr, "Trace written to %s\n", args.trace_file.c_str());
+        }
+    }
+}
 
-    // Read input audio file
-    read_wav(audio_input_path, left_ch_input, right_ch_input);
-    fprintf(stderr, "Using %s as an audio input file...\n", audio_input_path.c_str());
+// -- Report for the performance tests (see perf/run_perf.py)
+constexpr size_t k_num_fingerprint_segments = 32;
+
+static std::string json_escape(const std::string& str) {
+    std::string escaped;
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            escaped += buffer;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
 
-    // Create the XNNPACK delegate options
-    TfLiteXNNPackDelegateOptions xnnpack_options = TfLiteXNNPackDelegateOptionsDefault();
-    xnnpack_options.num_threads = num_threads;
+// FNV-1a over the bytes of the latent: any change of the numerics, even in the last bit, changes it
+static uint64_t latent_checksum(const float* data, size_t num_elems) {
+    return hash_bytes(data, num_elems * sizeof(float));
+}
 
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_QS8;
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_QU8;
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_DYNAMIC_FULLY_CONNECTED;
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_ENABLE_SUBGRAPH_RESHAPING;
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_ENABLE_LATEST_OPERATORS;
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_VARIABLE_OPERATORS;
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_FORCE_FP16;
-    std::unique_ptr<TfLiteDelegate, TfLiteDelegateDeleter> xnnpack_delegate_fp16(TfLiteXNNPackDelegateCreate(&xnnpack_options));
+static void write_report_json(const CliArgs& args, const std::vector<LoadEvent>& timeline, const GenerationResult& result,
+                              const TensorView& latent) {
+    std::ofstream out(args.report_json_file);
+    AUDIOGEN_CHECK(out.is_open());
 
-    // Allocate the encoder in case of an input file
-    std::unique_ptr<tflite::FlatBufferModel> autoencoder_encoder_model = tflite::FlatBufferModel::BuildFromFile(encoder_model_path.c_str());
-    AUDIOGEN_CHECK(autoencoder_encoder_model != nullptr);
+    long load_ms = 0;
+    for (const auto& event : timeline) {
+        load_ms = std::max(load_ms, event.end_ms);
+    }
 
-    // Build the encoder interperter
-    tflite::ops::builtin::BuiltinOpResolver resolver;
-    tflite::InterpreterBuilder autoencoder_encoder_builder(*autoencoder_encoder_model, resolver);
+    char checksum[32];
+    snprintf(checksum, sizeof(checksum), "%016llx", static_cast<unsigned long long>(latent_checksum(latent.as<float>(), latent.num_elems())));
+
+    out << "{\n";
+    out << "  \"backend\": \"" << json_escape(args.backend) << "\",\n";
+    out << "  \"prompt\": \"" << json_escape(args.prompt) << "\",\n";
+    out << "  \"seed\": " << args.seed << ",\n";
+    out << "  \"num_steps\": " << args.num_steps << ",\n";
+    out << "  \"num_steps_run\": " << result.num_steps_run << ",\n";
+    out << "  \"num_steps_skipped\": " << result.num_steps_skipped << ",\n";
+    if (args.sigma_max < k_sigma_max) {
+        out << "  \"sigma_max\": " << args.sigma_max << ",\n";
+        out << "  \"first_step\": " << result.first_step << ",\n";
+    }
+    if (args.deadline_ms > 0) {
+        out << "  \"deadline_ms\": " << args.deadline_ms << ",\n";
+        out << "  \"num_steps_planned\": " << result.num_steps_planned << ",\n";
+        out << "  \"deadline_cut\": " << (result.deadline_cut ? "true" : "false") << ",\n";
+    }
+    out << "  \"audio_len_sec\": " << args.audio_len_sec << ",\n";
+    out << "  \"num_threads\": " << args.num_threads << ",\n";
+    out << "  \"load_ms\": " << load_ms << ",\n";
+    out << "  \"t5_ms\": " << result.t5_ms << ",\n";
+    out << "  \"t5_seq_len\": " << result.t5_seq_len << ",\n";
+    if (!args.result_cache_dir.empty()) {
+        out << "  \"cache_hit\": " << (result.cache_hit ? "true" : "false") << ",\n";
+    }
+    out << "  \"dit_ms\": " << result.dit_ms << ",\n";
+    out << "  \"autoencoder_ms\": " << result.autoencoder_ms << ",\n";
+    out << "  \"latent_checksum\": \"" << checksum << "\"";
+
+    if (args.convergence_threshold > 0.0f) {
+        out << ",\n  \"convergence_trace\": [";
+        for (size_t i = 0; i < result.convergence_trace.size(); ++i) {
+            out << (i == 0 ? "" : ", ") << result.convergence_trace[i];
+        }
+        out << "]";
+    }
 
-    std::unique_ptr<tflite::Interpreter> autoencoder_encoder_interpreter = std::make_unique<tflite::Interpreter>();
-    autoencoder_encoder_builder(&autoencoder_encoder_interpreter);
-    AUDIOGEN_CHECK(autoencoder_encoder_interpreter != nullptr);
+    // RMS of the mono mix over equal segments of the clip, to bound the error of the audio when
+    // the latent differs in the last bits (e.g. another compiler or another kernel)
+    if (result.num_samples >= k_num_fingerprint_segments) {
+        const size_t segment_len = result.num_samples / k_num_fingerprint_segments;
+        out << ",\n  \"audio_fingerprint\": [";
+        for (size_t s = 0; s < k_num_fingerprint_segments; ++s) {
+            double sum_sq = 0.0;
+            for (size_t i = s * segment_len; i < (s + 1) * segment_len; ++i) {
+                const double mono = 0.5 * (result.left_ch[i] + result.right_ch[i]);
+                sum_sq += mono * mono;
+            }
+            out << (s == 0 ? "" : ", ") << std::sqrt(sum_sq / segment_len);
+        }
+        out << "]";
+    }
+    out << "\n}\n";
+}
 
-    // Add the delegate to the interpreter
-    if (autoencoder_encoder_interpreter->ModifyGraphWithDelegate(xnnpack_delegate_fp16.get()) != kTfLiteOk) {
-        AUDIOGEN_CHECK(false && "Failed to apply XNNPACK delegate");
+// -- Throughput mode: one clip per line of the jobs file, spread over several workers
+static int32_t run_throughput_mode(const CliArgs& args, const std::vector<ModelVariant>& variants, const GenerationParams& params,
+                                   const MemoryOptions& memory_options, const FlacOptions& flac_options, ResultCache* result_cache) {
+    std::ifstream jobs_file(args.jobs_file);
+    if (!jobs_file.is_open()) {
+        fprintf(stderr, "ERROR: Cannot open the jobs file %s\n", args.jobs_file.c_str());
+        return EXIT_FAILURE;
     }
 
-    // Allocate tensors
-    AUDIOGEN_CHECK(autoencoder_encoder_interpreter->AllocateTensors() == kTfLiteOk);
+    // One prompt per line, optionally followed by a tab and the input audio for style transfer
+    // (-i otherwise), and optionally starting with @<variant> and a space. Empty lines and lines
+    // starting with # are skipped.
+    std::vector<Job> jobs;
+    std::string line;
+    while (std::getline(jobs_file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        Job job;
+        job.params = params;
+        job.audio_input_path = args.audio_input_path;
+        job.variant = args.variant;
+
+        if (line[0] == '@') {
+            const size_t space = line.find(' ');
+            job.variant = line.substr(1, space == std::string::npos ? std::string::npos : space - 1);
+            line = space == std::string::npos ? "" : line.substr(space + 1);
+            if (std::none_of(variants.begin(), variants.end(), [&](const ModelVariant& v) { return v.name == job.variant; })) {
+                fprintf(stderr, "ERROR: Unknown variant @%s in the jobs file\n", job.variant.c_str());
+                return EXIT_FAILURE;
+            }
+        }
 
-    // Get the input & output tensors dimensions
-    const size_t autoencoder_encoder_in_id = autoencoder_encoder_interpreter->inputs()[0];
-    const size_t autoencoder_encoder_out_id = autoencoder_encoder_interpreter->outputs()[0];
+        const size_t tab = line.find('\t');
+        if (tab != std::string::npos) {
+            job.audio_input_path = line.substr(tab + 1);
+            line.resize(tab);
+        }
+        job.params.prompt = line;
+        job.output_file = std::to_string(jobs.size()) + "_" + get_filename(line, params.seed, args.format);
+        jobs.push_back(job);
+    }
 
-    // Get the tensors pointers
-    float* autoencoder_encoder_in_data = autoencoder_encoder_interpreter->typed_tensor<float>(autoencoder_encoder_in_id);
-    float* autoencoder_encoder_out_data = autoencoder_encoder_interpreter->typed_tensor<float>(autoencoder_encoder_out_id);
+    WorkerOptions worker_options;
+    worker_options.backend                = args.backend;
+    worker_options.variants               = variants;
+    worker_options.memory_budget          = args.memory_budget_mb * 1024 * 1024;
+    worker_options.num_workers            = args.num_workers;
+    worker_options.num_threads_per_worker = args.num_threads;
+    worker_options.memory_options         = memory_options;
+    worker_options.warmup                 = args.run_dummy_run;
+    worker_options.calibrate              = args.deadline_ms > 0;
+    worker_options.flac_options           = flac_options;
+    worker_options.encoder_cache_dir      = args.encoder_cache_dir;
+    worker_options.result_cache           = result_cache;
+    worker_options.postprocess_options    = args.postprocess;
+
+    // The workers create their thread pools after this point, so only the spans are recorded
+    if (!args.trace_file.empty()) {
+        if (args.trace_counters) {
+            fprintf(stderr, "Warning: --trace-counters is ignored in throughput mode\n");
+        }
+        trace_start(false);
+    }
 
-    // Get tensor shapes
-    TfLiteIntArray* autoencoder_encoder_in_dims = autoencoder_encoder_interpreter->tensor(autoencoder_encoder_in_id)->dims;
-    TfLiteIntArray* autoencoder_encoder_out_dims = autoencoder_encoder_interpreter->tensor(autoencoder_encoder_out_id)->dims;
+    const ThroughputStats stats = run_workers(worker_options, jobs, &g_cancel_requested);
+    finish_tracing(args);
 
-    // Get the input model size
-    const size_t audio_input_dim0 = get_num_elems(autoencoder_encoder_in_dims);
+    const float wall_sec = std::max(stats.wall_ms, 1L) / 1000.0f;
+    printf("Jobs: %zu/%zu\n", stats.num_jobs_done, jobs.size());
+    printf("Wall time: %ld ms\n", stats.wall_ms);
+    printf("Clips per hour: %.1f\n", stats.num_jobs_done * 3600.0f / wall_sec);
+    printf("Audio generated per second: %.2f s\n", stats.audio_sec / wall_sec);
 
-    // Divided by 2 because we have two channels
-    AUDIOGEN_CHECK(left_ch_input.size() <= audio_input_dim0 / 2);
-    AUDIOGEN_CHECK(right_ch_input.size() <= audio_input_dim0 / 2);
+    return g_cancel_requested ? k_exit_cancelled : 0;
+}
 
-    // Resize if needed and fill with zero the newly added values
-    left_ch_input.resize(audio_input_dim0 / 2, 0);
-    right_ch_input.resize(audio_input_dim0 / 2, 0);
+// -- Decode-only mode: one autoencoder, loaded once, for all the latent files
+static int32_t run_decode_mode(const CliArgs& args, const MemoryOptions& memory_options, const FlacOptions& flac_options) {
+    std::unique_ptr<Backend> backend = create_backend(args.backend, args.num_threads);
+    AUDIOGEN_CHECK(backend != nullptr);
+    backend->set_memory_options(memory_options);
 
-    // Pack the data
-    prepare_encoder_input(left_ch_input, right_ch_input, autoencoder_encoder_in_data, audio_input_dim0);
+    Pipeline pipeline(*backend, args.models_base_path);
+    pipeline.load_decoder();
+    if (g_cancel_requested) {
+        return k_exit_cancelled;
+    }
+    start_tracing(args);
 
-    // Run the encoder
-    auto start_encoder = time_in_ms();
-    AUDIOGEN_CHECK(autoencoder_encoder_interpreter->Invoke() == kTfLiteOk);
-    auto end_encoder = time_in_ms();
+    const size_t decoder_num_elems = pipeline.decoder_input().num_elems();
 
-    // Copy the output to the output buffer
-    const size_t encoder_output_num_elems = get_num_elems(autoencoder_encoder_out_dims);
-    encoded_audio.resize(encoder_output_num_elems);
-    memcpy(encoded_audio.data(), autoencoder_encoder_out_data, encoder_output_num_elems * sizeof(float));
+    size_t num_failed = 0;
+    for (const auto& latent_file_path : args.decode_latent_files) {
+        if (g_cancel_requested) {
+            return k_exit_cancelled;
+        }
 
-    auto encoder_exec_time = (end_encoder - start_encoder);
-    fprintf(stderr, "Encoder time: %ld ms\n", encoder_exec_time);
-}
+        const std::unique_ptr<LatentFile> latent_file = LatentFile::open(latent_file_path);
+        if (latent_file == nullptr) {
+            num_failed++;
+            continue;
+        }
+        const LatentInfo& info = latent_file->info();
+        // e.g. a latent of another model variant, the other files of the batch are still decoded
+        if (info.num_elems() != decoder_num_elems) {
+            fprintf(stderr, "Warning: %s has %zu elements, the AutoEncoder takes %zu, skipped\n",
+                latent_file_path.c_str(), info.num_elems(), decoder_num_elems);
+            num_failed++;
+            continue;
+        }
+        if (info.step < info.num_steps) {
+            fprintf(stderr, "Warning: %s is a checkpoint (step %u of %u), the audio will be noisy\n",
+                latent_file_path.c_str(), info.step, info.num_steps);
+        }
 
-static void save_as_wav(const std::string& path, const float* left_ch, const float* right_ch, size_t buffer_sz) {
+        // -o only makes sense with a single latent, the other clips are named as usual
+        std::string output_file = get_filename(info.prompt, info.seed, args.format);
+        if (!args.output_file.empty() && args.decode_latent_files.size() == 1) {
+            output_file = args.output_file;
+        }
 
-    constexpr uint16_t audio_format = 3; // IEEE float
+        const GenerationResult result = pipeline.decode(latent_file->data(), info.num_elems());
+        if (args.postprocess.enabled()) {
+            postprocess(result.left_ch, result.right_ch, result.num_samples, k_audio_sr, args.postprocess);
+        }
+        save_audio(output_file, result.left_ch, result.right_ch, result.num_samples, flac_options);
 
-    const int32_t byte_rate = k_audio_sr * k_audio_num_channels * (k_bits_per_sample / 8);
-    const int32_t block_align = k_audio_num_channels * (k_bits_per_sample / 8);
-    const int32_t data_chunk_sz = buffer_sz * 2 * sizeof(float);
-    const int32_t fmt_chunk_sz = 16;
-    const int32_t header_sz = 44;
-    const int32_t file_sz = header_sz + data_chunk_sz - 8;
+        printf("%s -> %s (\"%s\", seed %llu): %ld ms\n", latent_file_path.c_str(), output_file.c_str(),
+            info.prompt.c_str(), static_cast<unsigned long long>(info.seed), result.autoencoder_ms);
+    }
 
-    std::ofstream out_file(path, std::ios::binary);
+    finish_tracing(args);
+    return num_failed == 0 ? 0 : EXIT_FAILURE;
+}
 
-    // Prepare the header
-    // RIFF header
-    out_file.write("RIFF", 4);
-    out_file.write(reinterpret_cast<const char*>(&file_sz), 4);
-    out_file.write("WAVE", 4);
-    out_file.write("fmt ", 4);
-    out_file.write(reinterpret_cast<const char*>(&fmt_chunk_sz), 4);
-    out_file.write(reinterpret_cast<const char*>(&audio_format), 2);
-    out_file.write(reinterpret_cast<const char*>(&k_audio_num_channels), 2);
-    out_file.write(reinterpret_cast<const char*>(&k_audio_sr), 4);
-    out_file.write(reinterpret_cast<const char*>(&byte_rate), 4);
-    out_file.write(reinterpret_cast<const char*>(&block_align), 2);
-    out_file.write(reinterpret_cast<const char*>(&k_bits_per_sample), 2);
+// -- Deadline control: what was decided to meet the deadline, and whether it was met
+static void print_deadline_report(const CliArgs& args, const GenerationResult& result) {
+    const long total_ms = result.t5_ms + result.dit_ms + result.autoencoder_ms;
+    printf("Deadline: %ld ms, %s (%ld ms)\n", args.deadline_ms, total_ms <= args.deadline_ms ? "met" : "missed", total_ms);
+    if (result.num_steps_planned < args.num_steps) {
+        printf("  Steps reduced from %zu to %zu\n", args.num_steps, result.num_steps_planned);
+    }
+    if (result.deadline_cut) {
+        printf("  Out of time during the diffusion, the last %zu steps skipped\n", result.num_steps_skipped);
+    }
+}
 
-    // Store the data in interleaved format (L0, R0, L1, R1,....)
-    out_file.write("data", 4);
-    out_file.write(reinterpret_cast<const char*>(&data_chunk_sz), 4);
+// -- Checkpoints: x after some steps, to resume the diffusion with another seed or prompt
+static void save_checkpoint(const GenerationParams& params, const StepProgress& progress, const TensorView& latent) {
+    const size_t step = progress.step;
+    LatentInfo info;
+    info.prompt        = params.prompt;
+    info.seed          = params.seed;
+    info.num_steps     = static_cast<uint32_t>(progress.num_steps);
+    info.step          = static_cast<uint32_t>(step);
+    info.audio_len_sec = params.audio_len_sec;
+    info.sigma_max     = params.sigma_max;
+    info.dims          = latent.dims;
+
+    const std::string path = get_filename(params.prompt, params.seed, "step" + std::to_string(step) + ".latent");
+    save_latent(path, info, latent.as<float>());
+    fprintf(stderr, "Checkpoint saved to %s\n", path.c_str());
+}
 
-    for (size_t i = 0; i < buffer_sz; ++i) {
-        out_file.write(reinterpret_cast<const char*>(&left_ch[i]), sizeof(float));
-        out_file.write(reinterpret_cast<const char*>(&right_ch[i]), sizeof(float));
+// The schedule (number of steps, sigma_max) and the length come from the checkpoint,
+// the seed from this run. The prompt of the checkpoint is kept unless -p is given.
+static bool load_checkpoint(const std::string& path, CliArgs& args, GenerationParams& params) {
+    const std::unique_ptr<LatentFile> latent_file = LatentFile::open(path);
+    if (latent_file == nullptr) {
+        return false;
+    }
+    const LatentInfo& info = latent_file->info();
+    if (info.step == 0 || info.step >= info.num_steps) {
+        fprintf(stderr, "ERROR: %s is not a checkpoint (step %u of %u)\n", path.c_str(), info.step, info.num_steps);
+        return false;
     }
 
-    out_file.close();
+    if (args.prompt.empty()) {
+        args.prompt = info.prompt;
+    }
+    args.num_steps     = info.num_steps;
+    args.audio_len_sec = info.audio_len_sec;
+    args.sigma_max     = info.sigma_max;
+
+    params.prompt        = args.prompt;
+    params.num_steps     = info.num_steps;
+    params.audio_len_sec = info.audio_len_sec;
+    params.sigma_max     = info.sigma_max;
+    params.resume_step   = info.step;
+    params.resume_latent.assign(latent_file->data(), latent_file->data() + info.num_elems());
+
+    fprintf(stderr, "Resuming \"%s\" from step %u/%u of seed %llu\n", info.prompt.c_str(), info.step, info.num_steps,
+        static_cast<unsigned long long>(info.seed));
+    return true;
 }
 
-static void fill_random_norm_dist(float* buff, size_t buff_sz, size_t seed) {
-    std::random_device rd{};
-    std::mt19937 gen(seed);
-    std::normal_distribution<float> dis(0.0f, 1.0f);
+// Position of the extension of path, or its size if it has none
+static size_t extension_pos(const std::string& path) {
+    const size_t dot = path.find_last_of('.');
+    const size_t slash = path.find_last_of('/');
+    return dot != std::string::npos && (slash == std::string::npos || dot > slash) ? dot : path.size();
+}
 
-    auto gen_fn = [&dis, &gen](){ return dis(gen); };
-    std::generate(buff, buff + buff_sz, gen_fn);
+// preview.txt -> preview_<seed>.txt, for the files written once per variation
+static std::string path_for_seed(const std::string& path, size_t seed) {
+    const size_t ext = extension_pos(path);
+    return path.substr(0, ext) + "_" + std::to_string(seed) + path.substr(ext);
 }
 
-static void fill_sigmas(std::vector<float>& arr, float start, float end, float sigma_max) {
+// clip.flac -> clip.preview.wav
+static std::string preview_audio_path(const std::string& output_file) {
+    return output_file.substr(0, extension_pos(output_file)) + ".preview.wav";
+}
 
-    const int32_t sz = static_cast<int32_t>(arr.size());
-    const float step = ((end - start) / static_cast<float> (sz - 1));
+// Audible preview: the AutoEncoder run on the denoised estimate of a step. The AutoEncoder
+// holds no state across runs, so the final decode is not affected. The file is written
+// aside and renamed, so a player polling it never reads a partial one.
+static void write_preview_audio(Pipeline& pipeline, const std::string& path, size_t step, const float* denoised, size_t num_elems) {
+    const GenerationResult preview = pipeline.decode(denoised, num_elems);
+    const std::string tmp_path = path + ".tmp";
+    save_as_wav(tmp_path, preview.left_ch, preview.right_ch, preview.num_samples);
+    AUDIOGEN_CHECK(std::rename(tmp_path.c_str(), path.c_str()) == 0);
+    fprintf(stderr, "Preview of step %zu -> %s (%ld ms)\n", step, path.c_str(), preview.autoencoder_ms);
+}
 
-    // Linspace
-    arr[0]      = start;
-    arr[sz - 1] = end;
+// -v, the previews and the checkpoints of a generation, written as its steps run.
+// params and preview_stream must outlive the callback.
+static ProgressCallback make_progress_callback(const CliArgs& args, const GenerationParams& params, Pipeline& pipeline,
+                                               std::ofstream& preview_stream, const std::string& preview_audio_file) {
+    const TensorView latent = pipeline.latent();
+    return [&args, &params, &pipeline, latent, &preview_stream, preview_audio_file](const StepProgress& progress, const float* denoised) {
+        if (args.verbose) {
+            print_step_progress(progress);
+        }
+        if (preview_stream.is_open()) {
+            write_latent_preview(preview_stream, progress.step, denoised, latent.dims[1], latent.dims[2]);
+        }
+        // The last step is decoded by the generation itself
+        if (args.preview_every > 0 && progress.step % args.preview_every == 0 && progress.step < progress.num_steps) {
+            write_preview_audio(pipeline, preview_audio_file, progress.step, denoised, latent.num_elems());
+        }
+        // x is the input of the next step
+        if (std::find(args.checkpoint_steps.begin(), args.checkpoint_steps.end(), progress.step) != args.checkpoint_steps.end() &&
+            progress.step < progress.num_steps) {
+            save_checkpoint(params, progress, latent);
+        }
+    };
+}
 
-    for(int32_t i = 1; i < sz - 1; ++i) {
-        arr[i] = arr[i - 1] + step;
-    }
+// -- Variations: one clip per seed, with the models loaded once
+static int32_t run_variations(const CliArgs& args, Pipeline& pipeline, GenerationParams params, const FlacOptions& flac_options) {
+    for (size_t v = 0; v < args.num_variations; ++v) {
+        params.seed = args.seed + v;
 
-    // Sigmoid(-logsnr)
-    for(int32_t i = 0; i < sz; ++i) {
-        arr[i] = 1.0f / (1.0f + std::exp(arr[i])) ;
-    }
+        // The checkpoints are named after the seed already
+        std::ofstream preview_stream;
+        if (!args.preview_file.empty()) {
+            preview_stream.open(path_for_seed(args.preview_file, params.seed));
+            AUDIOGEN_CHECK(preview_stream);
+        }
+        const std::string output_file = get_filename(params.prompt, params.seed, args.format);
+        const ProgressCallback on_step = make_progress_callback(args, params, pipeline, preview_stream, preview_audio_path(output_file));
 
-    arr[0]      = sigma_max;
-    arr[sz - 1] = k_sigma_min;
-}
+        const GenerationResult result = pipeline.generate(params, on_step, &g_cancel_requested);
+        if (result.cancelled) {
+            return k_exit_cancelled;
+        }
 
-static void sampler_ping_pong(float* dit_out_data, float* dit_x_in_data, size_t dit_x_in_sz, float cur_t, float next_t, size_t step_idx, size_t seed) {
+        if (args.postprocess.enabled()) {
+            postprocess(result.left_ch, result.right_ch, result.num_samples, k_audio_sr, args.postprocess);
+        }
+        save_audio(output_file, result.left_ch, result.right_ch, result.num_samples, flac_options);
 
-    for(size_t i = 0; i < dit_x_in_sz; i++) {
-        dit_out_data[i] = dit_x_in_data[i] - ( cur_t * dit_out_data[i]);
+        printf("Seed %zu -> %s: %zu DiT steps, %ld ms\n", params.seed, output_file.c_str(), result.num_steps_run,
+            result.t5_ms + result.dit_ms + result.autoencoder_ms);
     }
 
-    std::vector<float> rand_tensor(dit_x_in_sz);
-    fill_random_norm_dist(rand_tensor.data(), dit_x_in_sz, seed);
-
-    // x = (1-t_next) * denoised + t_next * torch.randn_like(x)
-    for(size_t i = 0; i < dit_x_in_sz; i++) {
-        dit_x_in_data[i] = ((1.0f - next_t) * dit_out_data[i]) + (next_t * rand_tensor[i]);
-    }
+    finish_tracing(args);
+    return 0;
 }
 
 int main(int32_t argc, char** argv) {
 
     // ----- Parse the cmd line arguments
     // ----------------------------------
-    // Required arguments
-    std::string models_base_path = "";
-    std::string prompt           = "";
-    std::string audio_input_path = "";
-    size_t num_threads           = 0;
-    // Optional arguments
-    std::string output_file      = "";
-    size_t seed                  = k_seed_default;
-    size_t num_steps             = k_num_steps_default;
-    float audio_len_sec          = static_cast<float>(k_audio_len_sec_default);
-    float sigma_max              = static_cast<float>(k_sigma_max);
+    CliArgs args;
+    const std::vector<CliOption> options = get_cli_options(args);
 
-    int opt;
-    while ((opt = getopt(argc, argv, "m:p:t:i:x:s:n:o:l:h")) != -1) {
-        switch (opt) {
-            case 'm': models_base_path = optarg; break;
-            case 'p': prompt           = optarg; break;
-            case 't': num_threads      = std::stoull(optarg); break;
-            case 'i': audio_input_path = optarg; break;
-            case 'x': sigma_max        = static_cast<float>(std::stof(optarg)); break;
-            case 's': seed             = std::stoull(optarg); break;
-            case 'n': num_steps        = std::stoull(optarg); break;
-            case 'o': output_file      = optarg; break;
-            case 'l': audio_len_sec    = static_cast<float>(std::stoull(optarg)); break;
-            case 'h':
-            default:
-                print_usage(argv[0]);
-                return EXIT_FAILURE;
+    if (!parse_args(argc, argv, options)) {
+        print_usage(argv[0], options);
+        return EXIT_FAILURE;
+    }
+
+    // The default variant stands for -m
+    std::vector<ModelVariant> variants;
+    if (!args.variants_file.empty()) {
+        if (!read_variants_file(args.variants_file, variants)) {
+            return EXIT_FAILURE;
+        }
+        if (args.variant.empty()) {
+            args.variant = variants.front().name;
         }
+        auto it = std::find_if(variants.begin(), variants.end(), [&](const ModelVariant& v) { return v.name == args.variant; });
+        if (it == variants.end()) {
+            fprintf(stderr, "ERROR: Unknown variant %s\n", args.variant.c_str());
+            return EXIT_FAILURE;
+        }
+        args.models_base_path = it->models_base_path;
+    } else if (!args.variant.empty()) {
+        fprintf(stderr, "ERROR: --variant needs --variants\n");
+        return EXIT_FAILURE;
+    } else if (!args.models_base_path.empty()) {
+        args.variant = "default";
+        variants.push_back({args.variant, args.models_base_path});
     }
 
     // Check the mandatory arguments
-    if (models_base_path.empty() || prompt.empty() || num_threads <= 0) {
+    if (args.models_base_path.empty() || (args.prompt.empty() && args.jobs_file.empty() && args.decode_latent_files.empty() && args.resume_file.empty()) || args.num_threads <= 0) {
         fprintf(stderr, "ERROR: Missing required arguments.\n\n");
-        print_usage(argv[0]);
+        print_usage(argv[0], options);
         return EXIT_FAILURE;
     }
 
-    if(sigma_max <= 0 || sigma_max >  1) {
+    if(args.sigma_max <= 0 || args.sigma_max >  1) {
         fprintf(stderr, "noise_level (sigma_max) must be between (0,1] \n");
         return EXIT_FAILURE;
     }
 
-    std::string t5_tflite = models_base_path + "/conditioners_float32.tflite";
-    std::string dit_tflite = models_base_path + "/dit_model.tflite";
-    std::string autoencoder_tflite = models_base_path + "/autoencoder_model.tflite";
-    std::string autoencoder_encoder_tflite = models_base_path + "/autoencoder_encoder_model.tflite";
-    std::string sentence_model_path = models_base_path + "/spiece.model";
-
-    // If there is input audio, run the encoder model and release it, to avoid overloading memory
-    std::vector<float> encoded_audio;
-    if(!audio_input_path.empty()) {
-       encode_audio(audio_input_path, autoencoder_encoder_tflite, encoded_audio, num_threads);
+    MemoryOptions memory_options;
+    memory_options.lock = args.lock_memory;
+    if (!parse_huge_pages(args.huge_pages, memory_options.huge_pages)) {
+        fprintf(stderr, "huge pages must be off, thp or explicit\n");
+        return EXIT_FAILURE;
     }
 
-    // ----- Load the models
-    // ----------------------------------
-    std::unique_ptr<tflite::FlatBufferModel> t5_model = tflite::FlatBufferModel::BuildFromFile(t5_tflite.c_str());
-    AUDIOGEN_CHECK(t5_model != nullptr);
-
-    std::unique_ptr<tflite::FlatBufferModel> dit_model = tflite::FlatBufferModel::BuildFromFile(dit_tflite.c_str());
-    AUDIOGEN_CHECK(dit_model != nullptr);
-
-    std::unique_ptr<tflite::FlatBufferModel> autoencoder_model = tflite::FlatBufferModel::BuildFromFile(autoencoder_tflite.c_str());
-    AUDIOGEN_CHECK(autoencoder_model != nullptr);
-
-    // ----- Build the interpreters
-    // ----------------------------------
-    tflite::ops::builtin::BuiltinOpResolver resolver;
-
-    tflite::InterpreterBuilder t5_builder(*t5_model, resolver);
-    tflite::InterpreterBuilder dit_builder(*dit_model, resolver);
-    tflite::InterpreterBuilder autoencoder_builder(*autoencoder_model, resolver);
-
-    std::unique_ptr<tflite::Interpreter> t5_interpreter = std::make_unique<tflite::Interpreter>();
-    t5_builder(&t5_interpreter);
-    AUDIOGEN_CHECK(t5_interpreter != nullptr);
-
-    std::unique_ptr<tflite::Interpreter> dit_interpreter = std::make_unique<tflite::Interpreter>();
-    dit_builder(&dit_interpreter);
-    AUDIOGEN_CHECK(dit_interpreter != nullptr);
-
-    std::unique_ptr<tflite::Interpreter> autoencoder_interpreter = std::make_unique<tflite::Interpreter>();
-    autoencoder_builder(&autoencoder_interpreter);
-    AUDIOGEN_CHECK(autoencoder_interpreter != nullptr);
-
-    // Create the XNNPACK delegate options
-    TfLiteXNNPackDelegateOptions xnnpack_options = TfLiteXNNPackDelegateOptionsDefault();
-    xnnpack_options.num_threads = num_threads;
+    if ((args.format != "wav" && args.format != "flac") || (args.flac_bits != 16 && args.flac_bits != 24)) {
+        fprintf(stderr, "format must be wav or flac, and the FLAC bits per sample 16 or 24\n");
+        return EXIT_FAILURE;
+    }
 
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_QS8;
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_QU8;
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_DYNAMIC_FULLY_CONNECTED;
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_ENABLE_SUBGRAPH_RESHAPING;
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_ENABLE_LATEST_OPERATORS;
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_VARIABLE_OPERATORS;
+    if (args.deadline_ms < 0) {
+        fprintf(stderr, "deadline must be positive\n");
+        return EXIT_FAILURE;
+    }
 
-    // XNNPack delegate options for the T5 and DiT models
-    std::unique_ptr<TfLiteDelegate, TfLiteDelegateDeleter> xnnpack_delegate_fp32(TfLiteXNNPackDelegateCreate(&xnnpack_options));
+    if (args.postprocess.fade_in_ms < 0.0f || args.postprocess.fade_out_ms < 0.0f) {
+        fprintf(stderr, "fade durations must be positive\n");
+        return EXIT_FAILURE;
+    }
 
-    // XNNPack delegate options for the autoencoder model.
-    // We force the FP16 computation just to the most computatioannly expensive model
-    xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_FORCE_FP16;
-    std::unique_ptr<TfLiteDelegate, TfLiteDelegateDeleter> xnnpack_delegate_fp16(TfLiteXNNPackDelegateCreate(&xnnpack_options));
+    FlacOptions flac_options;
+    flac_options.bits_per_sample = args.flac_bits;
+    flac_options.num_threads     = static_cast<uint32_t>(args.num_threads);
 
-    // Add the delegate to the interpreter
-    if (t5_interpreter->ModifyGraphWithDelegate(xnnpack_delegate_fp32.get()) != kTfLiteOk) {
-        AUDIOGEN_CHECK(false && "Failed to apply XNNPACK delegate");
+    const std::vector<std::string> backends = available_backends();
+    if (std::find(backends.begin(), backends.end(), args.backend) == backends.end()) {
+        fprintf(stderr, "ERROR: Backend '%s' is not available. Available backends:", args.backend.c_str());
+        for (const auto& name : backends) {
+            fprintf(stderr, " %s", name.c_str());
+        }
+        fprintf(stderr, "\n");
+        return EXIT_FAILURE;
     }
 
-    if (dit_interpreter->ModifyGraphWithDelegate(xnnpack_delegate_fp32.get()) != kTfLiteOk) {
-        AUDIOGEN_CHECK(false && "Failed to apply XNNPACK delegate");
+    if (args.metrics.port < 0 || args.metrics.port > 65535) {
+        fprintf(stderr, "--metrics-port must be between 0 and 65535, 0 disabling the server\n");
+        return EXIT_FAILURE;
     }
-
-    if (autoencoder_interpreter->ModifyGraphWithDelegate(xnnpack_delegate_fp16.get()) != kTfLiteOk) {
-        AUDIOGEN_CHECK(false && "Failed to apply XNNPACK delegate");
+    if (args.metrics.interval_ms <= 0) {
+        fprintf(stderr, "--metrics-interval must be positive\n");
+        return EXIT_FAILURE;
     }
 
-    // ----- Allocate the tensors
-    // ----------------------------------
-    AUDIOGEN_CHECK(t5_interpreter->AllocateTensors() == kTfLiteOk);
-    AUDIOGEN_CHECK(dit_interpreter->AllocateTensors() == kTfLiteOk);
-    AUDIOGEN_CHECK(autoencoder_interpreter->AllocateTensors() == kTfLiteOk);
+    // Exported until the end of main(), whatever the mode
+    std::unique_ptr<MetricsExporter> metrics_exporter;
+    if (args.metrics.enabled()) {
+        metrics_exporter = std::make_unique<MetricsExporter>(args.metrics);
+        metrics_set(MetricGauge::Workers, 1);
+        metrics_set(MetricGauge::ThreadsPerWorker, static_cast<int64_t>(args.num_threads));
+    }
 
-    // ----- Get the input & output tensors pointers
-    // ----------------------------------
-    const size_t t5_ids_in_id = t5_interpreter->inputs()[k_t5_ids_in_idx];
-    const size_t t5_attnmask_in_id = t5_interpreter->inputs()[k_t5_attnmask_in_idx];
-    const size_t t5_time_in_id = t5_interpreter->inputs()[k_t5_audio_len_in_idx];
-
-    const size_t t5_crossattn_out_id = t5_interpreter->outputs()[k_t5_crossattn_out_idx];
-    const size_t t5_globalcond_out_id = t5_interpreter->outputs()[k_t5_globalcond_out_idx];
-
-    const size_t dit_x_in_id = dit_interpreter->inputs()[k_dit_x_in_idx];
-    const size_t dit_t_in_id = dit_interpreter->inputs()[k_dit_t_in_idx];
-    const size_t dit_crossattn_in_id = dit_interpreter->inputs()[k_dit_crossattn_in_idx];
-    const size_t dit_globalcond_in_id = dit_interpreter->inputs()[k_dit_globalcond_in_idx];
-    const size_t dit_out_id = dit_interpreter->outputs()[k_dit_out_idx];
-
-    const size_t autoencoder_in_id = autoencoder_interpreter->inputs()[0];
-    const size_t autoencoder_out_id = autoencoder_interpreter->outputs()[0];
-
-    int64_t* t5_ids_in_data = t5_interpreter->typed_tensor<int64_t>(t5_ids_in_id);
-    int64_t* t5_attnmask_in_data = t5_interpreter->typed_tensor<int64_t>(t5_attnmask_in_id);
-    float* t5_time_in_data = t5_interpreter->typed_tensor<float>(t5_time_in_id);
-    float* t5_crossattn_out_data = t5_interpreter->typed_tensor<float>(t5_crossattn_out_id);
-    float* t5_globalcond_out_data = t5_interpreter->typed_tensor<float>(t5_globalcond_out_id);
-
-    float* dit_x_in_data = dit_interpreter->typed_tensor<float>(dit_x_in_id);
-    float* dit_t_in_data = dit_interpreter->typed_tensor<float>(dit_t_in_id);
-    float* dit_crossattn_in_data = dit_interpreter->typed_tensor<float>(dit_crossattn_in_id);
-    float* dit_globalcond_in_data = dit_interpreter->typed_tensor<float>(dit_globalcond_in_id);
-    float* dit_out_data = dit_interpreter->typed_tensor<float>(dit_out_id);
-    float* autoencoder_in_data = autoencoder_interpreter->typed_tensor<float>(autoencoder_in_id);
-    float* autoencoder_out_data = autoencoder_interpreter->typed_tensor<float>(autoencoder_out_id);
-
-    // ----- Get the input & output tensors dimensions
-    // ----------------------------------
-    TfLiteIntArray* t5_ids_in_dims = t5_interpreter->tensor(t5_ids_in_id)->dims;
-    TfLiteIntArray* t5_attnmask_in_dims = t5_interpreter->tensor(t5_attnmask_in_id)->dims;
-    TfLiteIntArray* t5_crossattn_out_dims = t5_interpreter->tensor(t5_crossattn_out_id)->dims;
-    TfLiteIntArray* t5_globalcond_out_dims = t5_interpreter->tensor(t5_globalcond_out_id)->dims;
+    // Shared by the workers in throughput mode, so that identical jobs are coalesced
+    std::unique_ptr<ResultCache> result_cache;
+    if (!args.result_cache_dir.empty()) {
+        result_cache = std::make_unique<ResultCache>(args.result_cache_dir, args.result_cache_size_mb * 1024 * 1024);
+    }
 
-    TfLiteIntArray* dit_x_in_dims = dit_interpreter->tensor(dit_x_in_id)->dims;
-    TfLiteIntArray* dit_crossattn_in_dims = dit_interpreter->tensor(dit_crossattn_in_id)->dims;
-    TfLiteIntArray* dit_globalcond_in_dims = dit_interpreter->tensor(dit_globalcond_in_id)->dims;
-    TfLiteIntArray* autoencoder_in_dims = autoencoder_interpreter->tensor(autoencoder_in_id)->dims;
-    TfLiteIntArray* autoencoder_out_dims = autoencoder_interpreter->tensor(autoencoder_out_id)->dims;
+    // A cancellation request (e.g. Ctrl+C, or a UI killing an abandoned job) is honoured
+    // between two DiT steps and before the autoencoder, a second one ends the process
+    std::signal(SIGINT, on_cancel_signal);
+    std::signal(SIGTERM, on_cancel_signal);
+
+    GenerationParams params;
+    params.prompt        = args.prompt;
+    params.seed          = args.seed;
+    params.num_steps     = args.num_steps;
+    params.audio_len_sec = args.audio_len_sec;
+    params.sigma_max     = args.sigma_max;
+    params.init_offset_sec = args.input_offset_sec;
+    params.convergence_threshold = args.convergence_threshold;
+    params.deadline_ms   = args.deadline_ms;
+
+    if (!args.resume_file.empty()) {
+        if (!args.jobs_file.empty() || !args.decode_latent_files.empty() || !args.audio_input_path.empty()) {
+            fprintf(stderr, "--resume cannot be combined with the throughput and decode-only modes, or with -i\n");
+            return EXIT_FAILURE;
+        }
+        if (!load_checkpoint(args.resume_file, args, params)) {
+            return EXIT_FAILURE;
+        }
+    }
 
-    // ----- Allocate the extra buffer to pre-compute the sigmas
-    std::vector<float> t_buffer(num_steps + 1);
+    if (args.num_variations == 0 || (args.num_variations > 1 && (!args.output_file.empty() || !args.save_latent_file.empty()))) {
+        fprintf(stderr, "--variations needs at least one clip, and names the clips after the prompt and the seed (no -o or --save-latent)\n");
+        return EXIT_FAILURE;
+    }
 
-    // ----- Initialize the T and X buffers
+    if (!args.dit_capture_file.empty() && (!args.jobs_file.empty() || !args.decode_latent_files.empty() || args.num_variations > 1)) {
+        fprintf(stderr, "--capture-dit captures a single generation, it cannot be combined with the throughput, decode-only and variations modes\n");
+        return EXIT_FAILURE;
+    }
 
-    // Fill x tensor with noise
-    const size_t dit_x_num_elems = get_num_elems(dit_x_in_dims);
-    fill_random_norm_dist(dit_x_in_data, dit_x_num_elems, seed);
+    if (args.preview_every > 0 && (!args.jobs_file.empty() || !args.decode_latent_files.empty())) {
+        fprintf(stderr, "--preview-every decodes the steps of a generation, it cannot be combined with the throughput and decode-only modes\n");
+        return EXIT_FAILURE;
+    }
 
-    if(!audio_input_path.empty()) {
-        for(int i = 0; i < dit_x_num_elems; ++i) {
-            dit_x_in_data[i] =  encoded_audio[i] * (1 - sigma_max) + dit_x_in_data[i] * sigma_max;
+    if (!args.jobs_file.empty()) {
+        if (args.num_workers == 0) {
+            fprintf(stderr, "The throughput mode needs at least one worker\n");
+            return EXIT_FAILURE;
         }
+        // The ExecuTorch threadpool is shared by the whole process, and its threads keep the affinity
+        // of the worker creating it: the parallel work of every worker would run on the CPUs of one.
+        // With one thread, each worker runs its models on its own pinned thread.
+        if (args.backend == "executorch" && args.num_workers > 1 && args.num_threads > 1) {
+            fprintf(stderr, "The executorch backend cannot pin a thread pool per worker, use -t 1 with several workers\n");
+            return EXIT_FAILURE;
+        }
+        return run_throughput_mode(args, variants, params, memory_options, flac_options, result_cache.get());
     }
 
-    float logsnr_max = k_logsnr_max;
-    if(sigma_max < 1) {
-        logsnr_max = std::log(((1-sigma_max)/sigma_max) + 1e-6);
+    if (!args.decode_latent_files.empty()) {
+        return run_decode_mode(args, memory_options, flac_options);
     }
 
-    fill_sigmas(t_buffer, logsnr_max, 2.0f, sigma_max);
+    std::unique_ptr<Backend> backend = create_backend(args.backend, args.num_threads);
+    AUDIOGEN_CHECK(backend != nullptr);
+    backend->set_memory_options(memory_options);
+
+    Pipeline pipeline(*backend, args.models_base_path);
 
-    // Convert the prompt to IDs
-    std::vector<int32_t> ids = convert_prompt_to_ids(prompt, sentence_model_path);
+    // If there is input audio, run the encoder model and release it, to avoid overloading memory
+    pipeline.set_encoder_cache_dir(args.encoder_cache_dir);
+    // The checkpoints, the previews and the capture are written as the steps run, which a cache hit skips
+    const bool writes_steps = !args.checkpoint_steps.empty() || !args.preview_file.empty() || args.preview_every > 0 ||
+                              !args.dit_capture_file.empty();
+    if (result_cache != nullptr && writes_steps) {
+        fprintf(stderr, "Warning: the result cache is not used with --checkpoint, -r, --preview-every and --capture-dit\n");
+    } else {
+        pipeline.set_result_cache(result_cache.get());
+    }
+    pipeline.set_dit_capture_path(args.dit_capture_file);
+    if (!args.audio_input_path.empty()) {
+        params.init_latent = pipeline.encode_audio(args.audio_input_path, params.init_latent_frames);
+    }
 
-    // Initialize the t5_ids_in_data
-    memset(t5_ids_in_data, 0, get_num_elems(t5_ids_in_dims) * sizeof(int64_t));
+    // ----- Load the models
+    // ----------------------------------
+    pipeline.load();
 
-    for(size_t i = 0; i < ids.size(); ++i) {
-        t5_ids_in_data[i] = ids[i];
+    if (args.verbose) {
+        print_load_timeline(pipeline.load_timeline());
     }
 
-    // Initialize the t5_attnmask_in_data
-    memset(t5_attnmask_in_data, 0, get_num_elems(t5_attnmask_in_dims) * sizeof(int64_t));
-    for(int i = 0; i < ids.size(); i++) {
-        t5_attnmask_in_data[i] = 1;
+    if (args.deadline_ms > 0) {
+        // Warms the models up as well
+        const StageCosts& costs = pipeline.calibrate();
+        fprintf(stderr, "Calibration: T5 %.1f ms, DiT step %.1f ms, AutoEncoder %.1f ms\n",
+            costs.t5_ms, costs.dit_step_ms, costs.autoencoder_ms);
+    } else if (args.run_dummy_run) {
+        fprintf(stderr, "Running dummy forward pass for all models...\n");
+        pipeline.warmup();
+        fprintf(stderr, "Dummy Run finished.\n");
     }
 
-    // Initialize the t5_time_in_data
-    memcpy(t5_time_in_data, &audio_len_sec, 1 * sizeof(float));
+    if (memory_options.enabled()) {
+        print_memory_report(get_memory_report());
+    }
 
-    auto start_t5 = time_in_ms();
+    // Loading, calibrating and encoding take seconds, and are not interrupted
+    if (g_cancel_requested) {
+        return k_exit_cancelled;
+    }
 
-    // Run T5
-    AUDIOGEN_CHECK(t5_interpreter->Invoke() == kTfLiteOk);
+    start_tracing(args);
 
-    auto end_t5 = time_in_ms();
+    if (args.num_variations > 1) {
+        return run_variations(args, pipeline, params, flac_options);
+    }
 
-    // Since the crossattn and global conditioner are constants, we can initialize these 2 inputs
-    // of DiT outside the diffusion for loop
-    memcpy(dit_crossattn_in_data, t5_crossattn_out_data, get_num_elems(dit_crossattn_in_dims) * sizeof(float));
-    memcpy(dit_globalcond_in_data, t5_globalcond_out_data, get_num_elems(dit_globalcond_in_dims) * sizeof(float));
+    // ----- Prepare the progress reporting
+    // ----------------------------------
+    std::ofstream preview_stream;
+    if (!args.preview_file.empty()) {
+        preview_stream.open(args.preview_file);
+        AUDIOGEN_CHECK(preview_stream);
+    }
 
-    auto start_dit = time_in_ms();
+    // Named after the clip, which may not be written (--save-latent without -o)
+    const std::string preview_audio_file =
+        preview_audio_path(args.output_file.empty() ? get_filename(args.prompt, args.seed, args.format) : args.output_file);
 
-    for(size_t i = 0; i < num_steps; ++i) {
-        const float curr_t = t_buffer[i];
-        const float next_t = t_buffer[i + 1];
-        memcpy(dit_t_in_data, &curr_t, 1 * sizeof(float));
+    const TensorView latent = pipeline.latent();
+    const ProgressCallback on_step = make_progress_callback(args, params, pipeline, preview_stream, preview_audio_file);
 
-        // Run DiT
-        AUDIOGEN_CHECK(dit_interpreter->Invoke() == kTfLiteOk);
+    // ----- Run the generation
+    // ----------------------------------
+    params.decode = args.save_latent_file.empty() || !args.output_file.empty();
 
-        // The output of DiT is combined with the current x and t tensors to
-        // generate the next x tensor for DiT
-        sampler_ping_pong(dit_out_data, dit_x_in_data, get_num_elems(dit_x_in_dims), curr_t, next_t, i, seed + i + 4564);
+    const GenerationResult result = pipeline.generate(params, on_step, &g_cancel_requested);
+    if (result.cancelled) {
+        return k_exit_cancelled;
     }
-    auto end_dit = time_in_ms();
-
-    auto start_autoencoder = time_in_ms();
 
-    // Initialize the autoencoder's input
-    memcpy(autoencoder_in_data, dit_x_in_data, get_num_elems(dit_x_in_dims) * sizeof(float));
-
-    // Run AutoEncoder
-    AUDIOGEN_CHECK(autoencoder_interpreter->Invoke() == kTfLiteOk);
+    if (!args.save_latent_file.empty()) {
+        LatentInfo info;
+        info.prompt        = params.prompt;
+        info.seed          = params.seed;
+        info.num_steps     = static_cast<uint32_t>(result.num_steps_planned);
+        info.step          = static_cast<uint32_t>(result.first_step + result.num_steps_run + result.num_steps_skipped);
+        info.audio_len_sec = params.audio_len_sec;
+        info.sigma_max     = params.sigma_max;
+        info.dims          = latent.dims;
+        save_latent(args.save_latent_file, info, latent.as<float>());
+        fprintf(stderr, "Latent saved to %s\n", args.save_latent_file.c_str());
+    }
 
-    auto end_autoencoder = time_in_ms();
+    if (!args.report_json_file.empty()) {
+        write_report_json(args, pipeline.load_timeline(), result, latent);
+    }
 
-    const size_t num_audio_samples = get_num_elems(autoencoder_out_dims) / 2;
-    const float* left_ch = autoencoder_out_data;
-    const float* right_ch = autoencoder_out_data + num_audio_samples;
+    if (!params.decode) {
+        finish_tracing(args);
+        printf("T5: %ld ms\n", result.t5_ms);
+        printf("DiT: %ld ms\n", result.dit_ms);
+        return 0;
+    }
 
-    // If output filename empty -> filename = <prompt>_<seed>.wav
-    if (output_file.empty()) {
-        output_file = get_filename(prompt, seed);
+    // If output filename empty -> filename = <prompt>_<seed>.<format>
+    if (args.output_file.empty()) {
+        args.output_file = get_filename(args.prompt, args.seed, args.format);
     }
 
-    save_as_wav(output_file.c_str(), left_ch, right_ch, num_audio_samples);
+    // Post-process and save the file
+    if (args.postprocess.enabled()) {
+        postprocess(result.left_ch, result.right_ch, result.num_samples, k_audio_sr, args.postprocess);
+    }
+    save_audio(args.output_file, result.left_ch, result.right_ch, result.num_samples, flac_options);
+    finish_tracing(args);
 
-    // Save the file
-    auto t5_exec_time          = (end_t5 - start_t5);
-    auto dit_exec_time         = (end_dit - start_dit);
-    auto dit_avg_step_time     = (dit_exec_time / static_cast<float>(num_steps));
-    auto autoencoder_exec_time = (end_autoencoder - start_autoencoder);
-    auto total_exec_time       = t5_exec_time + dit_exec_time + autoencoder_exec_time;
+    auto dit_avg_step_time = (result.dit_ms / static_cast<float>(std::max<size_t>(1, result.num_steps_run)));
+    auto total_exec_time   = result.t5_ms + result.dit_ms + result.autoencoder_ms;
 
-    printf("T5: %ld ms\n", t5_exec_time);
-    printf("DiT: %ld ms\n", dit_exec_time);
+    printf("T5: %ld ms\n", result.t5_ms);
+    if (args.verbose) {
+        printf("T5 sequence length: %zu\n", result.t5_seq_len);
+    }
+    printf("DiT: %ld ms\n", result.dit_ms);
     printf("DiT Avg per step: %f ms\n", dit_avg_step_time);
-    printf("Autoencoder: %ld ms\n", autoencoder_exec_time);
+    if (args.convergence_threshold > 0.0f || args.deadline_ms > 0) {
+        printf("DiT steps: %zu/%zu (%zu skipped)\n", result.num_steps_run, result.num_steps_planned, result.num_steps_skipped);
+    }
+    if (args.verbose && params.resume_latent.empty() && result.first_step > 0) {
+        printf("DiT steps above sigma_max %.2f: %zu/%zu, not run\n", args.sigma_max, result.first_step, result.num_steps_planned);
+    }
+    printf("Autoencoder: %ld ms\n", result.autoencoder_ms);
     printf("Total run time: %ld ms\n", total_exec_time);
+    if (args.deadline_ms > 0) {
+        print_deadline_report(args, result);
+    }
+
+    if (args.verbose && heap_allocation_counting_enabled()) {
+        printf("Heap allocations in the DiT loop: %zu\n", result.dit_heap_allocs);
+    }
 
     return 0;
 }
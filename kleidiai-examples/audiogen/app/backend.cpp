@@ -0,0 +1,67 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "backend.h"
+
+namespace audiogen {
+
+// The storage starts on a page boundary, so the alignment of each buffer only depends on its offset
+MemoryArena::MemoryArena(size_t size, const MemoryOptions& options)
+    : storage_(size, options), data_(storage_.data()), size_(size) {}
+
+void* MemoryArena::allocate(size_t size, size_t alignment) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const size_t offset = (used_ + alignment - 1) / alignment * alignment;
+    if (offset + size > size_) {
+        return nullptr;
+    }
+    used_ = offset + size;
+    return data_ + offset;
+}
+
+size_t MemoryArena::used() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return used_;
+}
+
+std::unique_ptr<Backend> create_backend(const std::string& name, size_t num_threads) {
+#if defined(AUDIOGEN_WITH_LITERT)
+    if (name == "litert") {
+        return create_litert_backend(num_threads);
+    }
+#endif
+#if defined(AUDIOGEN_WITH_EXECUTORCH)
+    if (name == "executorch") {
+        return create_executorch_backend(num_threads);
+    }
+#endif
+    return nullptr;
+}
+
+std::vector<std::string> available_backends() {
+    std::vector<std::string> names;
+#if defined(AUDIOGEN_WITH_LITERT)
+    names.push_back("litert");
+#endif
+#if defined(AUDIOGEN_WITH_EXECUTORCH)
+    names.push_back("executorch");
+#endif
+    return names;
+}
+
+} // namespace audiogen
@@ -0,0 +1,170 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "memory.h"
+
+namespace audiogen {
+
+// The submodules of Stable Audio Open Small
+enum class ModelKind {
+    Conditioners,   // T5 text encoder + number conditioner
+    DiT,            // Diffusion transformer
+    Decoder,        // AutoEncoder decoder (latent -> waveform)
+    Encoder,        // AutoEncoder encoder (waveform -> latent), only needed for style transfer
+};
+
+enum class DataType {
+    Float32,
+    Int32,
+    Int64,
+};
+
+// Non-owning view over a tensor buffer of a model
+struct TensorView {
+    void* data = nullptr;
+    DataType type = DataType::Float32;
+    std::vector<int64_t> dims;
+
+    size_t num_elems() const {
+        size_t x = 1;
+        for (const auto dim : dims) {
+            x *= static_cast<size_t>(dim);
+        }
+        return x;
+    }
+
+    template <typename T>
+    T* as() const {
+        return static_cast<T*>(data);
+    }
+};
+
+// A loaded model, ready to be invoked
+class Model {
+public:
+    virtual ~Model() = default;
+
+    virtual size_t num_inputs() const = 0;
+    virtual size_t num_outputs() const = 0;
+
+    // The input buffers are bound once when the model is loaded and stay valid for the
+    // lifetime of the model, so they can be filled in place before every invoke()
+    virtual TensorView input(size_t idx) = 0;
+
+    // The output buffers are bound once when the model is loaded as well. They hold the
+    // results of the last invoke(), so they can be fetched once outside of a loop
+    virtual TensorView output(size_t idx) = 0;
+
+    virtual bool invoke() = 0;
+};
+
+// -- Index of the input & output tensors of each model.
+// The order depends on how the model has been exported, so it is provided by the backend.
+struct TensorLayout {
+    size_t t5_ids_in_idx;
+    size_t t5_attnmask_in_idx;
+    size_t t5_audio_len_in_idx;
+    size_t t5_crossattn_out_idx;
+    size_t t5_globalcond_out_idx;
+
+    size_t dit_x_in_idx;
+    size_t dit_t_in_idx;
+    size_t dit_crossattn_in_idx;
+    size_t dit_globalcond_in_idx;
+    size_t dit_out_idx;
+};
+
+// Caller-provided memory for the planned buffers (activations, inputs and outputs) of
+// the models. Backends planning their memory ahead of time carve their buffers out of it,
+// so that nothing is allocated on the heap once the models are loaded.
+class MemoryArena {
+public:
+    static constexpr size_t k_alignment = 64;
+
+    explicit MemoryArena(size_t size, const MemoryOptions& options = MemoryOptions());
+
+    // Returns nullptr if the arena is exhausted.
+    // Thread-safe, since the models may be loaded concurrently.
+    void* allocate(size_t size, size_t alignment = k_alignment);
+
+    size_t size() const { return size_; }
+    size_t used() const;
+
+private:
+    mutable std::mutex mutex_;
+    PageBuffer storage_;
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t used_ = 0;
+};
+
+// An inference runtime able to load and run the submodules
+class Backend {
+public:
+    virtual ~Backend() = default;
+
+    virtual const char* name() const = 0;
+
+    virtual const TensorLayout& layout() const = 0;
+
+    // Huge pages and locking of the model weights and arenas, to be set before loading the models
+    void set_memory_options(const MemoryOptions& options) { memory_options_ = options; }
+    const MemoryOptions& memory_options() const { return memory_options_; }
+
+    // Path of the file holding the given submodule in the models directory
+    virtual std::string model_path(const std::string& models_base_path, ModelKind kind) const = 0;
+
+    // Path of the conditioners exported for prompts of at most seq_len tokens, optional next to the
+    // full-length one (see Pipeline::load())
+    virtual std::string conditioners_bucket_path(const std::string& models_base_path, size_t seq_len) const = 0;
+
+    // Size of the MemoryArena needed to load the model, 0 if the backend manages its own memory
+    virtual size_t planned_memory_size(const std::string& /* path */) { return 0; }
+
+    // May be called concurrently from several threads, for different models
+    virtual std::unique_ptr<Model> load_model(const std::string& path, ModelKind kind, MemoryArena* arena = nullptr) = 0;
+
+protected:
+    MemoryOptions memory_options_;
+};
+
+// Create the backend with the given name ("litert" or "executorch").
+// Returns nullptr if the backend has not been compiled in.
+std::unique_ptr<Backend> create_backend(const std::string& name, size_t num_threads);
+
+// Names of the backends compiled in this binary
+std::vector<std::string> available_backends();
+
+#if defined(AUDIOGEN_WITH_LITERT)
+std::unique_ptr<Backend> create_litert_backend(size_t num_threads);
+#endif
+
+#if defined(AUDIOGEN_WITH_EXECUTORCH)
+std::unique_ptr<Backend> create_executorch_backend(size_t num_threads);
+#endif
+
+} // namespace audiogen
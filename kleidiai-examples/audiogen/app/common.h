@@ -0,0 +1,68 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define AUDIOGEN_CHECK(x)                                 \
+    if (!(x)) {                                                 \
+        fprintf(stderr, "Error at %s:%d\n", __FILE__, __LINE__);\
+        exit(1);                                                \
+    }
+
+static inline long time_in_ms() {
+    using namespace std::chrono;
+    auto now = time_point_cast<milliseconds>(steady_clock::now());
+    return now.time_since_epoch().count();
+}
+
+static inline long long time_in_ns() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// FNV-1a, can be chained by passing the previous hash
+static inline uint64_t hash_bytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Hash of the contents of a file, read in blocks
+static inline uint64_t hash_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    AUDIOGEN_CHECK(in.is_open());
+
+    std::vector<char> block(1 << 20);
+    uint64_t hash = hash_bytes(nullptr, 0);
+    while (in) {
+        in.read(block.data(), block.size());
+        hash = hash_bytes(block.data(), static_cast<size_t>(in.gcount()), hash);
+    }
+    return hash;
+}
@@ -0,0 +1,145 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dit_capture.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace audiogen {
+
+constexpr char k_dit_capture_magic[8] = {'A', 'G', 'D', 'I', 'T', 'C', 'A', 'P'};
+constexpr uint32_t k_dit_capture_version = 1;
+constexpr size_t k_dit_capture_max_dims = 4;
+
+static size_t num_elems(const std::vector<int64_t>& dims) {
+    size_t n = 1;
+    for (const int64_t dim : dims) {
+        n *= static_cast<size_t>(dim);
+    }
+    return n;
+}
+
+static void write_dims(std::ofstream& out, const std::vector<int64_t>& dims) {
+    AUDIOGEN_CHECK(dims.size() <= k_dit_capture_max_dims);
+    int64_t padded[k_dit_capture_max_dims] = {};
+    std::copy(dims.begin(), dims.end(), padded);
+    out.write(reinterpret_cast<const char*>(padded), sizeof(padded));
+}
+
+static bool read_dims(std::ifstream& in, std::vector<int64_t>& dims) {
+    int64_t padded[k_dit_capture_max_dims] = {};
+    in.read(reinterpret_cast<char*>(padded), sizeof(padded));
+    dims.clear();
+    for (const int64_t dim : padded) {
+        if (dim == 0) {
+            break;
+        }
+        if (dim < 0) {
+            return false;
+        }
+        dims.push_back(dim);
+    }
+    return in.good() && !dims.empty();
+}
+
+static bool read_floats(std::ifstream& in, std::vector<float>& values, size_t count) {
+    values.resize(count);
+    in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(count * sizeof(float)));
+    return static_cast<size_t>(in.gcount()) == count * sizeof(float);
+}
+
+DitCaptureWriter::DitCaptureWriter(const std::string& path, const TensorView& x, const TensorView& cross_attn_cond,
+                                   const TensorView& global_cond)
+    : out_(path, std::ios::binary), x_num_elems_(x.num_elems()) {
+    AUDIOGEN_CHECK(out_.is_open());
+    AUDIOGEN_CHECK(x.type == DataType::Float32 && cross_attn_cond.type == DataType::Float32 &&
+                   global_cond.type == DataType::Float32);
+
+    const uint32_t reserved = 0;
+    out_.write(k_dit_capture_magic, sizeof(k_dit_capture_magic));
+    out_.write(reinterpret_cast<const char*>(&k_dit_capture_version), sizeof(k_dit_capture_version));
+    out_.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+    write_dims(out_, x.dims);
+    write_dims(out_, cross_attn_cond.dims);
+    write_dims(out_, global_cond.dims);
+    out_.write(static_cast<const char*>(cross_attn_cond.data), cross_attn_cond.num_elems() * sizeof(float));
+    out_.write(static_cast<const char*>(global_cond.data), global_cond.num_elems() * sizeof(float));
+    AUDIOGEN_CHECK(out_.good());
+}
+
+void DitCaptureWriter::write_step(uint32_t step, float t, const float* x, const float* out) {
+    out_.write(reinterpret_cast<const char*>(&step), sizeof(step));
+    out_.write(reinterpret_cast<const char*>(&t), sizeof(t));
+    out_.write(reinterpret_cast<const char*>(x), x_num_elems_ * sizeof(float));
+    out_.write(reinterpret_cast<const char*>(out), x_num_elems_ * sizeof(float));
+    out_.flush();
+    AUDIOGEN_CHECK(out_.good());
+    num_steps_++;
+}
+
+bool read_dit_capture(const std::string& path, DitCapture& capture) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        fprintf(stderr, "ERROR: Cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    char magic[8] = {};
+    uint32_t version = 0;
+    uint32_t reserved = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&reserved), sizeof(reserved));
+    if (!in.good() || memcmp(magic, k_dit_capture_magic, sizeof(magic)) != 0) {
+        fprintf(stderr, "ERROR: %s is not a DiT capture file\n", path.c_str());
+        return false;
+    }
+    if (version != k_dit_capture_version) {
+        fprintf(stderr, "ERROR: %s has version %u, expected %u\n", path.c_str(), version, k_dit_capture_version);
+        return false;
+    }
+
+    if (!read_dims(in, capture.x_dims) || !read_dims(in, capture.cross_attn_dims) || !read_dims(in, capture.global_cond_dims) ||
+        !read_floats(in, capture.cross_attn_cond, num_elems(capture.cross_attn_dims)) ||
+        !read_floats(in, capture.global_cond, num_elems(capture.global_cond_dims))) {
+        fprintf(stderr, "ERROR: %s is truncated\n", path.c_str());
+        return false;
+    }
+
+    const size_t x_num_elems = num_elems(capture.x_dims);
+    capture.steps.clear();
+    for (;;) {
+        DitCaptureStep step;
+        in.read(reinterpret_cast<char*>(&step.step), sizeof(step.step));
+        if (in.gcount() == 0) {
+            break;
+        }
+        in.read(reinterpret_cast<char*>(&step.t), sizeof(step.t));
+        if (!in.good() || !read_floats(in, step.x, x_num_elems) || !read_floats(in, step.out, x_num_elems)) {
+            fprintf(stderr, "ERROR: %s is truncated after %zu steps\n", path.c_str(), capture.steps.size());
+            return false;
+        }
+        capture.steps.push_back(std::move(step));
+    }
+    return true;
+}
+
+} // namespace audiogen
@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "backend.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace audiogen {
+
+// -- DiT capture file (.ditcap)
+// The inputs and the output of the DiT at every step of a generation, to benchmark the DiT alone on
+// real data (see dit_replay.cpp). The tensors are stored by role rather than by index, so a capture
+// can be replayed with another backend. Little-endian, all the tensors in float32:
+//
+//   offset  size  field
+//        0     8  magic "AGDITCAP"
+//        8     4  version (1)
+//       12     4  reserved (0)
+//       16    96  dims of x, cross_attn_cond and global_cond: 4 x int64 each, unused dims set to 0
+//      112     .  cross_attn_cond, then global_cond, constant over the generation
+//        .     .  one record per step up to the end of the file: step (uint32), t (float32), x,
+//                 then the DiT output, with the shape of x
+struct DitCaptureStep {
+    uint32_t step = 0;
+    float t = 0.0f;
+    std::vector<float> x;
+    std::vector<float> out;
+};
+
+struct DitCapture {
+    std::vector<int64_t> x_dims;
+    std::vector<int64_t> cross_attn_dims;
+    std::vector<int64_t> global_cond_dims;
+    std::vector<float> cross_attn_cond;
+    std::vector<float> global_cond;
+    std::vector<DitCaptureStep> steps;
+};
+
+// Returns false (and prints the reason) if the file cannot be read or is not a capture file
+bool read_dit_capture(const std::string& path, DitCapture& capture);
+
+// Written step by step during the diffusion
+class DitCaptureWriter {
+public:
+    DitCaptureWriter(const std::string& path, const TensorView& x, const TensorView& cross_attn_cond,
+                     const TensorView& global_cond);
+
+    // x and out have the shape of the x given to the constructor
+    void write_step(uint32_t step, float t, const float* x, const float* out);
+
+    size_t num_steps() const { return num_steps_; }
+
+private:
+    std::ofstream out_;
+    size_t x_num_elems_ = 0;
+    size_t num_steps_ = 0;
+};
+
+} // namespace audiogen
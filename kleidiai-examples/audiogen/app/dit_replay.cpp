@@ -0,0 +1,220 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Benchmark of the DiT alone, on the inputs captured during a real generation (audiogen --capture-dit).
+// Each step of the capture is replayed with the same x, t and conditioning, so kernel changes are
+// measured on the data the model actually sees, without T5, the sampler or the autoencoder. The output
+// is compared with the captured one, to catch kernels changing the numerics along the way.
+
+#include "backend.h"
+#include "common.h"
+#include "dit_capture.h"
+#include "pipeline.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace audiogen;
+
+namespace {
+
+struct ReplayArgs {
+    std::string models_base_path = "";
+    std::string capture_file     = "";
+    size_t num_threads           = 0;
+    std::string backend          = AUDIOGEN_DEFAULT_BACKEND;
+    size_t num_repeats           = 10;
+    size_t num_warmup            = 1;
+    long step                    = -1;
+    float tolerance              = 1e-3f;
+};
+
+void print_usage(const char* name) {
+    fprintf(stderr,
+        "Usage: %s -m <models_base_path> -c <capture_file> -t <num_threads> [options]\n\n"
+        "Options:\n"
+        "  -m <models_base_path>   Path to model files, only the DiT is loaded\n"
+        "  -c <capture_file>       Capture written by audiogen --capture-dit\n"
+        "  -t <num_threads>        Number of CPU threads to use\n"
+        "  -b <backend>            (Optional) Inference backend (default: %s)\n"
+        "  -r <num_repeats>        (Optional) Timed invokes per step (default: 10)\n"
+        "  --warmup <num_invokes>  (Optional) Untimed invokes per step before the timed ones (default: 1)\n"
+        "  --step <step>           (Optional) Replay this step of the capture only\n"
+        "  --tolerance <value>     (Optional) Largest relative error of the output against the capture (default: 1e-3)\n"
+        "  -h                      Show this help message\n",
+        name, AUDIOGEN_DEFAULT_BACKEND);
+}
+
+// Returns false on -h or on an unknown or incomplete option
+bool parse_args(int argc, char** argv, ReplayArgs& args) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* value = argv[++i];
+
+        if (strcmp(arg, "-m") == 0) {
+            args.models_base_path = value;
+        } else if (strcmp(arg, "-c") == 0) {
+            args.capture_file = value;
+        } else if (strcmp(arg, "-t") == 0) {
+            args.num_threads = std::stoul(value);
+        } else if (strcmp(arg, "-b") == 0) {
+            args.backend = value;
+        } else if (strcmp(arg, "-r") == 0) {
+            args.num_repeats = std::max<size_t>(1, std::stoul(value));
+        } else if (strcmp(arg, "--warmup") == 0) {
+            args.num_warmup = std::stoul(value);
+        } else if (strcmp(arg, "--step") == 0) {
+            args.step = std::stol(value);
+        } else if (strcmp(arg, "--tolerance") == 0) {
+            args.tolerance = std::stof(value);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks the shape of a DiT input against the captured one, and copies the data in
+bool fill_input(const char* name, const TensorView& input, const std::vector<int64_t>& dims, const float* data) {
+    if (input.type != DataType::Float32 || input.dims != dims) {
+        fprintf(stderr, "ERROR: The %s input of the DiT does not have the shape of the capture\n", name);
+        return false;
+    }
+    memcpy(input.data, data, input.num_elems() * sizeof(float));
+    return true;
+}
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    const size_t mid = values.size() / 2;
+    return values.size() % 2 != 0 ? values[mid] : 0.5 * (values[mid - 1] + values[mid]);
+}
+
+} // namespace
+
+int main(int32_t argc, char** argv) {
+    ReplayArgs args;
+    if (!parse_args(argc, argv, args)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (args.models_base_path.empty() || args.capture_file.empty() || args.num_threads == 0) {
+        fprintf(stderr, "ERROR: Missing required arguments.\n\n");
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    DitCapture capture;
+    if (!read_dit_capture(args.capture_file, capture)) {
+        return EXIT_FAILURE;
+    }
+    if (capture.steps.empty()) {
+        fprintf(stderr, "ERROR: No step in %s\n", args.capture_file.c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::unique_ptr<Backend> backend = create_backend(args.backend, args.num_threads);
+    if (backend == nullptr) {
+        fprintf(stderr, "ERROR: Backend not available in this build: %s\n", args.backend.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // The pipeline hands the DiT its own arena as well, so the invokes run on the same memory plan
+    const std::string dit_path = backend->model_path(args.models_base_path, ModelKind::DiT);
+    std::unique_ptr<MemoryArena> arena;
+    const size_t arena_size = backend->planned_memory_size(dit_path);
+    if (arena_size > 0) {
+        arena = std::make_unique<MemoryArena>(arena_size, backend->memory_options());
+    }
+    std::unique_ptr<Model> dit = backend->load_model(dit_path, ModelKind::DiT, arena.get());
+    AUDIOGEN_CHECK(dit != nullptr);
+
+    // The capture stores the tensors by role, they are bound to the indices of this backend
+    const TensorLayout& layout = backend->layout();
+    const TensorView x_in = dit->input(layout.dit_x_in_idx);
+    const TensorView t_in = dit->input(layout.dit_t_in_idx);
+    const TensorView out = dit->output(layout.dit_out_idx);
+    if (!fill_input("cross_attn_cond", dit->input(layout.dit_crossattn_in_idx), capture.cross_attn_dims, capture.cross_attn_cond.data()) ||
+        !fill_input("global_cond", dit->input(layout.dit_globalcond_in_idx), capture.global_cond_dims, capture.global_cond.data())) {
+        return EXIT_FAILURE;
+    }
+    if (out.num_elems() != x_in.num_elems()) {
+        fprintf(stderr, "ERROR: The output of the DiT does not have the shape of x\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("Replaying %s with %s (%zu threads), %zu warmup + %zu timed invokes per step\n",
+           args.capture_file.c_str(), backend->name(), args.num_threads, args.num_warmup, args.num_repeats);
+    printf("%6s %10s %12s %12s %14s\n", "step", "t", "median (ms)", "min (ms)", "rel. error");
+
+    std::vector<double> step_medians_ms;
+    float max_error = 0.0f;
+    std::vector<double> times_ms(args.num_repeats);
+
+    for (const DitCaptureStep& step : capture.steps) {
+        if (args.step >= 0 && static_cast<long>(step.step) != args.step) {
+            continue;
+        }
+        // The DiT may write to its inputs, so they are filled again before every invoke
+        for (size_t i = 0; i < args.num_warmup + args.num_repeats; ++i) {
+            if (!fill_input("x", x_in, capture.x_dims, step.x.data())) {
+                return EXIT_FAILURE;
+            }
+            *t_in.as<float>() = step.t;
+
+            const long long start = time_in_ns();
+            AUDIOGEN_CHECK(dit->invoke());
+            if (i >= args.num_warmup) {
+                times_ms[i - args.num_warmup] = (time_in_ns() - start) / 1e6;
+            }
+        }
+
+        const float error = relative_change(out.as<float>(), step.out.data(), out.num_elems());
+        max_error = std::max(max_error, error);
+        step_medians_ms.push_back(median(times_ms));
+        printf("%6u %10.6f %12.3f %12.3f %14.3e\n", step.step, step.t, step_medians_ms.back(),
+               *std::min_element(times_ms.begin(), times_ms.end()), error);
+    }
+
+    if (step_medians_ms.empty()) {
+        fprintf(stderr, "ERROR: Step %ld is not in the capture\n", args.step);
+        return EXIT_FAILURE;
+    }
+
+    double total_ms = 0.0;
+    for (const double ms : step_medians_ms) {
+        total_ms += ms;
+    }
+    printf("\n%zu steps: %.3f ms per step, %.3f ms in total (medians), largest relative error %.3e\n",
+           step_medians_ms.size(), total_ms / step_medians_ms.size(), total_ms, max_error);
+
+    if (max_error > args.tolerance) {
+        fprintf(stderr, "ERROR: The output differs from the capture by more than %g\n", args.tolerance);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
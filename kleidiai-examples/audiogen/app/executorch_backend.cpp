@@ -0,0 +1,371 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(ET_USE_THREADPOOL)
+#include <executorch/extension/threadpool/cpuinfo_utils.h>
+#include <executorch/extension/threadpool/threadpool.h>
+#endif
+
+#include <executorch/extension/data_loader/buffer_data_loader.h>
+#include <executorch/extension/data_loader/file_data_loader.h>
+#include <executorch/extension/memory_allocator/malloc_memory_allocator.h>
+#include <executorch/extension/tensor/tensor.h>
+#include <executorch/runtime/core/exec_aten/exec_aten.h>
+#include <executorch/runtime/core/hierarchical_allocator.h>
+#include <executorch/runtime/core/memory_allocator.h>
+#include <executorch/runtime/executor/memory_manager.h>
+#include <executorch/runtime/executor/method.h>
+#include <executorch/runtime/executor/program.h>
+#include <executorch/runtime/platform/log.h>
+#include <executorch/runtime/platform/runtime.h>
+
+#include <map>
+#include <mutex>
+
+#include "backend.h"
+#include "common.h"
+
+using executorch::aten::ScalarType;
+using executorch::extension::BufferDataLoader;
+using executorch::extension::FileDataLoader;
+using executorch::extension::MallocMemoryAllocator;
+using executorch::extension::TensorPtr;
+using executorch::runtime::DataLoader;
+using executorch::runtime::Error;
+using executorch::runtime::HierarchicalAllocator;
+using executorch::runtime::MemoryAllocator;
+using executorch::runtime::MemoryManager;
+using executorch::runtime::Method;
+using executorch::runtime::MethodMeta;
+using executorch::runtime::Program;
+using executorch::runtime::Span;
+using executorch::runtime::TensorInfo;
+
+namespace audiogen {
+namespace {
+
+// -- Update the tensor index based on your model configuration.
+constexpr TensorLayout k_executorch_layout = {
+    /* t5_ids_in_idx         */ 0,
+    /* t5_attnmask_in_idx    */ 1,
+    /* t5_audio_len_in_idx   */ 2,
+    /* t5_crossattn_out_idx  */ 0,
+    /* t5_globalcond_out_idx */ 2,
+
+    /* dit_x_in_idx          */ 0,
+    /* dit_t_in_idx          */ 1,
+    /* dit_crossattn_in_idx  */ 2,
+    /* dit_globalcond_in_idx */ 3,
+    /* dit_out_idx           */ 0,
+};
+
+static DataType to_data_type(ScalarType type) {
+    switch (type) {
+        case ScalarType::Float: return DataType::Float32;
+        case ScalarType::Int:   return DataType::Int32;
+        case ScalarType::Long:  return DataType::Int64;
+        default:
+            AUDIOGEN_CHECK(false && "Unsupported tensor type");
+    }
+    return DataType::Float32;
+}
+
+static std::vector<executorch::aten::SizesType> get_tensor_dims(const TensorInfo& tensor_info) {
+    std::vector<executorch::aten::SizesType> tensor_dims(tensor_info.sizes().begin(), tensor_info.sizes().end());
+    return tensor_dims;
+}
+
+// Scratch memory for the kernels, reset by the runtime after each of them
+constexpr size_t k_temp_allocator_size = 4 * 1024 * 1024;
+
+static size_t align_size(size_t size) {
+    return (size + MemoryArena::k_alignment - 1) / MemoryArena::k_alignment * MemoryArena::k_alignment;
+}
+
+// The buffer must outlive the data loader, which must outlive the program, which must outlive its methods
+struct LoadedProgram {
+    std::unique_ptr<PageBuffer> buffer;
+    std::unique_ptr<DataLoader> loader;
+    std::unique_ptr<Program> program;
+};
+
+static LoadedProgram load_program(const std::string& path, const MemoryOptions& memory_options) {
+    LoadedProgram loaded;
+
+    if (memory_options.enabled()) {
+        // The program data (and the weights of the non-delegated operators) is read into
+        // an anonymous buffer, which can be backed by huge pages, unlike the page cache
+        loaded.buffer = read_file(path, memory_options);
+        loaded.loader = std::make_unique<BufferDataLoader>(loaded.buffer->data(), loaded.buffer->size());
+    } else {
+        auto loader_res = FileDataLoader::from(path.c_str());
+        if (!loader_res.ok()) {
+            ET_LOG(Error, "Failed to open the model (%s)", path.c_str());
+            exit(EXIT_FAILURE);
+        }
+        loaded.loader = std::make_unique<FileDataLoader>(std::move(loader_res.get()));
+    }
+
+    auto program_res = Program::load(loaded.loader.get());
+    if (!program_res.ok()) {
+        ET_LOG(Error, "Failed to load the program (%s)", path.c_str());
+        exit(EXIT_FAILURE);
+    }
+    loaded.program = std::make_unique<Program>(std::move(program_res.get()));
+    return loaded;
+}
+
+static MethodMeta get_forward_meta(const Program& program, const std::string& path) {
+    auto forward_meta_res = program.method_meta("forward");
+    if (!forward_meta_res.ok()) {
+        ET_LOG(Error, "Failed to get method meta for 'forward' (%s)", path.c_str());
+        exit(EXIT_FAILURE);
+    }
+    return forward_meta_res.get();
+}
+
+// Arena bytes needed by the "forward" method: the planned buffers, the temp allocator
+// and the inputs/outputs that have not been memory-planned at export time
+static size_t method_memory_size(const MethodMeta& forward_meta) {
+    size_t size = align_size(k_temp_allocator_size);
+
+    for (size_t i = 0; i < forward_meta.num_memory_planned_buffers(); ++i) {
+        size += align_size(static_cast<size_t>(forward_meta.memory_planned_buffer_size(i).get()));
+    }
+    for (size_t i = 0; i < forward_meta.num_inputs(); ++i) {
+        const auto input_tensor_meta = forward_meta.input_tensor_meta(i).get();
+        if (!input_tensor_meta.is_memory_planned()) {
+            size += align_size(input_tensor_meta.nbytes());
+        }
+    }
+    for (size_t i = 0; i < forward_meta.num_outputs(); ++i) {
+        const auto output_tensor_meta = forward_meta.output_tensor_meta(i).get();
+        if (!output_tensor_meta.is_memory_planned()) {
+            size += align_size(output_tensor_meta.nbytes());
+        }
+    }
+    return size;
+}
+
+static void* allocate_or_die(MemoryArena& arena, size_t size, const std::string& path) {
+    void* ptr = arena.allocate(size);
+    if (ptr == nullptr) {
+        ET_LOG(Error, "Memory arena exhausted while loading the model (%s)", path.c_str());
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+// Runs the "forward" method through the runtime API rather than the Module extension:
+// Module::execute() returns the outputs in a std::vector, i.e. one heap allocation per
+// call. Here every buffer (activations, inputs, outputs and kernel scratch memory) is
+// carved out of the MemoryArena when the model is loaded, so invoke() does not allocate.
+class ExecuTorchModel : public Model {
+public:
+    ExecuTorchModel(const std::string& path, LoadedProgram loaded, MemoryArena* arena, const MemoryOptions& memory_options)
+        : loaded_(std::move(loaded)) {
+        const MethodMeta forward_meta = get_forward_meta(*loaded_.program, path);
+
+        // Without a caller-provided arena, the model owns one sized for it
+        if (arena == nullptr) {
+            owned_arena_ = std::make_unique<MemoryArena>(method_memory_size(forward_meta), memory_options);
+            arena = owned_arena_.get();
+        }
+
+        // Memory-planned buffers (activations, and the inputs/outputs planned at export time)
+        const size_t num_planned_buffers = forward_meta.num_memory_planned_buffers();
+        for (size_t i = 0; i < num_planned_buffers; ++i) {
+            const size_t buffer_size = static_cast<size_t>(forward_meta.memory_planned_buffer_size(i).get());
+            planned_spans_.emplace_back(static_cast<uint8_t*>(allocate_or_die(*arena, buffer_size, path)), buffer_size);
+        }
+        planned_memory_ = std::make_unique<HierarchicalAllocator>(
+            Span<Span<uint8_t>>(planned_spans_.data(), planned_spans_.size()));
+
+        temp_allocator_ = std::make_unique<MemoryAllocator>(
+            static_cast<uint32_t>(k_temp_allocator_size),
+            static_cast<uint8_t*>(allocate_or_die(*arena, k_temp_allocator_size, path)));
+
+        // The method allocator only serves the load of the method (the instructions, the EValues
+        // and the delegate handles), so it can stay on the heap
+        memory_manager_ = std::make_unique<MemoryManager>(&method_allocator_, planned_memory_.get(), temp_allocator_.get());
+
+        auto method_res = loaded_.program->load_method("forward", memory_manager_.get());
+        if (!method_res.ok()) {
+            ET_LOG(Error, "Failed to load method 'forward' (%s)", path.c_str());
+            exit(EXIT_FAILURE);
+        }
+        method_ = std::make_unique<Method>(std::move(method_res.get()));
+
+        // Bind the inputs and outputs which have not been memory-planned to arena buffers,
+        // so the caller can fill the inputs in place before every invoke()
+        for (size_t i = 0; i < forward_meta.num_inputs(); ++i) {
+            const auto input_tensor_meta = forward_meta.input_tensor_meta(i).get();
+            if (input_tensor_meta.is_memory_planned()) {
+                continue;
+            }
+            void* buffer = allocate_or_die(*arena, input_tensor_meta.nbytes(), path);
+            std::fill_n(static_cast<uint8_t*>(buffer), input_tensor_meta.nbytes(), 0);
+            input_tensors_.push_back(executorch::extension::from_blob(
+                buffer, get_tensor_dims(input_tensor_meta), input_tensor_meta.scalar_type()));
+            AUDIOGEN_CHECK(method_->set_input(*input_tensors_.back(), i) == Error::Ok);
+        }
+
+        for (size_t i = 0; i < forward_meta.num_outputs(); ++i) {
+            const auto output_tensor_meta = forward_meta.output_tensor_meta(i).get();
+            if (output_tensor_meta.is_memory_planned()) {
+                continue;
+            }
+            void* buffer = allocate_or_die(*arena, output_tensor_meta.nbytes(), path);
+            AUDIOGEN_CHECK(method_->set_output_data_ptr(buffer, output_tensor_meta.nbytes(), i) == Error::Ok);
+        }
+
+        ET_LOG(Info, "Model (%s) loaded", path.c_str());
+    }
+
+    size_t num_inputs() const override {
+        return method_->inputs_size();
+    }
+
+    size_t num_outputs() const override {
+        return method_->outputs_size();
+    }
+
+    TensorView input(size_t idx) override {
+        return view(method_->mutable_input(idx).toTensor());
+    }
+
+    TensorView output(size_t idx) override {
+        return view(method_->get_output(idx).toTensor());
+    }
+
+    bool invoke() override {
+        return method_->execute() == Error::Ok;
+    }
+
+private:
+    static TensorView view(const executorch::aten::Tensor& tensor) {
+        TensorView tensor_view;
+        tensor_view.data = tensor.mutable_data_ptr();
+        tensor_view.type = to_data_type(tensor.scalar_type());
+        tensor_view.dims.assign(tensor.sizes().begin(), tensor.sizes().end());
+        return tensor_view;
+    }
+
+    // Declared in dependency order, so that the method is destroyed first
+    LoadedProgram loaded_;
+    std::unique_ptr<MemoryArena> owned_arena_;
+    MallocMemoryAllocator method_allocator_;
+    std::vector<Span<uint8_t>> planned_spans_;
+    std::unique_ptr<HierarchicalAllocator> planned_memory_;
+    std::unique_ptr<MemoryAllocator> temp_allocator_;
+    std::unique_ptr<MemoryManager> memory_manager_;
+    std::vector<TensorPtr> input_tensors_;
+    std::unique_ptr<Method> method_;
+};
+
+class ExecuTorchBackend : public Backend {
+public:
+    explicit ExecuTorchBackend(size_t num_threads) {
+        // The Module extension does it on our behalf, the runtime API does not
+        executorch::runtime::runtime_init();
+
+#if defined(ET_USE_THREADPOOL)
+        uint32_t num_performant_cores = num_threads == 0
+          ? ::executorch::extension::cpuinfo::get_num_performant_cores()
+          : static_cast<uint32_t>(num_threads);
+        // The threadpool is global to the process: when several backends are created (one per
+        // worker in throughput mode), it is only sized once, before any of them runs a model.
+        // Its threads inherit the affinity of the thread creating it, so the throughput mode
+        // only allows several workers with one thread each (see audiogen.cpp)
+        static std::once_flag threadpool_once;
+        std::call_once(threadpool_once, [num_performant_cores]() {
+            ET_LOG(
+              Info, "Resetting threadpool with num threads = %d", num_performant_cores);
+            if (num_performant_cores > 0) {
+            ::executorch::extension::threadpool::get_threadpool()
+                ->_unsafe_reset_threadpool(num_performant_cores);
+            }
+        });
+#else
+        uint32_t num_performant_cores = 4;
+#endif
+        ET_LOG(Info, "Using %d threads", num_performant_cores);
+    }
+
+    const char* name() const override {
+        return "executorch";
+    }
+
+    const TensorLayout& layout() const override {
+        return k_executorch_layout;
+    }
+
+    std::string model_path(const std::string& models_base_path, ModelKind kind) const override {
+        switch (kind) {
+            case ModelKind::Conditioners: return models_base_path + "/conditioners_model.pte";
+            case ModelKind::DiT:          return models_base_path + "/dit_model.pte";
+            case ModelKind::Decoder:      return models_base_path + "/autoencoder_model.pte";
+            case ModelKind::Encoder:      return models_base_path + "/autoencoder_encoder_model.pte";
+        }
+        return "";
+    }
+
+    std::string conditioners_bucket_path(const std::string& models_base_path, size_t seq_len) const override {
+        return models_base_path + "/conditioners_model_L" + std::to_string(seq_len) + ".pte";
+    }
+
+    // The program is kept, so that load_model() does not parse the file a second time
+    size_t planned_memory_size(const std::string& path) override {
+        std::lock_guard<std::mutex> lock(programs_mutex_);
+        auto it = programs_.find(path);
+        if (it == programs_.end()) {
+            it = programs_.emplace(path, load_program(path, memory_options_)).first;
+        }
+        return method_memory_size(get_forward_meta(*it->second.program, path));
+    }
+
+    std::unique_ptr<Model> load_model(const std::string& path, ModelKind, MemoryArena* arena) override {
+        LoadedProgram loaded;
+        {
+            std::lock_guard<std::mutex> lock(programs_mutex_);
+            auto it = programs_.find(path);
+            if (it != programs_.end()) {
+                loaded = std::move(it->second);
+                programs_.erase(it);
+            }
+        }
+        if (loaded.program == nullptr) {
+            loaded = load_program(path, memory_options_);
+        }
+
+        // The precision of each submodule is decided when exporting the .pte file
+        return std::make_unique<ExecuTorchModel>(path, std::move(loaded), arena, memory_options_);
+    }
+
+private:
+    std::mutex programs_mutex_;
+    std::map<std::string, LoadedProgram> programs_;
+};
+
+} // namespace
+
+std::unique_ptr<Backend> create_executorch_backend(size_t num_threads) {
+    return std::make_unique<ExecuTorchBackend>(num_threads);
+}
+
+} // namespace audiogen
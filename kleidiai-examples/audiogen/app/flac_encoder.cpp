@@ -0,0 +1,835 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flac_encoder.h"
+#include "audio_io.h"
+#include "common.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace audiogen {
+namespace {
+
+constexpr uint32_t k_num_channels = 2;
+constexpr uint32_t k_max_fixed_order = 4;
+constexpr uint32_t k_max_lpc_order = 32;
+constexpr uint32_t k_max_partition_order = 8;
+constexpr uint32_t k_max_rice_param = 14;       // 4-bit parameters, 15 is the escape code
+constexpr uint32_t k_max_rice2_param = 30;      // 5-bit parameters, 31 is the escape code
+constexpr uint32_t k_max_qlp_shift = 15;
+constexpr size_t k_frames_per_thread = 4;       // Frames encoded per thread in each batch
+
+// Channel assignments of the frame header
+constexpr uint32_t k_channels_independent = 1;
+constexpr uint32_t k_channels_left_side   = 8;
+constexpr uint32_t k_channels_side_right  = 9;
+constexpr uint32_t k_channels_mid_side    = 10;
+
+// -- Bit writer, MSB first
+class BitWriter {
+public:
+    // num_bits <= 32
+    void put(uint32_t num_bits, uint64_t value) {
+        if (num_bits == 0) {
+            return;
+        }
+        acc_ = (acc_ << num_bits) | (value & ((uint64_t(1) << num_bits) - 1));
+        acc_bits_ += num_bits;
+        while (acc_bits_ >= 8) {
+            acc_bits_ -= 8;
+            bytes_.push_back(static_cast<uint8_t>(acc_ >> acc_bits_));
+        }
+    }
+
+    void put_signed(uint32_t num_bits, int64_t value) {
+        put(num_bits, static_cast<uint64_t>(value));
+    }
+
+    // num_zeros zero bits followed by a one
+    void put_unary(uint32_t num_zeros) {
+        while (num_zeros >= 32) {
+            put(32, 0);
+            num_zeros -= 32;
+        }
+        put(num_zeros + 1, 1);
+    }
+
+    void put_rice(uint32_t param, uint32_t value) {
+        put_unary(value >> param);
+        put(param, value);
+    }
+
+    void align() {
+        if (acc_bits_ != 0) {
+            put(8 - acc_bits_, 0);
+        }
+    }
+
+    std::vector<uint8_t>& bytes() { return bytes_; }
+
+private:
+    uint64_t acc_ = 0;
+    uint32_t acc_bits_ = 0;
+    std::vector<uint8_t> bytes_;
+};
+
+static uint8_t crc8(const uint8_t* data, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int32_t b = 0; b < 8; ++b) {
+            crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07) : static_cast<uint8_t>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t* data, size_t size) {
+    static const std::vector<uint16_t> table = []() {
+        std::vector<uint16_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint16_t crc = static_cast<uint16_t>(i << 8);
+            for (int32_t b = 0; b < 8; ++b) {
+                crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x8005) : static_cast<uint16_t>(crc << 1);
+            }
+            t[i] = crc;
+        }
+        return t;
+    }();
+
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc = static_cast<uint16_t>((crc << 8) ^ table[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+static inline uint32_t zigzag(int32_t x) {
+    return (static_cast<uint32_t>(x) << 1) ^ static_cast<uint32_t>(x >> 31);
+}
+
+// -- Subframes
+enum class SubframeType {
+    Constant,
+    Verbatim,
+    Fixed,
+    Lpc,
+};
+
+struct Subframe {
+    SubframeType type = SubframeType::Verbatim;
+    uint32_t bps = 0;
+    uint32_t order = 0;
+
+    // LPC only
+    std::vector<int32_t> qlp_coeffs;
+    uint32_t qlp_precision = 0;
+    int32_t qlp_shift = 0;
+
+    // Fixed and LPC only, one residual per sample after the warm-up samples
+    std::vector<int32_t> residual;
+    uint32_t partition_order = 0;
+    std::vector<uint32_t> rice_params;
+    bool rice2 = false;
+
+    uint64_t bits = 0;  // Estimated size
+};
+
+// Rice parameter minimizing the size of a partition, given the sum of its zigzag-coded residuals
+static uint32_t best_rice_param(uint64_t sum, uint64_t count, uint64_t& bits) {
+    if (count == 0) {
+        bits = 0;
+        return 0;
+    }
+    uint32_t param = 0;
+    while (param < k_max_rice2_param && (count << (param + 1)) < sum) {
+        param++;
+    }
+    // Estimated as count * (param + 1) + sum >> param, like libFLAC
+    bits = count * (param + 1) + (sum >> param);
+    if (param > 0) {
+        const uint64_t lower_bits = count * param + (sum >> (param - 1));
+        if (lower_bits < bits) {
+            bits = lower_bits;
+            param--;
+        }
+    }
+    return param;
+}
+
+// Choose the partition order and the Rice parameters of the residual of a block of block_size samples
+static uint64_t plan_residual(Subframe& subframe, uint32_t block_size) {
+    const uint32_t order = subframe.order;
+
+    uint32_t max_partition_order = 0;
+    while (max_partition_order < k_max_partition_order &&
+           block_size % (1u << (max_partition_order + 1)) == 0 &&
+           (block_size >> (max_partition_order + 1)) > order) {
+        max_partition_order++;
+    }
+
+    // Sums of the finest partitions, then merged two by two
+    std::vector<uint64_t> sums(1u << max_partition_order, 0);
+    const uint32_t finest_size = block_size >> max_partition_order;
+    for (uint32_t i = order; i < block_size; ++i) {
+        sums[i / finest_size] += zigzag(subframe.residual[i - order]);
+    }
+
+    uint64_t best_bits = UINT64_MAX;
+    for (int32_t p = static_cast<int32_t>(max_partition_order); p >= 0; --p) {
+        const uint32_t num_partitions = 1u << p;
+        const uint32_t partition_size = block_size >> p;
+
+        std::vector<uint32_t> params(num_partitions);
+        uint64_t bits = 0;
+        bool rice2 = false;
+        for (uint32_t i = 0; i < num_partitions; ++i) {
+            const uint64_t count = partition_size - (i == 0 ? order : 0);
+            uint64_t partition_bits = 0;
+            params[i] = best_rice_param(sums[i], count, partition_bits);
+            rice2 |= params[i] > k_max_rice_param;
+            bits += partition_bits;
+        }
+        bits += num_partitions * (rice2 ? 5 : 4) + 2 + 4;
+
+        if (bits < best_bits) {
+            best_bits = bits;
+            subframe.partition_order = static_cast<uint32_t>(p);
+            subframe.rice_params = params;
+            subframe.rice2 = rice2;
+        }
+
+        // Merge the partitions for the next order
+        for (uint32_t i = 0; i < num_partitions / 2; ++i) {
+            sums[i] = sums[2 * i] + sums[2 * i + 1];
+        }
+    }
+    return best_bits;
+}
+
+// Residual of the fixed polynomial predictor. The intermediate values stay within 32 bits
+// for samples of up to 25 bits (the side channel of 24-bit audio), and the loops vectorize.
+static void fixed_residual(const int32_t* x, uint32_t n, uint32_t order, int32_t* residual) {
+    switch (order) {
+        case 0:
+            for (uint32_t i = 0; i < n; ++i) residual[i] = x[i];
+            break;
+        case 1:
+            for (uint32_t i = 1; i < n; ++i) residual[i - 1] = x[i] - x[i - 1];
+            break;
+        case 2:
+            for (uint32_t i = 2; i < n; ++i) residual[i - 2] = x[i] - 2 * x[i - 1] + x[i - 2];
+            break;
+        case 3:
+            for (uint32_t i = 3; i < n; ++i) residual[i - 3] = x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+            break;
+        case 4:
+            for (uint32_t i = 4; i < n; ++i) residual[i - 4] = x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+            break;
+    }
+}
+
+// Returns false if a residual does not fit in 32 bits
+static bool lpc_residual(const int32_t* x, uint32_t n, const std::vector<int32_t>& qlp_coeffs, int32_t shift, int32_t* residual) {
+    const uint32_t order = static_cast<uint32_t>(qlp_coeffs.size());
+    for (uint32_t i = order; i < n; ++i) {
+        int64_t sum = 0;
+        for (uint32_t j = 0; j < order; ++j) {
+            sum += static_cast<int64_t>(qlp_coeffs[j]) * x[i - j - 1];
+        }
+        const int64_t r = static_cast<int64_t>(x[i]) - (sum >> shift);
+        if (r > INT32_MAX || r < INT32_MIN) {
+            return false;
+        }
+        residual[i - order] = static_cast<int32_t>(r);
+    }
+    return true;
+}
+
+// Linear prediction coefficients of every order up to max_order (Levinson-Durbin recursion),
+// from the autocorrelation of the windowed signal. lpc[m - 1] holds the m coefficients of order m.
+static bool compute_lpc(const int32_t* x, uint32_t n, uint32_t max_order, std::vector<std::vector<double>>& lpc) {
+    // Welch window
+    std::vector<double> windowed(n);
+    const double half = (static_cast<double>(n) - 1.0) / 2.0;
+    for (uint32_t i = 0; i < n; ++i) {
+        const double w = (static_cast<double>(i) - half) / (half + 1.0);
+        windowed[i] = x[i] * (1.0 - w * w);
+    }
+
+    std::vector<double> autoc(max_order + 1, 0.0);
+    for (uint32_t lag = 0; lag <= max_order; ++lag) {
+        double sum = 0.0;
+        for (uint32_t i = lag; i < n; ++i) {
+            sum += windowed[i] * windowed[i - lag];
+        }
+        autoc[lag] = sum;
+    }
+    if (autoc[0] <= 0.0) {
+        return false;
+    }
+
+    std::vector<double> a(max_order + 1, 0.0);
+    std::vector<double> prev(max_order + 1, 0.0);
+    double err = autoc[0];
+    lpc.clear();
+    for (uint32_t m = 1; m <= max_order; ++m) {
+        double acc = autoc[m];
+        for (uint32_t j = 1; j < m; ++j) {
+            acc -= a[j] * autoc[m - j];
+        }
+        const double k = acc / err;
+
+        prev = a;
+        a[m] = k;
+        for (uint32_t j = 1; j < m; ++j) {
+            a[j] = prev[j] - k * prev[m - j];
+        }
+        err *= (1.0 - k * k);
+
+        lpc.emplace_back(a.begin() + 1, a.begin() + m + 1);
+        if (err <= 0.0) {
+            break;
+        }
+    }
+    return !lpc.empty();
+}
+
+// Quantize the coefficients with the given precision. Returns false if they cannot be represented.
+static bool quantize_lpc(const std::vector<double>& lpc, uint32_t precision, std::vector<int32_t>& qlp_coeffs, int32_t& shift) {
+    double cmax = 0.0;
+    for (const double c : lpc) {
+        cmax = std::max(cmax, std::fabs(c));
+    }
+    if (cmax <= 0.0) {
+        return false;
+    }
+
+    int32_t log2cmax = 0;
+    std::frexp(cmax, &log2cmax);
+    shift = static_cast<int32_t>(precision) - log2cmax - 1;
+    if (shift < 0) {
+        return false;
+    }
+    shift = std::min(shift, static_cast<int32_t>(k_max_qlp_shift));
+
+    const int32_t qmax = (1 << (precision - 1)) - 1;
+    const int32_t qmin = -qmax - 1;
+
+    // Carry the rounding error over to the next coefficient
+    double error = 0.0;
+    qlp_coeffs.resize(lpc.size());
+    for (size_t i = 0; i < lpc.size(); ++i) {
+        error += lpc[i] * static_cast<double>(1 << shift);
+        const int32_t q = std::max(qmin, std::min(qmax, static_cast<int32_t>(std::lround(error))));
+        error -= q;
+        qlp_coeffs[i] = q;
+    }
+    return true;
+}
+
+static Subframe plan_subframe(const int32_t* x, uint32_t n, uint32_t bps, uint32_t max_lpc_order) {
+    Subframe best;
+    best.bps = bps;
+
+    // Constant
+    if (std::all_of(x, x + n, [x](int32_t v) { return v == x[0]; })) {
+        best.type = SubframeType::Constant;
+        best.bits = 8 + bps;
+        return best;
+    }
+
+    // Verbatim
+    best.type = SubframeType::Verbatim;
+    best.bits = 8 + static_cast<uint64_t>(n) * bps;
+
+    // Fixed predictors
+    for (uint32_t order = 0; order <= std::min(k_max_fixed_order, n - 1); ++order) {
+        Subframe candidate;
+        candidate.type = SubframeType::Fixed;
+        candidate.bps = bps;
+        candidate.order = order;
+        candidate.residual.resize(n - order);
+        fixed_residual(x, n, order, candidate.residual.data());
+        candidate.bits = 8 + static_cast<uint64_t>(order) * bps + plan_residual(candidate, n);
+        if (candidate.bits < best.bits) {
+            best = std::move(candidate);
+        }
+    }
+
+    // LPC
+    const uint32_t max_order = std::min(max_lpc_order, n - 1);
+    std::vector<std::vector<double>> lpc;
+    if (max_order == 0 || !compute_lpc(x, n, max_order, lpc)) {
+        return best;
+    }
+
+    const uint32_t precision = bps <= 17 ? 13 : 15;
+    for (const auto& coeffs : lpc) {
+        Subframe candidate;
+        candidate.type = SubframeType::Lpc;
+        candidate.bps = bps;
+        candidate.order = static_cast<uint32_t>(coeffs.size());
+        candidate.qlp_precision = precision;
+        if (!quantize_lpc(coeffs, precision, candidate.qlp_coeffs, candidate.qlp_shift)) {
+            continue;
+        }
+        candidate.residual.resize(n - candidate.order);
+        if (!lpc_residual(x, n, candidate.qlp_coeffs, candidate.qlp_shift, candidate.residual.data())) {
+            continue;
+        }
+        candidate.bits = 8 + static_cast<uint64_t>(candidate.order) * (bps + precision) + 4 + 5 + plan_residual(candidate, n);
+        if (candidate.bits < best.bits) {
+            best = std::move(candidate);
+        }
+    }
+    return best;
+}
+
+static void write_subframe(BitWriter& writer, const Subframe& subframe, const int32_t* x, uint32_t n) {
+    const uint32_t bps = subframe.bps;
+
+    // Zero padding bit, 6-bit type, no wasted bits
+    writer.put(1, 0);
+    switch (subframe.type) {
+        case SubframeType::Constant: writer.put(6, 0x00); break;
+        case SubframeType::Verbatim: writer.put(6, 0x01); break;
+        case SubframeType::Fixed:    writer.put(6, 0x08 | subframe.order); break;
+        case SubframeType::Lpc:      writer.put(6, 0x20 | (subframe.order - 1)); break;
+    }
+    writer.put(1, 0);
+
+    if (subframe.type == SubframeType::Constant) {
+        writer.put_signed(bps, x[0]);
+        return;
+    }
+    if (subframe.type == SubframeType::Verbatim) {
+        for (uint32_t i = 0; i < n; ++i) {
+            writer.put_signed(bps, x[i]);
+        }
+        return;
+    }
+
+    // Warm-up samples
+    for (uint32_t i = 0; i < subframe.order; ++i) {
+        writer.put_signed(bps, x[i]);
+    }
+
+    if (subframe.type == SubframeType::Lpc) {
+        writer.put(4, subframe.qlp_precision - 1);
+        writer.put_signed(5, subframe.qlp_shift);
+        for (const int32_t coeff : subframe.qlp_coeffs) {
+            writer.put_signed(subframe.qlp_precision, coeff);
+        }
+    }
+
+    // Residual: Rice coding, partitioned
+    writer.put(2, subframe.rice2 ? 1 : 0);
+    writer.put(4, subframe.partition_order);
+
+    const uint32_t param_bits = subframe.rice2 ? 5 : 4;
+    const uint32_t partition_size = n >> subframe.partition_order;
+    size_t r = 0;
+    for (size_t p = 0; p < subframe.rice_params.size(); ++p) {
+        const uint32_t param = subframe.rice_params[p];
+        writer.put(param_bits, param);
+
+        const size_t count = partition_size - (p == 0 ? subframe.order : 0);
+        for (size_t i = 0; i < count; ++i, ++r) {
+            writer.put_rice(param, zigzag(subframe.residual[r]));
+        }
+    }
+}
+
+static uint32_t block_size_code(uint32_t block_size) {
+    switch (block_size) {
+        case 192:   return 1;
+        case 576:   return 2;
+        case 1152:  return 3;
+        case 2304:  return 4;
+        case 4608:  return 5;
+        case 256:   return 8;
+        case 512:   return 9;
+        case 1024:  return 10;
+        case 2048:  return 11;
+        case 4096:  return 12;
+        case 8192:  return 13;
+        case 16384: return 14;
+        case 32768: return 15;
+        default:    return block_size <= 256 ? 6 : 7;   // Stored at the end of the header
+    }
+}
+
+static uint32_t sample_rate_code(uint32_t sample_rate) {
+    switch (sample_rate) {
+        case 88200:  return 1;
+        case 176400: return 2;
+        case 192000: return 3;
+        case 8000:   return 4;
+        case 16000:  return 5;
+        case 22050:  return 6;
+        case 24000:  return 7;
+        case 32000:  return 8;
+        case 44100:  return 9;
+        case 48000:  return 10;
+        case 96000:  return 11;
+        default:     return 0;  // From the STREAMINFO block
+    }
+}
+
+// The frame number, coded like a UTF-8 character
+static void write_utf8(BitWriter& writer, uint64_t value) {
+    if (value < 0x80) {
+        writer.put(8, value);
+        return;
+    }
+    uint32_t num_bytes = 2;
+    while (num_bytes < 7 && value >= (uint64_t(1) << (5 * num_bytes + 1))) {
+        num_bytes++;
+    }
+    const uint32_t first_bits = 7 - num_bytes;
+    writer.put(num_bytes + 1, ((1u << num_bytes) - 1) << 1);
+    writer.put(first_bits, value >> (6 * (num_bytes - 1)));
+    for (int32_t i = static_cast<int32_t>(num_bytes) - 2; i >= 0; --i) {
+        writer.put(8, 0x80 | ((value >> (6 * i)) & 0x3F));
+    }
+}
+
+static std::vector<uint8_t> encode_frame(const int32_t* left, const int32_t* right, uint32_t n, uint64_t frame_number,
+                                         uint32_t sample_rate, const FlacOptions& options) {
+    const uint32_t bps = options.bits_per_sample;
+
+    // Stereo decorrelation: keep the cheapest pair of channels
+    std::vector<int32_t> mid(n);
+    std::vector<int32_t> side(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        mid[i] = (left[i] + right[i]) >> 1;
+        side[i] = left[i] - right[i];
+    }
+
+    const Subframe sf_left = plan_subframe(left, n, bps, options.max_lpc_order);
+    const Subframe sf_right = plan_subframe(right, n, bps, options.max_lpc_order);
+    const Subframe sf_mid = plan_subframe(mid.data(), n, bps, options.max_lpc_order);
+    const Subframe sf_side = plan_subframe(side.data(), n, bps + 1, options.max_lpc_order);
+
+    struct Assignment {
+        uint32_t code;
+        const Subframe* first;
+        const int32_t* first_data;
+        const Subframe* second;
+        const int32_t* second_data;
+    };
+    const Assignment assignments[] = {
+        {k_channels_independent, &sf_left, left, &sf_right, right},
+        {k_channels_left_side, &sf_left, left, &sf_side, side.data()},
+        {k_channels_side_right, &sf_side, side.data(), &sf_right, right},
+        {k_channels_mid_side, &sf_mid, mid.data(), &sf_side, side.data()},
+    };
+    const Assignment* best = &assignments[0];
+    for (const auto& assignment : assignments) {
+        if (assignment.first->bits + assignment.second->bits < best->first->bits + best->second->bits) {
+            best = &assignment;
+        }
+    }
+
+    BitWriter writer;
+
+    // Frame header: sync code, fixed block size strategy
+    const uint32_t bs_code = block_size_code(n);
+    const uint32_t sr_code = sample_rate_code(sample_rate);
+    writer.put(15, 0x7FFC);
+    writer.put(1, 0);
+    writer.put(4, bs_code);
+    writer.put(4, sr_code);
+    writer.put(4, best->code);
+    writer.put(3, bps == 16 ? 4 : 6);
+    writer.put(1, 0);
+    write_utf8(writer, frame_number);
+    if (bs_code == 6) {
+        writer.put(8, n - 1);
+    } else if (bs_code == 7) {
+        writer.put(16, n - 1);
+    }
+    writer.put(8, crc8(writer.bytes().data(), writer.bytes().size()));
+
+    write_subframe(writer, *best->first, best->first_data, n);
+    write_subframe(writer, *best->second, best->second_data, n);
+
+    // Frame footer
+    writer.align();
+    writer.put(16, crc16(writer.bytes().data(), writer.bytes().size()));
+    return std::move(writer.bytes());
+}
+
+} // namespace
+
+// -- MD5 of the decoded samples, stored in the STREAMINFO block (RFC 1321)
+struct FlacWriter::Md5 {
+    uint32_t state[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    uint64_t length = 0;
+    uint8_t buffer[64] = {};
+
+    static uint32_t rotl(uint32_t x, uint32_t c) {
+        return (x << c) | (x >> (32 - c));
+    }
+
+    void transform(const uint8_t* block) {
+        static const uint32_t k[64] = {
+            0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+            0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+            0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+            0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+            0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+            0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+            0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+            0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+        static const uint32_t r[64] = {
+            7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+            5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+            4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+            6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+
+        uint32_t w[16];
+        for (int32_t i = 0; i < 16; ++i) {
+            w[i] = block[i * 4] | (block[i * 4 + 1] << 8) | (block[i * 4 + 2] << 16) | (static_cast<uint32_t>(block[i * 4 + 3]) << 24);
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        for (uint32_t i = 0; i < 64; ++i) {
+            uint32_t f, g;
+            if (i < 16) {
+                f = (b & c) | (~b & d);
+                g = i;
+            } else if (i < 32) {
+                f = (d & b) | (~d & c);
+                g = (5 * i + 1) % 16;
+            } else if (i < 48) {
+                f = b ^ c ^ d;
+                g = (3 * i + 5) % 16;
+            } else {
+                f = c ^ (b | ~d);
+                g = (7 * i) % 16;
+            }
+            const uint32_t tmp = d;
+            d = c;
+            c = b;
+            b = b + rotl(a + f + k[i] + w[g], r[i]);
+            a = tmp;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+    }
+
+    void update(const uint8_t* data, size_t size) {
+        size_t used = length % 64;
+        length += size;
+        while (size > 0) {
+            const size_t n = std::min(size, 64 - used);
+            memcpy(buffer + used, data, n);
+            used += n;
+            data += n;
+            size -= n;
+            if (used == 64) {
+                transform(buffer);
+                used = 0;
+            }
+        }
+    }
+
+    void finish(uint8_t digest[16]) {
+        const uint64_t bit_length = length * 8;
+        const uint8_t pad = 0x80;
+        update(&pad, 1);
+        const uint8_t zero = 0;
+        while (length % 64 != 56) {
+            update(&zero, 1);
+        }
+        uint8_t length_bytes[8];
+        for (int32_t i = 0; i < 8; ++i) {
+            length_bytes[i] = static_cast<uint8_t>(bit_length >> (8 * i));
+        }
+        update(length_bytes, 8);
+        for (int32_t i = 0; i < 16; ++i) {
+            digest[i] = static_cast<uint8_t>(state[i / 4] >> (8 * (i % 4)));
+        }
+    }
+};
+
+FlacWriter::FlacWriter(const std::string& path, const FlacOptions& options, uint32_t sample_rate)
+    : options_(options), sample_rate_(sample_rate), out_(path, std::ios::binary), md5_(std::make_unique<Md5>()) {
+    AUDIOGEN_CHECK(out_.is_open());
+    AUDIOGEN_CHECK(options_.bits_per_sample == 16 || options_.bits_per_sample == 24);
+    AUDIOGEN_CHECK(options_.block_size >= 16 && options_.block_size <= 65535);
+    AUDIOGEN_CHECK(options_.max_lpc_order <= k_max_lpc_order);
+
+    if (options_.num_threads == 0) {
+        options_.num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // The STREAMINFO block is rewritten by finish(), once the stream is known
+    const uint8_t header[4 + 4 + 34] = {'f', 'L', 'a', 'C'};
+    out_.write(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+FlacWriter::~FlacWriter() {
+    if (!finished_) {
+        finish();
+    }
+}
+
+void FlacWriter::write(const float* left_ch, const float* right_ch, size_t num_samples) {
+    AUDIOGEN_CHECK(!finished_);
+
+    const uint32_t bps = options_.bits_per_sample;
+    const uint32_t bytes_per_sample = bps / 8;
+    const double scale = static_cast<double>(1 << (bps - 1));
+    const int32_t max_value = (1 << (bps - 1)) - 1;
+    const int32_t min_value = -max_value - 1;
+
+    const float* channels[k_num_channels] = {left_ch, right_ch};
+    for (uint32_t c = 0; c < k_num_channels; ++c) {
+        std::vector<int32_t>& pending = pending_[c];
+        const size_t offset = pending.size();
+        pending.resize(offset + num_samples);
+        for (size_t i = 0; i < num_samples; ++i) {
+            const int64_t v = std::llround(channels[c][i] * scale);
+            pending[offset + i] = static_cast<int32_t>(std::max<int64_t>(min_value, std::min<int64_t>(max_value, v)));
+        }
+    }
+
+    // The MD5 covers the interleaved little-endian samples
+    const size_t offset = pending_[0].size() - num_samples;
+    std::vector<uint8_t> interleaved(num_samples * k_num_channels * bytes_per_sample);
+    uint8_t* dst = interleaved.data();
+    for (size_t i = 0; i < num_samples; ++i) {
+        for (uint32_t c = 0; c < k_num_channels; ++c) {
+            const uint32_t v = static_cast<uint32_t>(pending_[c][offset + i]);
+            for (uint32_t b = 0; b < bytes_per_sample; ++b) {
+                *dst++ = static_cast<uint8_t>(v >> (8 * b));
+            }
+        }
+    }
+    md5_->update(interleaved.data(), interleaved.size());
+    num_samples_ += num_samples;
+
+    // Encode as soon as there are enough complete frames to keep all the threads busy
+    const size_t num_complete_frames = pending_[0].size() / options_.block_size;
+    if (num_complete_frames >= options_.num_threads * k_frames_per_thread) {
+        encode_frames(num_complete_frames);
+    }
+}
+
+void FlacWriter::encode_frames(size_t num_frames) {
+    AUDIOGEN_TRACE("flac_encode", static_cast<int64_t>(num_frames));
+
+    const uint32_t block_size = options_.block_size;
+    const size_t num_pending = pending_[0].size();
+
+    std::vector<std::vector<uint8_t>> frames(num_frames);
+    auto encode_range = [&](size_t first_frame, size_t stride) {
+        for (size_t f = first_frame; f < num_frames; f += stride) {
+            const size_t start = f * block_size;
+            const uint32_t n = static_cast<uint32_t>(std::min<size_t>(block_size, num_pending - start));
+            frames[f] = encode_frame(pending_[0].data() + start, pending_[1].data() + start, n,
+                                     frame_number_ + f, sample_rate_, options_);
+        }
+    };
+
+    const size_t num_threads = std::min<size_t>(options_.num_threads, num_frames);
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t) {
+        threads.emplace_back(encode_range, t, num_threads);
+    }
+    encode_range(0, num_threads);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // The frames are written in order
+    for (const auto& frame : frames) {
+        out_.write(reinterpret_cast<const char*>(frame.data()), frame.size());
+        min_frame_size_ = std::min(min_frame_size_, static_cast<uint32_t>(frame.size()));
+        max_frame_size_ = std::max(max_frame_size_, static_cast<uint32_t>(frame.size()));
+    }
+    frame_number_ += num_frames;
+
+    const size_t num_consumed = std::min(num_pending, num_frames * block_size);
+    for (auto& pending : pending_) {
+        pending.erase(pending.begin(), pending.begin() + num_consumed);
+    }
+}
+
+void FlacWriter::finish() {
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+
+    const size_t num_pending = pending_[0].size();
+    if (num_pending > 0) {
+        encode_frames((num_pending + options_.block_size - 1) / options_.block_size);
+    }
+
+    uint8_t md5[16];
+    md5_->finish(md5);
+
+    BitWriter writer;
+    // Metadata block header: last block, STREAMINFO, 34 bytes
+    writer.put(1, 1);
+    writer.put(7, 0);
+    writer.put(24, 34);
+    writer.put(16, options_.block_size);
+    writer.put(16, options_.block_size);
+    writer.put(24, frame_number_ > 0 ? min_frame_size_ : 0);
+    writer.put(24, max_frame_size_);
+    writer.put(20, sample_rate_);
+    writer.put(3, k_num_channels - 1);
+    writer.put(5, options_.bits_per_sample - 1);
+    writer.put(4, num_samples_ >> 32);
+    writer.put(32, num_samples_ & 0xFFFFFFFF);
+    for (const uint8_t byte : md5) {
+        writer.put(8, byte);
+    }
+
+    out_.seekp(4);
+    out_.write(reinterpret_cast<const char*>(writer.bytes().data()), writer.bytes().size());
+    out_.close();
+    AUDIOGEN_CHECK(!out_.fail());
+}
+
+void save_as_flac(const std::string& path, const float* left_ch, const float* right_ch, size_t buffer_sz,
+                  const FlacOptions& options) {
+    AUDIOGEN_TRACE("save_flac");
+
+    FlacWriter writer(path, options, k_audio_sr);
+
+    // Fed one frame at a time, so that only a batch of frames is converted to integers at once
+    for (size_t offset = 0; offset < buffer_sz; offset += options.block_size) {
+        const size_t num_samples = std::min<size_t>(options.block_size, buffer_sz - offset);
+        writer.write(left_ch + offset, right_ch + offset, num_samples);
+    }
+    writer.finish();
+}
+
+} // namespace audiogen
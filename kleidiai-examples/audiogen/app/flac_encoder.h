@@ -0,0 +1,79 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace audiogen {
+
+struct FlacOptions {
+    uint32_t bits_per_sample = 16;  // 16 or 24
+    uint32_t block_size = 4096;     // Samples per frame
+    uint32_t max_lpc_order = 8;     // 0 to only use the fixed predictors, at most 32
+    uint32_t num_threads = 0;       // Threads encoding the frames, 0 to use all the CPUs
+};
+
+// Streaming FLAC writer for stereo audio. The samples can be appended in chunks of any size as
+// they are produced: the complete frames are encoded in parallel and written straight away,
+// so only a few frames are kept in memory.
+class FlacWriter {
+public:
+    FlacWriter(const std::string& path, const FlacOptions& options, uint32_t sample_rate);
+    ~FlacWriter();
+
+    FlacWriter(const FlacWriter&) = delete;
+    FlacWriter& operator=(const FlacWriter&) = delete;
+
+    // Planar float samples in [-1, 1], clipped outside of this range
+    void write(const float* left_ch, const float* right_ch, size_t num_samples);
+
+    // Encode the last (possibly incomplete) frame and finalize the stream info.
+    // Called by the destructor if needed.
+    void finish();
+
+private:
+    void encode_frames(size_t num_frames);
+
+    FlacOptions options_;
+    uint32_t sample_rate_;
+    std::ofstream out_;
+    bool finished_ = false;
+
+    // Samples waiting for a complete batch of frames
+    std::vector<int32_t> pending_[2];
+
+    uint64_t num_samples_ = 0;
+    uint64_t frame_number_ = 0;
+    uint32_t min_frame_size_ = UINT32_MAX;
+    uint32_t max_frame_size_ = 0;
+
+    struct Md5;
+    std::unique_ptr<Md5> md5_;
+};
+
+// Write two planar channels into a 44.1kHz stereo FLAC file
+void save_as_flac(const std::string& path, const float* left_ch, const float* right_ch, size_t buffer_sz,
+                  const FlacOptions& options = FlacOptions());
+
+} // namespace audiogen
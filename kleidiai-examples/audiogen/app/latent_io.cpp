@@ -0,0 +1,196 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "latent_io.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace audiogen {
+
+constexpr char k_latent_magic[8] = {'A', 'G', 'L', 'A', 'T', 'E', 'N', 'T'};
+constexpr uint32_t k_latent_version = 1;
+constexpr uint32_t k_latent_max_dims = 4;
+constexpr size_t k_latent_data_alignment = 64;
+
+#pragma pack(push, 1)
+struct LatentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t data_offset;
+    uint64_t seed;
+    uint32_t num_steps;
+    uint32_t step;
+    float audio_len_sec;
+    float sigma_max;
+    uint32_t num_dims;
+    uint32_t prompt_len;
+    int64_t dims[k_latent_max_dims];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(LatentHeader) == 80, "The latent header layout is part of the file format");
+
+size_t LatentInfo::num_elems() const {
+    size_t x = 1;
+    for (const auto dim : dims) {
+        x *= static_cast<size_t>(dim);
+    }
+    return x;
+}
+
+void save_latent(const std::string& path, const LatentInfo& info, const float* data) {
+    AUDIOGEN_CHECK(info.dims.size() <= k_latent_max_dims);
+
+    LatentHeader header = {};
+    memcpy(header.magic, k_latent_magic, sizeof(header.magic));
+    header.version = k_latent_version;
+    header.seed = info.seed;
+    header.num_steps = info.num_steps;
+    header.step = info.step;
+    header.audio_len_sec = info.audio_len_sec;
+    header.sigma_max = info.sigma_max;
+    header.num_dims = static_cast<uint32_t>(info.dims.size());
+    header.prompt_len = static_cast<uint32_t>(info.prompt.size());
+    std::copy(info.dims.begin(), info.dims.end(), header.dims);
+
+    const size_t prompt_end = sizeof(LatentHeader) + info.prompt.size();
+    header.data_offset = static_cast<uint32_t>((prompt_end + k_latent_data_alignment - 1) / k_latent_data_alignment * k_latent_data_alignment);
+
+    std::ofstream out(path, std::ios::binary);
+    AUDIOGEN_CHECK(out.is_open());
+
+    const std::vector<char> padding(header.data_offset - prompt_end, 0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(info.prompt.data(), info.prompt.size());
+    out.write(padding.data(), padding.size());
+    out.write(reinterpret_cast<const char*>(data), info.num_elems() * sizeof(float));
+    AUDIOGEN_CHECK(out.good());
+}
+
+std::unique_ptr<LatentFile> LatentFile::open(const std::string& path) {
+    std::unique_ptr<LatentFile> file(new LatentFile());
+    const uint8_t* contents = nullptr;
+    size_t size = 0;
+
+#if !defined(_WIN32)
+    const int32_t fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "ERROR: Cannot open the latent file %s\n", path.c_str());
+        if (fd >= 0) {
+            close(fd);
+        }
+        return nullptr;
+    }
+    size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            file->mapping_ = mapping;
+            file->mapping_size_ = size;
+            contents = static_cast<const uint8_t*>(mapping);
+        }
+    }
+    close(fd);
+#endif
+
+    if (contents == nullptr) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in.is_open()) {
+            fprintf(stderr, "ERROR: Cannot open the latent file %s\n", path.c_str());
+            return nullptr;
+        }
+        // Over-allocate, so that the latent data can be aligned in memory like in the file
+        size = static_cast<size_t>(in.tellg());
+        file->contents_.resize(size + k_latent_data_alignment);
+        const size_t offset = (k_latent_data_alignment - reinterpret_cast<uintptr_t>(file->contents_.data()) % k_latent_data_alignment) % k_latent_data_alignment;
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(file->contents_.data() + offset), size);
+        if (static_cast<size_t>(in.gcount()) != size) {
+            fprintf(stderr, "ERROR: Cannot read the latent file %s\n", path.c_str());
+            return nullptr;
+        }
+        contents = file->contents_.data() + offset;
+    }
+
+    LatentHeader header;
+    if (size < sizeof(header)) {
+        fprintf(stderr, "ERROR: %s is not a latent file\n", path.c_str());
+        return nullptr;
+    }
+    memcpy(&header, contents, sizeof(header));
+
+    if (memcmp(header.magic, k_latent_magic, sizeof(header.magic)) != 0 || header.version != k_latent_version ||
+        header.num_dims > k_latent_max_dims || header.data_offset % k_latent_data_alignment != 0 ||
+        sizeof(header) + static_cast<size_t>(header.prompt_len) > header.data_offset) {
+        fprintf(stderr, "ERROR: %s is not a latent file, or its version is not supported\n", path.c_str());
+        return nullptr;
+    }
+    // The prompt is read from the file below, so its end must be in it
+    if (header.data_offset > size) {
+        fprintf(stderr, "ERROR: The latent file %s is truncated\n", path.c_str());
+        return nullptr;
+    }
+
+    // The size of the latent, without overflowing on corrupted dims
+    size_t num_elems = 1;
+    for (uint32_t i = 0; i < header.num_dims; ++i) {
+        const int64_t dim = header.dims[i];
+        if (dim < 0 || (dim > 0 && num_elems > SIZE_MAX / sizeof(float) / static_cast<size_t>(dim))) {
+            fprintf(stderr, "ERROR: The latent file %s has invalid dims\n", path.c_str());
+            return nullptr;
+        }
+        num_elems *= static_cast<size_t>(dim);
+    }
+    if (num_elems * sizeof(float) > size - header.data_offset) {
+        fprintf(stderr, "ERROR: The latent file %s is truncated\n", path.c_str());
+        return nullptr;
+    }
+
+    LatentInfo& info = file->info_;
+    info.prompt.assign(reinterpret_cast<const char*>(contents + sizeof(header)), header.prompt_len);
+    info.seed = header.seed;
+    info.num_steps = header.num_steps;
+    info.step = header.step;
+    info.audio_len_sec = header.audio_len_sec;
+    info.sigma_max = header.sigma_max;
+    info.dims.assign(header.dims, header.dims + header.num_dims);
+
+    file->data_ = reinterpret_cast<const float*>(contents + header.data_offset);
+    return file;
+}
+
+LatentFile::~LatentFile() {
+#if !defined(_WIN32)
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_size_);
+    }
+#endif
+}
+
+} // namespace audiogen
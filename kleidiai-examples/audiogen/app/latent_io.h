@@ -0,0 +1,87 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace audiogen {
+
+// -- Latent file (.latent)
+// Little-endian, fixed-size header, followed by the prompt and then by the float32 latent.
+// The latent starts at a 64-byte aligned offset, so the file can be mmapped and the data
+// used in place.
+//
+//   offset  size  field
+//        0     8  magic "AGLATENT"
+//        8     4  version (1)
+//       12     4  data_offset: offset of the latent, multiple of 64
+//       16     8  seed
+//       24     4  num_steps: number of steps of the schedule
+//       28     4  step: number of steps already run (num_steps for a final latent)
+//       32     4  audio_len_sec (float32)
+//       36     4  sigma_max (float32)
+//       40     4  num_dims (<= 4)
+//       44     4  prompt_len
+//       48    32  dims (4 x int64, unused dims set to 0)
+//       80     .  prompt (UTF-8, prompt_len bytes), zero padding up to data_offset
+//  data_offset .  latent (float32, product of dims elements)
+struct LatentInfo {
+    std::string prompt;
+    uint64_t seed = 0;
+    uint32_t num_steps = 0;
+    uint32_t step = 0;
+    float audio_len_sec = 0.0f;
+    float sigma_max = 0.0f;
+    std::vector<int64_t> dims;
+
+    size_t num_elems() const;
+};
+
+void save_latent(const std::string& path, const LatentInfo& info, const float* data);
+
+// Read-only latent file, mmapped when the platform supports it
+class LatentFile {
+public:
+    // Returns nullptr (and prints the reason) if the file cannot be read or is not a latent file
+    static std::unique_ptr<LatentFile> open(const std::string& path);
+
+    ~LatentFile();
+
+    LatentFile(const LatentFile&) = delete;
+    LatentFile& operator=(const LatentFile&) = delete;
+
+    const LatentInfo& info() const { return info_; }
+    const float* data() const { return data_; }
+
+private:
+    LatentFile() = default;
+
+    LatentInfo info_;
+    const float* data_ = nullptr;
+
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    std::vector<uint8_t> contents_;
+};
+
+} // namespace audiogen
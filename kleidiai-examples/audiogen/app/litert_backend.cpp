@@ -0,0 +1,229 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// LiteRT header files
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/model.h"
+#include "tensorflow/lite/tools/gen_op_registration.h"
+
+#include "backend.h"
+#include "common.h"
+
+#include <map>
+#include <mutex>
+
+namespace audiogen {
+namespace {
+
+// -- Update the tensor index based on your model configuration.
+constexpr TensorLayout k_litert_layout = {
+    /* t5_ids_in_idx         */ 0,
+    /* t5_attnmask_in_idx    */ 1,
+    /* t5_audio_len_in_idx   */ 2,
+    /* t5_crossattn_out_idx  */ 0,
+    /* t5_globalcond_out_idx */ 2,
+
+    /* dit_x_in_idx          */ 3,
+    /* dit_t_in_idx          */ 0,
+    /* dit_crossattn_in_idx  */ 2,
+    /* dit_globalcond_in_idx */ 1,
+    /* dit_out_idx           */ 0,
+};
+
+struct TfLiteDelegateDeleter {
+    void operator()(TfLiteDelegate* delegate) const {
+        TfLiteXNNPackDelegateDelete(delegate);
+    }
+};
+
+static DataType to_data_type(TfLiteType type) {
+    switch (type) {
+        case kTfLiteFloat32: return DataType::Float32;
+        case kTfLiteInt32:   return DataType::Int32;
+        case kTfLiteInt64:   return DataType::Int64;
+        default:
+            AUDIOGEN_CHECK(false && "Unsupported tensor type");
+    }
+    return DataType::Float32;
+}
+
+// The model buffer, if any, must outlive the model
+struct ModelFile {
+    std::unique_ptr<PageBuffer> buffer;
+    std::unique_ptr<tflite::FlatBufferModel> model;
+};
+
+// A FlatBufferModel is read-only, so the interpreters of the same file share it
+// (e.g. one interpreter per worker in throughput mode) instead of mapping it again
+static std::shared_ptr<const ModelFile> get_model_file(const std::string& path, const MemoryOptions& memory_options) {
+    static std::mutex cache_mutex;
+    static std::map<std::string, std::weak_ptr<const ModelFile>> cache;
+
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        if (auto model_file = cache[path].lock()) {
+            return model_file;
+        }
+    }
+
+    // Built without holding the lock, so that different files are still loaded concurrently
+    auto model_file = std::make_shared<ModelFile>();
+    if (memory_options.enabled()) {
+        // BuildFromFile() maps the file from the page cache, which cannot use transparent huge pages,
+        // so the model is read into an anonymous buffer instead
+        model_file->buffer = read_file(path, memory_options);
+        model_file->model = tflite::FlatBufferModel::BuildFromBuffer(
+            reinterpret_cast<const char*>(model_file->buffer->data()), model_file->buffer->size());
+    } else {
+        model_file->model = tflite::FlatBufferModel::BuildFromFile(path.c_str());
+    }
+    AUDIOGEN_CHECK(model_file->model != nullptr);
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (auto cached = cache[path].lock()) {
+        return cached;
+    }
+    cache[path] = model_file;
+    return model_file;
+}
+
+class LiteRtModel : public Model {
+public:
+    LiteRtModel(const std::string& path, bool force_fp16, size_t num_threads, const MemoryOptions& memory_options) {
+        model_file_ = get_model_file(path, memory_options);
+
+        // Build the interpreter
+        tflite::ops::builtin::BuiltinOpResolver resolver;
+        tflite::InterpreterBuilder builder(*model_file_->model, resolver);
+
+        interpreter_ = std::make_unique<tflite::Interpreter>();
+        builder(&interpreter_);
+        AUDIOGEN_CHECK(interpreter_ != nullptr);
+
+        // Create the XNNPACK delegate options
+        TfLiteXNNPackDelegateOptions xnnpack_options = TfLiteXNNPackDelegateOptionsDefault();
+        xnnpack_options.num_threads = num_threads;
+
+        xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_QS8;
+        xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_QU8;
+        xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_DYNAMIC_FULLY_CONNECTED;
+        xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_ENABLE_SUBGRAPH_RESHAPING;
+        xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_ENABLE_LATEST_OPERATORS;
+        xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_VARIABLE_OPERATORS;
+
+        if (force_fp16) {
+            xnnpack_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_FORCE_FP16;
+        }
+
+        delegate_.reset(TfLiteXNNPackDelegateCreate(&xnnpack_options));
+
+        // Add the delegate to the interpreter
+        if (interpreter_->ModifyGraphWithDelegate(delegate_.get()) != kTfLiteOk) {
+            AUDIOGEN_CHECK(false && "Failed to apply XNNPACK delegate");
+        }
+
+        // Allocate the tensors
+        AUDIOGEN_CHECK(interpreter_->AllocateTensors() == kTfLiteOk);
+    }
+
+    size_t num_inputs() const override {
+        return interpreter_->inputs().size();
+    }
+
+    size_t num_outputs() const override {
+        return interpreter_->outputs().size();
+    }
+
+    TensorView input(size_t idx) override {
+        return view(interpreter_->inputs()[idx]);
+    }
+
+    TensorView output(size_t idx) override {
+        return view(interpreter_->outputs()[idx]);
+    }
+
+    bool invoke() override {
+        return interpreter_->Invoke() == kTfLiteOk;
+    }
+
+private:
+    TensorView view(int tensor_id) {
+        TfLiteTensor* tensor = interpreter_->tensor(tensor_id);
+
+        TensorView tensor_view;
+        tensor_view.data = tensor->data.raw;
+        tensor_view.type = to_data_type(tensor->type);
+        tensor_view.dims.assign(tensor->dims->data, tensor->dims->data + tensor->dims->size);
+        return tensor_view;
+    }
+
+    // The delegate must outlive the interpreter, so it is declared first
+    std::unique_ptr<TfLiteDelegate, TfLiteDelegateDeleter> delegate_;
+    std::shared_ptr<const ModelFile> model_file_;
+    std::unique_ptr<tflite::Interpreter> interpreter_;
+};
+
+class LiteRtBackend : public Backend {
+public:
+    explicit LiteRtBackend(size_t num_threads) : num_threads_(num_threads) {}
+
+    const char* name() const override {
+        return "litert";
+    }
+
+    const TensorLayout& layout() const override {
+        return k_litert_layout;
+    }
+
+    std::string model_path(const std::string& models_base_path, ModelKind kind) const override {
+        switch (kind) {
+            case ModelKind::Conditioners: return models_base_path + "/conditioners_float32.tflite";
+            case ModelKind::DiT:          return models_base_path + "/dit_model.tflite";
+            case ModelKind::Decoder:      return models_base_path + "/autoencoder_model.tflite";
+            case ModelKind::Encoder:      return models_base_path + "/autoencoder_encoder_model.tflite";
+        }
+        return "";
+    }
+
+    // Named after the ONNX model of export_conditioners.py, as onnx2tf does
+    std::string conditioners_bucket_path(const std::string& models_base_path, size_t seq_len) const override {
+        return models_base_path + "/conditioners_L" + std::to_string(seq_len) + "_float32.tflite";
+    }
+
+    // The interpreters allocate their own tensor arenas, so the MemoryArena is not used
+    std::unique_ptr<Model> load_model(const std::string& path, ModelKind kind, MemoryArena*) override {
+        // We force the FP16 computation just to the most computationally expensive models,
+        // the T5 and DiT models run in FP32
+        const bool force_fp16 = kind == ModelKind::Decoder || kind == ModelKind::Encoder;
+        return std::make_unique<LiteRtModel>(path, force_fp16, num_threads_, memory_options_);
+    }
+
+private:
+    size_t num_threads_;
+};
+
+} // namespace
+
+std::unique_ptr<Backend> create_litert_backend(size_t num_threads) {
+    return std::make_unique<LiteRtBackend>(num_threads);
+}
+
+} // namespace audiogen
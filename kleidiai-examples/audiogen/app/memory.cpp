@@ -0,0 +1,247 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "memory.h"
+#include "common.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#if defined(__linux__) && !defined(MADV_COLLAPSE)
+#define MADV_COLLAPSE 25
+#endif
+
+namespace audiogen {
+
+constexpr size_t k_huge_page_size = 2 * 1024 * 1024;
+
+// Mappings smaller than this are left alone by apply_memory_options()
+constexpr size_t k_min_advised_mapping_size = 4 * 1024 * 1024;
+
+static size_t align_up(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+bool parse_huge_pages(const std::string& name, HugePages& huge_pages) {
+    if (name == "off") {
+        huge_pages = HugePages::Off;
+    } else if (name == "thp") {
+        huge_pages = HugePages::Transparent;
+    } else if (name == "explicit") {
+        huge_pages = HugePages::Explicit;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+PageBuffer::PageBuffer(size_t size, const MemoryOptions& options) : size_(size) {
+#if defined(__linux__)
+    if (options.huge_pages == HugePages::Explicit) {
+        mapping_size_ = align_up(size, k_huge_page_size);
+        mapping_ = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mapping_ == MAP_FAILED) {
+            fprintf(stderr, "Warning: no explicit huge pages available for %zu bytes, using transparent huge pages\n", size);
+            mapping_ = nullptr;
+        } else {
+            data_ = static_cast<uint8_t*>(mapping_);
+        }
+    }
+
+    if (mapping_ == nullptr) {
+        // Over-allocate, so that the buffer can start on a huge page boundary
+        mapping_size_ = align_up(size, k_huge_page_size) + k_huge_page_size;
+        mapping_ = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        AUDIOGEN_CHECK(mapping_ != MAP_FAILED);
+
+        data_ = reinterpret_cast<uint8_t*>(align_up(reinterpret_cast<uintptr_t>(mapping_), k_huge_page_size));
+        if (options.huge_pages != HugePages::Off) {
+            madvise(data_, align_up(size, k_huge_page_size), MADV_HUGEPAGE);
+        }
+    }
+
+    if (options.lock && mlock(data_, size_) != 0) {
+        fprintf(stderr, "Warning: mlock of %zu bytes failed, check RLIMIT_MEMLOCK (ulimit -l)\n", size_);
+    }
+#else
+    (void)options;
+    heap_storage_.reset(new uint8_t[size + k_huge_page_size]);
+    data_ = reinterpret_cast<uint8_t*>(align_up(reinterpret_cast<uintptr_t>(heap_storage_.get()), k_huge_page_size));
+#endif
+}
+
+PageBuffer::~PageBuffer() {
+#if defined(__linux__)
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_size_);
+    }
+#endif
+}
+
+std::unique_ptr<PageBuffer> read_file(const std::string& path, const MemoryOptions& options) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    AUDIOGEN_CHECK(file.is_open());
+
+    const size_t size = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+
+    auto buffer = std::make_unique<PageBuffer>(size, options);
+    AUDIOGEN_CHECK(file.read(reinterpret_cast<char*>(buffer->data()), size));
+    return buffer;
+}
+
+#if defined(__linux__)
+
+struct Mapping {
+    uintptr_t start = 0;
+    uintptr_t end = 0;
+    bool anonymous_rw = false;
+    std::vector<std::pair<std::string, size_t>> fields;  // e.g. {"Rss", bytes}
+
+    size_t field(const char* name) const {
+        for (const auto& f : fields) {
+            if (f.first == name) {
+                return f.second;
+            }
+        }
+        return 0;
+    }
+};
+
+static std::vector<Mapping> read_smaps() {
+    std::vector<Mapping> mappings;
+    std::ifstream smaps("/proc/self/smaps");
+
+    std::string line;
+    while (std::getline(smaps, line)) {
+        std::istringstream fields(line);
+        std::string first;
+        fields >> first;
+
+        // Header of a mapping: "start-end perms offset dev inode [path]"
+        const size_t dash = first.find('-');
+        if (first.back() != ':' && dash != std::string::npos) {
+            std::string perms, offset, dev, inode, path;
+            fields >> perms >> offset >> dev >> inode >> path;
+
+            Mapping mapping;
+            mapping.start = std::stoull(first.substr(0, dash), nullptr, 16);
+            mapping.end = std::stoull(first.substr(dash + 1), nullptr, 16);
+            mapping.anonymous_rw = perms == "rw-p" && inode == "0" && path.empty();
+            mappings.push_back(mapping);
+        } else if (!mappings.empty() && first.back() == ':') {
+            // "Rss:  1234 kB"
+            size_t value_kb = 0;
+            fields >> value_kb;
+            mappings.back().fields.emplace_back(first.substr(0, first.size() - 1), value_kb * 1024);
+        }
+    }
+    return mappings;
+}
+
+MappingSnapshot take_mapping_snapshot() {
+    MappingSnapshot snapshot;
+    for (const auto& mapping : read_smaps()) {
+        if (mapping.anonymous_rw) {
+            snapshot.ranges.emplace_back(mapping.start, mapping.end);
+        }
+    }
+    return snapshot;
+}
+
+size_t apply_memory_options(const MemoryOptions& options, const MappingSnapshot& before) {
+    if (!options.enabled()) {
+        return 0;
+    }
+
+    size_t advised_bytes = 0;
+    auto apply = [&](uintptr_t start, uintptr_t end) {
+        void* addr = reinterpret_cast<void*>(start);
+        const size_t size = end - start;
+        if (options.huge_pages != HugePages::Off) {
+            madvise(addr, size, MADV_HUGEPAGE);
+            // The pages are already populated, so ask the kernel to collapse them now rather
+            // than waiting for khugepaged. Not supported before Linux 6.1, hence no check.
+            madvise(addr, size, MADV_COLLAPSE);
+            advised_bytes += size;
+        }
+        if (options.lock && mlock(addr, size) != 0) {
+            fprintf(stderr, "Warning: mlock of %zu bytes failed, check RLIMIT_MEMLOCK (ulimit -l)\n", size);
+        }
+    };
+
+    for (const auto& mapping : read_smaps()) {
+        const size_t size = mapping.end - mapping.start;
+        const size_t rss = mapping.field("Rss");
+        if (!mapping.anonymous_rw || size < k_min_advised_mapping_size || rss * 2 < size) {
+            continue;
+        }
+
+        // The kernel merges a new mapping with an adjacent one, so only the parts of the mapping
+        // which were not mapped before are new
+        uintptr_t start = mapping.start;
+        for (const auto& range : before.ranges) {
+            if (range.second <= start || range.first >= mapping.end) {
+                continue;
+            }
+            if (range.first > start) {
+                apply(start, range.first);
+            }
+            start = std::max(start, range.second);
+        }
+        if (start < mapping.end) {
+            apply(start, mapping.end);
+        }
+    }
+    return advised_bytes;
+}
+
+MemoryReport get_memory_report() {
+    MemoryReport report;
+    for (const auto& mapping : read_smaps()) {
+        report.anon_huge_pages_bytes += mapping.field("AnonHugePages");
+        report.hugetlb_bytes += mapping.field("Private_Hugetlb") + mapping.field("Shared_Hugetlb");
+        report.locked_bytes += mapping.field("Locked");
+        report.rss_bytes += mapping.field("Rss");
+    }
+    return report;
+}
+
+#else
+
+MappingSnapshot take_mapping_snapshot() {
+    return MappingSnapshot();
+}
+
+size_t apply_memory_options(const MemoryOptions&, const MappingSnapshot&) {
+    return 0;
+}
+
+MemoryReport get_memory_report() {
+    return MemoryReport();
+}
+
+#endif
+
+} // namespace audiogen
@@ -0,0 +1,96 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace audiogen {
+
+enum class HugePages {
+    Off,
+    Transparent,    // madvise(MADV_HUGEPAGE), served by the kernel when 2 MB pages are available
+    Explicit,       // MAP_HUGETLB, needs pages reserved in /proc/sys/vm/nr_hugepages
+};
+
+struct MemoryOptions {
+    HugePages huge_pages = HugePages::Off;
+    bool lock = false;  // mlock() the weights and the arenas, so they are never paged out
+
+    bool enabled() const { return huge_pages != HugePages::Off || lock; }
+};
+
+// Parse "off", "thp" or "explicit". Returns false if the name is unknown.
+bool parse_huge_pages(const std::string& name, HugePages& huge_pages);
+
+// Anonymous, 2 MB-aligned buffer backed by huge pages when requested.
+// Huge pages and locking are only supported on Linux, elsewhere this is a plain heap buffer.
+class PageBuffer {
+public:
+    PageBuffer(size_t size, const MemoryOptions& options);
+    ~PageBuffer();
+
+    PageBuffer(const PageBuffer&) = delete;
+    PageBuffer& operator=(const PageBuffer&) = delete;
+
+    uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    std::unique_ptr<uint8_t[]> heap_storage_;
+};
+
+// Read a whole file (e.g. a .tflite or .pte model) into a PageBuffer
+std::unique_ptr<PageBuffer> read_file(const std::string& path, const MemoryOptions& options);
+
+// Address ranges of the anonymous mappings of the process at some point, to tell apart the memory
+// mapped afterwards. Linux only, empty elsewhere.
+struct MappingSnapshot {
+    std::vector<std::pair<uintptr_t, uintptr_t>> ranges;    // [start, end), by ascending address
+};
+
+MappingSnapshot take_mapping_snapshot();
+
+// The runtimes allocate the packed weights and the activation arenas themselves. Advise huge
+// pages on (and lock, if requested) the anonymous memory mapped since `before` was taken, in
+// large and mostly resident mappings, i.e. these buffers rather than the thread stacks. The
+// memory of the rest of the process (malloc arenas, the Python heap of pyaudiogen) is left alone.
+// Returns the number of bytes advised. Linux only, returns 0 elsewhere.
+size_t apply_memory_options(const MemoryOptions& options, const MappingSnapshot& before);
+
+// What the kernel actually did, from /proc/self/smaps
+struct MemoryReport {
+    size_t anon_huge_pages_bytes = 0;   // Transparent huge pages
+    size_t hugetlb_bytes = 0;           // Explicit huge pages
+    size_t locked_bytes = 0;
+    size_t rss_bytes = 0;
+};
+
+MemoryReport get_memory_report();
+
+} // namespace audiogen
@@ -0,0 +1,378 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "metrics.h"
+#include "common.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace audiogen {
+
+namespace detail {
+std::atomic<bool> g_metrics_enabled{false};
+}
+
+namespace {
+
+// Upper bounds of the histogram buckets, from 100 us (sampler) to 10 s (autoencoder on a busy host)
+constexpr long long k_bucket_bounds_ns[] = {
+    100000LL, 250000LL, 500000LL,
+    1000000LL, 2500000LL, 5000000LL,
+    10000000LL, 25000000LL, 50000000LL,
+    100000000LL, 250000000LL, 500000000LL,
+    1000000000LL, 2500000000LL, 5000000000LL, 10000000000LL,
+};
+constexpr size_t k_num_bounds = sizeof(k_bucket_bounds_ns) / sizeof(k_bucket_bounds_ns[0]);
+
+// The count of each bucket (the last one is +Inf) rather than the cumulative counts, so that an
+// observation only touches one bucket. Each histogram has its own cache lines, as the workers
+// mostly update different stages at a time.
+struct alignas(64) Histogram {
+    std::atomic<uint64_t> counts[k_num_bounds + 1];
+    std::atomic<uint64_t> sum_ns;
+};
+
+Histogram g_histograms[static_cast<size_t>(MetricStage::Count)];
+std::atomic<uint64_t> g_counters[static_cast<size_t>(MetricCounter::Count)];
+std::atomic<int64_t> g_gauges[static_cast<size_t>(MetricGauge::Count)];
+
+const char* const k_stage_names[] = {"t5", "dit_step", "sampler", "autoencoder", "encoder", "audio_write"};
+static_assert(sizeof(k_stage_names) / sizeof(k_stage_names[0]) == static_cast<size_t>(MetricStage::Count), "");
+
+struct MetricDesc {
+    const char* name;
+    const char* labels;     // Empty if none
+    const char* help;
+};
+
+// The counters sharing a name are consecutive, with different labels
+const MetricDesc k_counter_descs[] = {
+    {"audiogen_jobs_done_total", "", "Jobs completed"},
+    {"audiogen_jobs_cancelled_total", "", "Jobs cancelled while running"},
+    {"audiogen_worker_busy_seconds_total", "", "Time spent by the workers running jobs"},
+    {"audiogen_encoder_cache_requests_total", "result=\"memory_hit\"", "Encodings of an input audio, by cache result"},
+    {"audiogen_encoder_cache_requests_total", "result=\"disk_hit\"", ""},
+    {"audiogen_encoder_cache_requests_total", "result=\"miss\"", ""},
+    {"audiogen_variant_requests_total", "result=\"hit\"", "Model variants requested by the jobs, by whether they were loaded"},
+    {"audiogen_variant_requests_total", "result=\"load\"", ""},
+    {"audiogen_variant_evictions_total", "", "Model variants unloaded to fit in the memory budget"},
+    {"audiogen_result_cache_requests_total", "result=\"hit\"", "Generations requested, by result cache result"},
+    {"audiogen_result_cache_requests_total", "result=\"coalesced\"", ""},
+    {"audiogen_result_cache_requests_total", "result=\"miss\"", ""},
+};
+static_assert(sizeof(k_counter_descs) / sizeof(k_counter_descs[0]) == static_cast<size_t>(MetricCounter::Count), "");
+
+const MetricDesc k_gauge_descs[] = {
+    {"audiogen_queue_depth", "", "Jobs not picked by a worker yet"},
+    {"audiogen_active_jobs", "", "Jobs running"},
+    {"audiogen_workers", "", "Workers, each with its own pipeline"},
+    {"audiogen_threads_per_worker", "", "Threads of the runtime of each worker"},
+};
+static_assert(sizeof(k_gauge_descs) / sizeof(k_gauge_descs[0]) == static_cast<size_t>(MetricGauge::Count), "");
+
+static void write_header(std::ostringstream& out, const MetricDesc& desc, const char* type, const char*& last_name) {
+    if (last_name == nullptr || std::strcmp(last_name, desc.name) != 0) {
+        out << "# HELP " << desc.name << " " << desc.help << "\n";
+        out << "# TYPE " << desc.name << " " << type << "\n";
+    }
+    last_name = desc.name;
+}
+
+static void write_sample(std::ostringstream& out, const MetricDesc& desc, double value) {
+    out << desc.name;
+    if (desc.labels[0] != '\0') {
+        out << "{" << desc.labels << "}";
+    }
+    out << " " << value << "\n";
+}
+
+#if !defined(_WIN32)
+
+static void write_process_metrics(std::ostringstream& out) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        const double cpu_sec = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+            (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+        // Divided by the rate of audiogen_workers * audiogen_threads_per_worker, the utilization of the thread pools
+        out << "# HELP process_cpu_seconds_total User and system CPU time of the process\n";
+        out << "# TYPE process_cpu_seconds_total counter\n";
+        out << "process_cpu_seconds_total " << cpu_sec << "\n";
+    }
+
+#if defined(__linux__)
+    // Resident pages are the second field
+    std::ifstream statm("/proc/self/statm");
+    size_t size_pages = 0;
+    size_t resident_pages = 0;
+    if (statm >> size_pages >> resident_pages) {
+        out << "# HELP process_resident_memory_bytes Resident set size of the process\n";
+        out << "# TYPE process_resident_memory_bytes gauge\n";
+        out << "process_resident_memory_bytes " << resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE)) << "\n";
+    }
+#endif
+}
+
+#else
+
+static void write_process_metrics(std::ostringstream&) {}
+
+#endif
+
+} // namespace
+
+void metrics_enable() {
+    detail::g_metrics_enabled = true;
+}
+
+void metrics_observe(MetricStage stage, long long duration_ns) {
+    if (!metrics_enabled()) {
+        return;
+    }
+    Histogram& histogram = g_histograms[static_cast<size_t>(stage)];
+    size_t bucket = 0;
+    while (bucket < k_num_bounds && duration_ns > k_bucket_bounds_ns[bucket]) {
+        ++bucket;
+    }
+    histogram.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    histogram.sum_ns.fetch_add(static_cast<uint64_t>(duration_ns), std::memory_order_relaxed);
+}
+
+void metrics_add(MetricCounter counter, uint64_t value) {
+    if (metrics_enabled()) {
+        g_counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+}
+
+void metrics_set(MetricGauge gauge, int64_t value) {
+    if (metrics_enabled()) {
+        g_gauges[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+    }
+}
+
+void metrics_add(MetricGauge gauge, int64_t delta) {
+    if (metrics_enabled()) {
+        g_gauges[static_cast<size_t>(gauge)].fetch_add(delta, std::memory_order_relaxed);
+    }
+}
+
+std::string metrics_format() {
+    std::ostringstream out;
+
+    // The buckets are read one by one while the workers update them, so the cumulative counts of a
+    // scrape may miss the observations made during it. They are counted by the next one.
+    out << "# HELP audiogen_stage_duration_seconds Duration of each stage of the generation\n";
+    out << "# TYPE audiogen_stage_duration_seconds histogram\n";
+    for (size_t stage = 0; stage < static_cast<size_t>(MetricStage::Count); ++stage) {
+        const Histogram& histogram = g_histograms[stage];
+        const char* name = k_stage_names[stage];
+
+        uint64_t cumulative = 0;
+        for (size_t bucket = 0; bucket <= k_num_bounds; ++bucket) {
+            cumulative += histogram.counts[bucket].load(std::memory_order_relaxed);
+            out << "audiogen_stage_duration_seconds_bucket{stage=\"" << name << "\",le=\"";
+            if (bucket < k_num_bounds) {
+                out << k_bucket_bounds_ns[bucket] * 1e-9;
+            } else {
+                out << "+Inf";
+            }
+            out << "\"} " << cumulative << "\n";
+        }
+        out << "audiogen_stage_duration_seconds_sum{stage=\"" << name << "\"} "
+            << histogram.sum_ns.load(std::memory_order_relaxed) * 1e-9 << "\n";
+        out << "audiogen_stage_duration_seconds_count{stage=\"" << name << "\"} " << cumulative << "\n";
+    }
+
+    const char* last_name = nullptr;
+    for (size_t i = 0; i < static_cast<size_t>(MetricCounter::Count); ++i) {
+        const uint64_t value = g_counters[i].load(std::memory_order_relaxed);
+        write_header(out, k_counter_descs[i], "counter", last_name);
+        const bool in_ns = i == static_cast<size_t>(MetricCounter::WorkerBusyNs);
+        write_sample(out, k_counter_descs[i], in_ns ? value * 1e-9 : static_cast<double>(value));
+    }
+
+    for (size_t i = 0; i < static_cast<size_t>(MetricGauge::Count); ++i) {
+        write_header(out, k_gauge_descs[i], "gauge", last_name);
+        write_sample(out, k_gauge_descs[i], static_cast<double>(g_gauges[i].load(std::memory_order_relaxed)));
+    }
+
+    write_process_metrics(out);
+    return out.str();
+}
+
+MetricTimer::MetricTimer(MetricStage stage) : stage_(stage) {
+    if (metrics_enabled()) {
+        start_ns_ = time_in_ns();
+    }
+}
+
+MetricTimer::~MetricTimer() {
+    if (start_ns_ >= 0) {
+        metrics_observe(stage_, time_in_ns() - start_ns_);
+    }
+}
+
+MetricsExporter::MetricsExporter(const MetricsOptions& options) : options_(options) {
+    metrics_enable();
+
+    if (options_.port > 0) {
+#if !defined(_WIN32)
+        // Loopback only: the metrics are meant for a local agent (e.g. a Prometheus node exporter or a sidecar)
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        AUDIOGEN_CHECK(listen_fd_ >= 0);
+        const int reuse = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<uint16_t>(options_.port));
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listen_fd_, 8) != 0) {
+            fprintf(stderr, "Cannot listen on 127.0.0.1:%d: %s\n", options_.port, std::strerror(errno));
+            AUDIOGEN_CHECK(false);
+        }
+        fprintf(stderr, "Metrics served on http://127.0.0.1:%d/metrics\n", options_.port);
+#else
+        fprintf(stderr, "Warning: the metrics endpoint is not supported on Windows, use a metrics file\n");
+#endif
+    }
+
+    thread_ = std::thread([this]() { run(); });
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop_requested_ = true;
+    thread_.join();
+
+#if !defined(_WIN32)
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+    }
+#endif
+    if (!options_.file.empty()) {
+        write_file();
+    }
+}
+
+void MetricsExporter::run() {
+    // Short enough for the destructor not to wait
+    constexpr long k_poll_ms = 100;
+
+    long next_write_ms = time_in_ms() + options_.interval_ms;
+    while (!stop_requested_) {
+        if (listen_fd_ >= 0) {
+            serve_pending_requests(k_poll_ms);
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(k_poll_ms));
+        }
+
+        if (!options_.file.empty() && time_in_ms() >= next_write_ms) {
+            write_file();
+            next_write_ms = time_in_ms() + options_.interval_ms;
+        }
+    }
+}
+
+#if !defined(_WIN32)
+
+// A minimal HTTP/1.0 server: every request gets the metrics, whatever its path
+void MetricsExporter::serve_pending_requests(long timeout_ms) {
+    pollfd listen_poll = {listen_fd_, POLLIN, 0};
+    if (poll(&listen_poll, 1, static_cast<int>(timeout_ms)) <= 0) {
+        return;
+    }
+    const int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+        return;
+    }
+
+    // Read the request up to the end of its headers, without waiting on a stalled client for long
+    std::string request;
+    char buffer[1024];
+    pollfd client_poll = {fd, POLLIN, 0};
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 16384 &&
+           poll(&client_poll, 1, 1000) > 0) {
+        const ssize_t num_read = recv(fd, buffer, sizeof(buffer), 0);
+        if (num_read <= 0) {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(num_read));
+    }
+
+    const std::string body = metrics_format();
+    const std::string response =
+        "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "Connection: close\r\n\r\n" + body;
+
+#if defined(MSG_NOSIGNAL)
+    const int send_flags = MSG_NOSIGNAL;
+#else
+    const int send_flags = 0;
+#endif
+    size_t num_sent = 0;
+    while (num_sent < response.size()) {
+        const ssize_t n = send(fd, response.data() + num_sent, response.size() - num_sent, send_flags);
+        if (n <= 0) {
+            break;
+        }
+        num_sent += static_cast<size_t>(n);
+    }
+    close(fd);
+}
+
+#else
+
+void MetricsExporter::serve_pending_requests(long) {}
+
+#endif
+
+// Written under a temporary name, so that a reader never sees a partial file
+void MetricsExporter::write_file() {
+    const std::string tmp_path = options_.file + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            fprintf(stderr, "Warning: cannot write the metrics to %s\n", tmp_path.c_str());
+            return;
+        }
+        out << metrics_format();
+    }
+#if defined(_WIN32)
+    std::remove(options_.file.c_str());     // rename() does not replace an existing file on Windows
+#endif
+    std::rename(tmp_path.c_str(), options_.file.c_str());
+}
+
+} // namespace audiogen
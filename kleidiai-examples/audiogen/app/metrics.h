@@ -0,0 +1,135 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace audiogen {
+
+// -- Live metrics
+// Latency histograms of the stages, counters and gauges of the runner, exposed in the Prometheus
+// text format. Disabled by default: a timer then costs a relaxed load and a branch. When enabled,
+// every update is a relaxed atomic add, so the workers never wait on each other or on the exporter.
+
+enum class MetricStage {
+    T5,             // T5 invoke
+    DiTStep,        // DiT invoke, one per step
+    Sampler,        // Sampler of one step, noise included
+    Autoencoder,    // Autoencoder invoke
+    Encoder,        // Encoder invoke, one per chunk of the input audio
+    AudioWrite,     // Encoding and writing of the output file (WAV or FLAC)
+    Count,
+};
+
+enum class MetricCounter {
+    JobsDone,
+    JobsCancelled,
+    WorkerBusyNs,           // Time spent by the workers running jobs
+    EncoderCacheMemoryHits, // Same input audio as the previous job of the pipeline
+    EncoderCacheDiskHits,   // Latent read from the encoder cache directory
+    EncoderCacheMisses,
+    VariantHits,            // Variant already loaded by the worker
+    VariantLoads,
+    VariantEvictions,
+    ResultCacheHits,
+    ResultCacheCoalesced,   // Hit after waiting for an identical request to complete
+    ResultCacheMisses,
+    Count,
+};
+
+enum class MetricGauge {
+    QueueDepth,         // Jobs not picked by a worker yet
+    ActiveJobs,
+    Workers,
+    ThreadsPerWorker,
+    Count,
+};
+
+void metrics_enable();
+
+namespace detail {
+extern std::atomic<bool> g_metrics_enabled;
+}
+
+inline bool metrics_enabled() {
+    return detail::g_metrics_enabled.load(std::memory_order_relaxed);
+}
+
+void metrics_observe(MetricStage stage, long long duration_ns);
+void metrics_add(MetricCounter counter, uint64_t value = 1);
+void metrics_set(MetricGauge gauge, int64_t value);
+void metrics_add(MetricGauge gauge, int64_t delta);
+
+// All the metrics in the Prometheus text exposition format, with the RSS and the CPU time of the process
+std::string metrics_format();
+
+// Records the duration of the rest of the scope in the histogram of the stage
+class MetricTimer {
+public:
+    explicit MetricTimer(MetricStage stage);
+    ~MetricTimer();
+
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+
+private:
+    MetricStage stage_;
+    long long start_ns_ = -1;
+};
+
+#define AUDIOGEN_METRIC_CONCAT_IMPL(a, b) a##b
+#define AUDIOGEN_METRIC_CONCAT(a, b) AUDIOGEN_METRIC_CONCAT_IMPL(a, b)
+
+// Time the rest of the scope, e.g. AUDIOGEN_METRIC_TIMER(MetricStage::DiTStep)
+#define AUDIOGEN_METRIC_TIMER(stage) ::audiogen::MetricTimer AUDIOGEN_METRIC_CONCAT(metric_timer_, __LINE__)(stage)
+
+struct MetricsOptions {
+    int port = 0;               // Serve the metrics over HTTP on 127.0.0.1:<port>, 0 to disable
+    std::string file;           // Rewrite this file with the metrics periodically, empty to disable
+    long interval_ms = 5000;    // Period of the file updates
+
+    bool enabled() const { return port > 0 || !file.empty(); }
+};
+
+// Enables the metrics and exports them from a background thread until destroyed.
+// The file, if any, is written one last time on destruction.
+class MetricsExporter {
+public:
+    explicit MetricsExporter(const MetricsOptions& options);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+private:
+    void run();
+    void serve_pending_requests(long timeout_ms);
+    void write_file();
+
+    MetricsOptions options_;
+    int listen_fd_ = -1;
+    std::atomic<bool> stop_requested_{false};
+    std::thread thread_;
+};
+
+} // namespace audiogen
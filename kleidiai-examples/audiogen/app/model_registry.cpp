@@ -0,0 +1,265 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "model_registry.h"
+#include "common.h"
+#include "metrics.h"
+
+#include <sentencepiece_processor.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+namespace audiogen {
+
+static size_t file_size(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    return in.is_open() ? static_cast<size_t>(in.tellg()) : 0;
+}
+
+static double to_mb(size_t size) {
+    return static_cast<double>(size) / (1024.0 * 1024.0);
+}
+
+bool read_variants_file(const std::string& path, std::vector<ModelVariant>& variants) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        fprintf(stderr, "ERROR: Cannot open the variants file %s\n", path.c_str());
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        ModelVariant variant;
+        if (!(fields >> variant.name >> variant.models_base_path)) {
+            fprintf(stderr, "ERROR: Invalid line in %s: %s\n", path.c_str(), line.c_str());
+            return false;
+        }
+        for (const auto& other : variants) {
+            if (other.name == variant.name) {
+                fprintf(stderr, "ERROR: Variant %s defined twice in %s\n", variant.name.c_str(), path.c_str());
+                return false;
+            }
+        }
+        variants.push_back(variant);
+    }
+
+    if (variants.empty()) {
+        fprintf(stderr, "ERROR: No variant in %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+ModelRegistry::ModelRegistry(Backend& backend, const std::vector<ModelVariant>& variants, size_t memory_budget)
+    : backend_(backend), variants_(variants), memory_budget_(memory_budget) {
+    // Only the files having the size of another file can be identical, so only they are hashed
+    std::map<size_t, std::set<std::string>> paths_by_size;
+    for (const auto& variant : variants_) {
+        for (const auto& path : variant_files(variant)) {
+            FileInfo& info = files_[path];
+            info.key = path;
+            info.size = file_size(path);
+            paths_by_size[info.size].insert(path);
+        }
+    }
+
+    for (const auto& entry : paths_by_size) {
+        if (entry.second.size() < 2 || entry.first == 0) {
+            continue;
+        }
+        for (const auto& path : entry.second) {
+            char key[64];
+            snprintf(key, sizeof(key), "%016llx_%zu", static_cast<unsigned long long>(hash_file(path)), entry.first);
+            files_[path].key = key;
+        }
+    }
+}
+
+ModelRegistry::~ModelRegistry() = default;
+
+std::vector<std::string> ModelRegistry::variant_files(const ModelVariant& variant) const {
+    std::vector<std::string> files = {
+        backend_.model_path(variant.models_base_path, ModelKind::Conditioners),
+        backend_.model_path(variant.models_base_path, ModelKind::DiT),
+        backend_.model_path(variant.models_base_path, ModelKind::Decoder),
+        variant.models_base_path + "/spiece.model",
+    };
+    for (const auto& path : find_conditioners_buckets(backend_, variant.models_base_path)) {
+        files.push_back(path);
+    }
+    return files;
+}
+
+bool ModelRegistry::has_variant(const std::string& name) const {
+    return std::any_of(variants_.begin(), variants_.end(), [&](const ModelVariant& v) { return v.name == name; });
+}
+
+size_t ModelRegistry::resident_size() const {
+    std::map<std::string, size_t> resident;
+    for (const auto& loaded : loaded_) {
+        for (const auto& variant : variants_) {
+            if (variant.name != loaded.name) {
+                continue;
+            }
+            for (const auto& path : variant_files(variant)) {
+                const FileInfo& info = files_.at(path);
+                resident[info.key] = info.size;
+            }
+        }
+    }
+
+    size_t size = 0;
+    for (const auto& entry : resident) {
+        size += entry.second;
+    }
+    return size;
+}
+
+size_t ModelRegistry::missing_size(const ModelVariant& variant) const {
+    std::set<std::string> resident;
+    for (const auto& loaded : loaded_) {
+        for (const auto& other : variants_) {
+            if (other.name == loaded.name) {
+                for (const auto& path : variant_files(other)) {
+                    resident.insert(files_.at(path).key);
+                }
+            }
+        }
+    }
+
+    size_t size = 0;
+    for (const auto& path : variant_files(variant)) {
+        const FileInfo& info = files_.at(path);
+        if (resident.insert(info.key).second) {
+            size += info.size;
+        }
+    }
+    return size;
+}
+
+void ModelRegistry::evict_lru() {
+    fprintf(stderr, "Variant %s unloaded\n", loaded_.back().name.c_str());
+    metrics_add(MetricCounter::VariantEvictions);
+    // The models shared with other variants stay loaded
+    loaded_.pop_back();
+}
+
+Pipeline* ModelRegistry::get(const std::string& name) {
+    auto it = std::find_if(loaded_.begin(), loaded_.end(), [&](const LoadedVariant& v) { return v.name == name; });
+    if (it != loaded_.end()) {
+        metrics_add(MetricCounter::VariantHits);
+        loaded_.splice(loaded_.begin(), loaded_, it);
+        return loaded_.front().pipeline.get();
+    }
+
+    auto variant = std::find_if(variants_.begin(), variants_.end(), [&](const ModelVariant& v) { return v.name == name; });
+    if (variant == variants_.end()) {
+        return nullptr;
+    }
+
+    // The files shared with the variants about to be unloaded stay loaded for this one
+    std::vector<std::shared_ptr<void>> shared;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& path : variant_files(*variant)) {
+            const std::string& key = files_.at(path).key;
+            for (const auto& entry : models_) {
+                if (entry.first.compare(0, key.size() + 1, key + "#") == 0) {
+                    shared.push_back(entry.second.lock());
+                }
+            }
+            if (tokenizers_.count(key) != 0) {
+                shared.push_back(tokenizers_[key].lock());
+            }
+        }
+    }
+
+    if (memory_budget_ > 0) {
+        while (!loaded_.empty() && resident_size() + missing_size(*variant) > memory_budget_) {
+            evict_lru();
+        }
+        if (resident_size() + missing_size(*variant) > memory_budget_) {
+            fprintf(stderr, "Warning: variant %s needs %.0f MB, more than the memory budget (%.0f MB)\n",
+                name.c_str(), to_mb(missing_size(*variant)), to_mb(memory_budget_));
+        }
+    }
+
+    metrics_add(MetricCounter::VariantLoads);
+    auto pipeline = std::make_unique<Pipeline>(backend_, variant->models_base_path);
+    pipeline->set_model_cache(this);
+    pipeline->load();
+    if (setup_) {
+        setup_(*pipeline);
+    }
+    loaded_.push_front({name, std::move(pipeline)});
+
+    fprintf(stderr, "Variant %s loaded (%.0f MB resident)\n", name.c_str(), to_mb(resident_size()));
+    return loaded_.front().pipeline.get();
+}
+
+std::shared_ptr<Model> ModelRegistry::model(const std::string& path, ModelKind kind) {
+    // The backends may load the same file differently for each kind (e.g. FP16 for the autoencoder)
+    const std::string key = files_.at(path).key + "#" + std::to_string(static_cast<int>(kind));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto model = models_[key].lock()) {
+            return model;
+        }
+    }
+
+    // Loaded without holding the lock, so that the models of a pipeline are still loaded concurrently.
+    // Without an arena, the model owns its memory and can outlive the pipeline which loaded it.
+    std::shared_ptr<Model> model = backend_.load_model(path, kind, nullptr);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto cached = models_[key].lock()) {
+        return cached;
+    }
+    models_[key] = model;
+    return model;
+}
+
+std::shared_ptr<sentencepiece::SentencePieceProcessor> ModelRegistry::tokenizer(const std::string& path) {
+    const std::string& key = files_.at(path).key;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto tokenizer = tokenizers_[key].lock()) {
+            return tokenizer;
+        }
+    }
+
+    auto tokenizer = std::make_shared<sentencepiece::SentencePieceProcessor>();
+    AUDIOGEN_CHECK(tokenizer->Load(path).ok());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto cached = tokenizers_[key].lock()) {
+        return cached;
+    }
+    tokenizers_[key] = tokenizer;
+    return tokenizer;
+}
+
+} // namespace audiogen
@@ -0,0 +1,108 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "backend.h"
+#include "pipeline.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace audiogen {
+
+// An exported model set (precision, clip length, fine-tune...), routed by name
+struct ModelVariant {
+    std::string name;
+    std::string models_base_path;
+};
+
+// Read a variants file, with one "<name> <models_base_path>" per line. Empty lines and lines
+// starting with # are skipped. Returns false (and prints the reason) on error.
+bool read_variants_file(const std::string& path, std::vector<ModelVariant>& variants);
+
+// Keeps the pipelines of several variants loaded, within a memory budget. The files identical in
+// several variants (e.g. a common T5 or tokenizer) are loaded once and shared. When a variant does
+// not fit, the least recently used variants are unloaded first.
+//
+// The memory of a variant is estimated from the size of its files, each shared file counted once.
+// A registry is meant to be used by one thread (e.g. a worker), the pipelines running one at a time.
+class ModelRegistry : private ModelCache {
+public:
+    // A budget of 0 keeps every variant loaded once used
+    ModelRegistry(Backend& backend, const std::vector<ModelVariant>& variants, size_t memory_budget);
+    ~ModelRegistry() override;
+
+    ModelRegistry(const ModelRegistry&) = delete;
+    ModelRegistry& operator=(const ModelRegistry&) = delete;
+
+    // Called on every pipeline once loaded, e.g. to warm it up
+    void set_pipeline_setup(std::function<void(Pipeline&)> setup) { setup_ = std::move(setup); }
+
+    // Pipeline of the variant, loaded if needed. Returns nullptr if the variant is unknown.
+    // The pipeline stays valid until the next call to get().
+    Pipeline* get(const std::string& name);
+
+    bool has_variant(const std::string& name) const;
+
+    // Estimated memory of the loaded variants
+    size_t resident_size() const;
+
+private:
+    // Identity of a file: the same path, or the same contents for files of the same size
+    struct FileInfo {
+        std::string key;
+        size_t size = 0;
+    };
+
+    std::shared_ptr<Model> model(const std::string& path, ModelKind kind) override;
+    std::shared_ptr<sentencepiece::SentencePieceProcessor> tokenizer(const std::string& path) override;
+
+    std::vector<std::string> variant_files(const ModelVariant& variant) const;
+    // Size of the files of the variant which are not loaded yet
+    size_t missing_size(const ModelVariant& variant) const;
+    void evict_lru();
+
+    Backend& backend_;
+    std::vector<ModelVariant> variants_;
+    size_t memory_budget_;
+    std::function<void(Pipeline&)> setup_;
+
+    std::map<std::string, FileInfo> files_;   // By path
+
+    // The shared models and tokenizers, alive as long as a pipeline uses them
+    mutable std::mutex mutex_;
+    std::map<std::string, std::weak_ptr<Model>> models_;
+    std::map<std::string, std::weak_ptr<sentencepiece::SentencePieceProcessor>> tokenizers_;
+
+    // Loaded variants, the most recently used first
+    struct LoadedVariant {
+        std::string name;
+        std::unique_ptr<Pipeline> pipeline;
+    };
+    std::list<LoadedVariant> loaded_;
+};
+
+} // namespace audiogen
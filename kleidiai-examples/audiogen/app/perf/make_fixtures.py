@@ -0,0 +1,247 @@
+#
+# SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its affiliates <open-source-office@arm.com>
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+
+# Generate tiny synthetic models with the signatures of the exported Stable Audio Open Small
+# submodules (same inputs, outputs and tensor order as the backends of the app expect), and a
+# toy SentencePiece tokenizer. The app runs them end to end in milliseconds, without downloading
+# or exporting the real checkpoints, to test the orchestration (sampler, I/O, caches, scheduling).
+# The audio they generate is meaningless.
+import argparse
+import logging
+import os
+
+import torch
+
+logging.basicConfig(level=logging.INFO)
+
+# Order of the DiT inputs, see k_litert_layout and k_executorch_layout in the app
+DIT_INPUT_ORDER = {
+    "litert": ["t", "global_cond", "cross_attn_cond", "x"],
+    "executorch": ["x", "t", "cross_attn_cond", "global_cond"],
+}
+
+# Length of the T5 sequence of the full-length conditioners of each export
+T5_SEQ_LEN = {
+    "litert": 128,
+    "executorch": 64,
+}
+
+# T5 rows of the cross-attention input of the DiT, followed by the seconds_total row
+DIT_T5_ROWS = 64
+
+MODEL_FILES = {
+    "litert": {
+        "conditioners": "conditioners_float32.tflite",
+        "conditioners_bucket": "conditioners_L{}_float32.tflite",
+        "dit": "dit_model.tflite",
+        "decoder": "autoencoder_model.tflite",
+        "encoder": "autoencoder_encoder_model.tflite",
+    },
+    "executorch": {
+        "conditioners": "conditioners_model.pte",
+        "conditioners_bucket": "conditioners_model_L{}.pte",
+        "dit": "dit_model.pte",
+        "decoder": "autoencoder_model.pte",
+        "encoder": "autoencoder_encoder_model.pte",
+    },
+}
+
+# Text of the toy tokenizer, covering the prompts of scenarios.json
+TOKENIZER_CORPUS = [
+    "warm arpeggios on house beats 120BPM with drums effect",
+    "ambient pad with soft rain and distant thunder",
+    "birds singing in the morning",
+    "lofi hip hop beat with vinyl crackle and mellow piano",
+    "techno kick and hi-hats at 130 BPM",
+    "acoustic guitar strumming with a gentle melody",
+    "orchestral strings swelling into a cinematic climax",
+    "deep bass drone with metallic percussion",
+]
+
+
+## ----------------- Tiny Submodules -------------------
+class TinyConditioners(torch.nn.Module):
+    """Embedding of the tokens, mixed with the masked mean of the prompt as the attention of
+    T5 would, followed by the seconds_total embedding. Like the real export, at most 64 T5
+    rows are returned, and the padding rows are zero."""
+
+    def __init__(self, vocab_size: int, dim: int):
+        super().__init__()
+        self.embedding = torch.nn.Embedding(vocab_size, dim)
+        self.proj = torch.nn.Linear(dim, dim)
+        self.seconds = torch.nn.Linear(1, dim)
+
+    def forward(self, input_ids, attention_mask, seconds_total):
+        input_ids = input_ids[:, :DIT_T5_ROWS]
+        mask = attention_mask[:, :DIT_T5_ROWS].float()
+
+        tokens = self.embedding(input_ids) * mask.unsqueeze(-1)
+        context = tokens.sum(dim=1, keepdim=True) / mask.sum(dim=1, keepdim=True).clamp(min=1.0).unsqueeze(-1)
+        t5_proj = torch.tanh(self.proj(tokens + context)) * mask.unsqueeze(-1)
+
+        seconds_embedding = self.seconds(seconds_total.clamp(0.0, 256.0).view(1, 1) / 256.0).unsqueeze(1)
+
+        cross_attention_input = torch.cat([t5_proj, seconds_embedding], dim=1)
+        cross_attention_masks = torch.cat([mask, torch.ones(1, 1)], dim=1)
+        global_cond = seconds_embedding.squeeze(1)
+        return cross_attention_input, cross_attention_masks, global_cond
+
+
+class TinyDiT(torch.nn.Module):
+    """Predicts v from x, t and the conditioning. num_layers sets the cost of a step."""
+
+    def __init__(self, channels: int, frames: int, dim: int, num_layers: int):
+        super().__init__()
+        self.cond = torch.nn.Linear(dim, channels)
+        self.layers = torch.nn.ModuleList([torch.nn.Linear(frames, frames) for _ in range(num_layers)])
+
+    def forward(self, x, t, cross_attn_cond, global_cond):
+        cond = self.cond(cross_attn_cond.mean(dim=1) + global_cond)
+        h = x + cond.unsqueeze(-1) + t.view(1, 1, 1)
+        for layer in self.layers:
+            h = torch.tanh(layer(h))
+        return h
+
+
+class OrderedInputs(torch.nn.Module):
+    """Takes the inputs of the wrapped module positionally, in the order of the backend."""
+
+    def __init__(self, module: torch.nn.Module, order: list):
+        super().__init__()
+        self.module = module
+        self.order = order
+
+    def forward(self, *args):
+        return self.module(**dict(zip(self.order, args)))
+
+
+class TinyDecoder(torch.nn.Module):
+    def __init__(self, channels: int, hop: int):
+        super().__init__()
+        self.upsample = torch.nn.ConvTranspose1d(channels, 2, kernel_size=hop, stride=hop)
+
+    def forward(self, latent):
+        return torch.tanh(self.upsample(latent))
+
+
+class TinyEncoder(torch.nn.Module):
+    def __init__(self, channels: int, hop: int):
+        super().__init__()
+        self.downsample = torch.nn.Conv1d(2, channels, kernel_size=hop, stride=hop)
+
+    def forward(self, audio):
+        return self.downsample(audio)
+
+
+## ----------------- Exporters -------------------
+def export_litert(module: torch.nn.Module, example_inputs: tuple, path: str) -> None:
+    import ai_edge_torch
+    from ai_edge_litert.interpreter import Interpreter
+
+    ai_edge_torch.convert(module.eval(), example_inputs).export(path)
+
+    # The app binds the tensors by index, check the converter kept the order of the arguments
+    interpreter = Interpreter(model_path=path)
+    shapes = [list(detail["shape"]) for detail in interpreter.get_input_details()]
+    expected = [list(tensor.shape) for tensor in example_inputs]
+    if shapes != expected:
+        raise RuntimeError(f"{path}: inputs {shapes}, expected {expected}")
+
+
+def export_executorch(module: torch.nn.Module, example_inputs: tuple, path: str) -> None:
+    from executorch.backends.xnnpack.partition.xnnpack_partitioner import XnnpackPartitioner
+    from executorch.exir import to_edge_transform_and_lower
+
+    exported_program = torch.export.export(module.eval(), example_inputs)
+    edge = to_edge_transform_and_lower(exported_program, partitioner=[XnnpackPartitioner()])
+    with open(path, "wb") as file:
+        edge.to_executorch().write_to_file(file)
+
+
+def make_tokenizer(output_path: str) -> int:
+    """Train the toy tokenizer, with the special ids of the T5 one (pad 0, EOS 1, unk 2).
+    Returns:
+        int: The size of the vocabulary
+    """
+    import sentencepiece as spm
+
+    spm.SentencePieceTrainer.train(
+        sentence_iterator=iter(TOKENIZER_CORPUS * 4),
+        model_prefix=os.path.join(output_path, "spiece"),
+        vocab_size=96,
+        hard_vocab_limit=False,
+        pad_id=0,
+        eos_id=1,
+        unk_id=2,
+        bos_id=-1,
+        minloglevel=2,
+    )
+    return spm.SentencePieceProcessor(model_file=os.path.join(output_path, "spiece.model")).get_piece_size()
+
+
+def make_fixtures(args) -> None:
+    torch.manual_seed(args.seed)
+    os.makedirs(args.output_path, exist_ok=True)
+    export = export_litert if args.backend == "litert" else export_executorch
+    files = MODEL_FILES[args.backend]
+
+    vocab_size = make_tokenizer(args.output_path)
+    conditioners = TinyConditioners(vocab_size, args.dim)
+    dit = OrderedInputs(
+        TinyDiT(args.channels, args.frames, args.dim, args.dit_layers), DIT_INPUT_ORDER[args.backend]
+    )
+    num_samples = args.frames * args.hop
+
+    def conditioners_input(seq_length: int):
+        return (
+            torch.ones((1, seq_length), dtype=torch.int64),
+            torch.ones((1, seq_length), dtype=torch.int64),
+            torch.tensor([10.0]),
+        )
+
+    outputs = [(files["conditioners"], conditioners, conditioners_input(T5_SEQ_LEN[args.backend]))]
+    for seq_length in args.t5_buckets:
+        outputs.append((files["conditioners_bucket"].format(seq_length), conditioners, conditioners_input(seq_length)))
+
+    dit_inputs = {
+        "x": torch.rand((1, args.channels, args.frames)),
+        "t": torch.tensor([0.5]),
+        "cross_attn_cond": torch.rand((1, DIT_T5_ROWS + 1, args.dim)),
+        "global_cond": torch.rand((1, args.dim)),
+    }
+    outputs.append((files["dit"], dit, tuple(dit_inputs[name] for name in DIT_INPUT_ORDER[args.backend])))
+    outputs.append((files["decoder"], TinyDecoder(args.channels, args.hop), (torch.rand((1, args.channels, args.frames)),)))
+    outputs.append((files["encoder"], TinyEncoder(args.channels, args.hop), (torch.rand((1, 2, num_samples)),)))
+
+    for file_name, module, example_inputs in outputs:
+        logging.info("Exporting %s...", file_name)
+        export(module, example_inputs, os.path.join(args.output_path, file_name))
+
+    logging.info(
+        "Fixtures written to %s: %d latent channels, %d frames, %d samples (%.2f s)",
+        args.output_path, args.channels, args.frames, num_samples, num_samples / 44100.0,
+    )
+
+
+def main():
+    """Generate the tiny models and the tokenizer of one backend."""
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--backend", choices=["litert", "executorch"], default="litert", help="Format of the models")
+    parser.add_argument("--output_path", required=True, help="Models directory to create, passed to the app with -m")
+    parser.add_argument("--channels", type=int, default=8, help="Latent channels")
+    parser.add_argument("--frames", type=int, default=32, help="Latent frames")
+    parser.add_argument("--hop", type=int, default=256, help="Audio samples per latent frame")
+    parser.add_argument("--dim", type=int, default=48, help="Width of the conditioning")
+    parser.add_argument("--dit_layers", type=int, default=2, help="Layers of the DiT, to scale the cost of a step")
+    parser.add_argument(
+        "--t5_buckets", type=int, nargs="*", choices=[8, 16, 32], default=[], help="Also export these token-length buckets"
+    )
+    parser.add_argument("--seed", type=int, default=0, help="Seed of the weights")
+    make_fixtures(parser.parse_args())
+
+
+if __name__ == "__main__":
+    main()
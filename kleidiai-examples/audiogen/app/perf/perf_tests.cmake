@@ -0,0 +1,78 @@
+#
+# SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its affiliates <open-source-office@arm.com>
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+
+# Performance regression tests, shared by the LiteRT and the ExecuTorch apps.
+# One CTest test per scenario of scenarios.json, run with: ctest -L perf
+find_package(Python3 COMPONENTS Interpreter REQUIRED)
+
+set(AUDIOGEN_PERF_MODELS_PATH "" CACHE PATH "Models directory used by the performance tests")
+set(AUDIOGEN_PERF_HOST_CLASS "" CACHE STRING "Baseline of the performance tests (Default: derived from the CPU)")
+set(AUDIOGEN_PERF_TOLERANCE "" CACHE STRING "Relative tolerance of every stage, overriding scenarios.json")
+option(AUDIOGEN_PERF_FIXTURES "Run the performance tests on tiny synthetic models generated by make_fixtures.py" OFF)
+
+set(AUDIOGEN_PERF_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+function(audiogen_add_perf_tests backend)
+  execute_process(
+    COMMAND ${Python3_EXECUTABLE} ${AUDIOGEN_PERF_DIR}/run_perf.py --list-scenarios
+    OUTPUT_VARIABLE scenarios
+    OUTPUT_STRIP_TRAILING_WHITESPACE
+    RESULT_VARIABLE result
+  )
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Cannot list the performance scenarios")
+  endif()
+  string(REPLACE "\n" ";" scenarios "${scenarios}")
+
+  set(extra_args "")
+  if(AUDIOGEN_PERF_HOST_CLASS)
+    list(APPEND extra_args --host-class ${AUDIOGEN_PERF_HOST_CLASS})
+  endif()
+  if(AUDIOGEN_PERF_TOLERANCE)
+    list(APPEND extra_args --tolerance ${AUDIOGEN_PERF_TOLERANCE})
+  endif()
+
+  set(models_path ${AUDIOGEN_PERF_MODELS_PATH})
+  set(fixtures "")
+  if(AUDIOGEN_PERF_FIXTURES)
+    # Generated once by a setup test, and compared against their own baselines,
+    # since the timings and the checksums have nothing in common with the real models.
+    # Without a baseline for the host, the scenarios still have to run and be deterministic.
+    set(models_path ${CMAKE_BINARY_DIR}/perf_fixtures/${backend})
+    set(fixtures perf_fixtures_${backend})
+    list(APPEND extra_args --baseline-dir ${AUDIOGEN_PERF_DIR}/baselines/fixtures --allow-missing-baseline)
+    add_test(
+      NAME perf_${backend}_make_fixtures
+      COMMAND ${Python3_EXECUTABLE} ${AUDIOGEN_PERF_DIR}/make_fixtures.py
+        --backend ${backend}
+        --output_path ${models_path}
+    )
+    set_tests_properties(perf_${backend}_make_fixtures PROPERTIES
+      LABELS perf
+      FIXTURES_SETUP ${fixtures}
+    )
+  endif()
+
+  foreach(scenario ${scenarios})
+    add_test(
+      NAME perf_${backend}_${scenario}
+      COMMAND ${Python3_EXECUTABLE} ${AUDIOGEN_PERF_DIR}/run_perf.py
+        --binary $<TARGET_FILE:audiogen>
+        --models ${models_path}
+        --backend ${backend}
+        --scenario ${scenario}
+        ${extra_args}
+    )
+    # The tests are timed, so they must not run in parallel
+    set_tests_properties(perf_${backend}_${scenario} PROPERTIES
+      LABELS perf
+      RUN_SERIAL TRUE
+      SKIP_RETURN_CODE 77
+      TIMEOUT 3600
+      FIXTURES_REQUIRED "${fixtures}"
+    )
+  endforeach()
+endfunction()
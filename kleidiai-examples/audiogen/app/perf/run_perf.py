@@ -0,0 +1,259 @@
+#
+# SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its affiliates <open-source-office@arm.com>
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+
+# Performance regression test of the audiogen app: run a fixed scenario (prompt, seed, steps)
+# several times, and compare the median time of every stage and the output checksums against
+# the baseline recorded for this class of host.
+import argparse
+import json
+import math
+import os
+import platform
+import re
+import statistics
+import subprocess
+import sys
+import tempfile
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+
+# Exit code reported as "skipped" by CTest (SKIP_RETURN_CODE)
+EXIT_SKIPPED = 77
+
+STAGES = ["t5_ms", "dit_ms", "autoencoder_ms", "total_ms"]
+
+
+## ----------------- Utility Functions -------------------
+def load_json(path: str):
+    with open(path, "r", encoding="utf-8") as f:
+        return json.load(f)
+
+
+def get_host_class() -> str:
+    """Name of the baseline file for this machine: OS, architecture and CPU model.
+    Returns:
+        str: e.g. linux-aarch64-0x41-0xd8e
+    """
+    cpu = "unknown"
+    if platform.system() == "Darwin":
+        result = subprocess.run(["sysctl", "-n", "machdep.cpu.brand_string"], capture_output=True, text=True, check=False)
+        cpu = result.stdout.strip() or cpu
+    elif os.path.exists("/proc/cpuinfo"):
+        with open("/proc/cpuinfo", "r", encoding="utf-8") as f:
+            cpuinfo = f.read()
+        model_name = re.search(r"^model name\s*:\s*(.+)$", cpuinfo, re.MULTILINE)
+        implementer = re.search(r"^CPU implementer\s*:\s*(\S+)$", cpuinfo, re.MULTILINE)
+        part = re.search(r"^CPU part\s*:\s*(\S+)$", cpuinfo, re.MULTILINE)
+        if model_name:
+            cpu = model_name.group(1)
+        elif implementer and part:
+            # Arm CPUs only report their implementer and part numbers
+            cpu = implementer.group(1) + "-" + part.group(1)
+
+    host_class = "-".join([platform.system(), platform.machine(), cpu]).lower()
+    return re.sub(r"[^a-z0-9]+", "-", host_class).strip("-")
+
+
+def get_scenario(scenarios: dict, name: str) -> dict:
+    """Scenario with the defaults applied."""
+    for scenario in scenarios["scenarios"]:
+        if scenario["name"] == name:
+            merged = dict(scenarios["defaults"])
+            merged.update(scenario)
+            return merged
+    raise KeyError(f"Unknown scenario {name}")
+
+
+def run_scenario(args, scenario: dict, work_dir: str) -> list:
+    """Run the app repeats + 1 times, the first run only warms up the page cache.
+    Returns:
+        list: The reports of the timed runs
+    """
+    reports = []
+    for run in range(scenario["repeats"] + 1):
+        report_path = os.path.join(work_dir, f"report_{run}.json")
+        cmd = [
+            args.binary,
+            "-m", args.models,
+            "-b", args.backend,
+            "-p", scenario["prompt"],
+            "-t", str(scenario["num_threads"]),
+            "-s", str(scenario["seed"]),
+            "-n", str(scenario["num_steps"]),
+            "-l", str(scenario["audio_len_sec"]),
+            "-d", "true",
+            "-o", os.path.join(work_dir, "output.wav"),
+            "--report-json", report_path,
+        ] + scenario.get("extra_args", [])
+
+        result = subprocess.run(cmd, capture_output=True, text=True, check=False)
+        if result.returncode != 0:
+            print(" ".join(cmd))
+            print(result.stdout)
+            print(result.stderr)
+            raise RuntimeError(f"audiogen exited with code {result.returncode}")
+
+        report = load_json(report_path)
+        report["total_ms"] = report["t5_ms"] + report["dit_ms"] + report["autoencoder_ms"]
+        if run > 0:
+            reports.append(report)
+    return reports
+
+
+def summarize(reports: list) -> dict:
+    """Median of every stage, and the output of the first run."""
+    summary = {stage: statistics.median(report[stage] for report in reports) for stage in STAGES}
+    summary["latent_checksum"] = reports[0]["latent_checksum"]
+    summary["audio_fingerprint"] = reports[0].get("audio_fingerprint", [])
+    return summary
+
+
+def audio_error(fingerprint: list, reference: list) -> float:
+    """Largest difference between the segment RMS of two clips, relative to the loudest segment."""
+    if len(fingerprint) != len(reference) or not reference:
+        return float("inf")
+    peak = max(max(reference), 1e-6)
+    return max(abs(a - b) for a, b in zip(fingerprint, reference)) / peak
+
+
+## ----------------- Checks -------------------
+def compare(scenario: dict, summary: dict, baseline: dict, tolerance_override) -> list:
+    """Compare a summary against its baseline, and print the differences as a table.
+    Returns:
+        list: The failures, empty if the scenario passed
+    """
+    failures = []
+
+    print(f"{'stage':<16} {'baseline':>10} {'median':>10} {'change':>8} {'tolerance':>10}")
+    for stage in STAGES:
+        reference = baseline[stage]
+        value = summary[stage]
+        tolerance = tolerance_override if tolerance_override is not None else scenario["tolerances"][stage]
+        change = (value - reference) / max(reference, 1)
+
+        status = "ok"
+        if value - reference > scenario["min_delta_ms"] and change > tolerance:
+            status = "REGRESSION"
+            failures.append(f"{stage} is {change:+.1%} slower than the baseline (tolerance {tolerance:.0%})")
+        elif reference - value > scenario["min_delta_ms"] and -change > tolerance:
+            status = "faster, consider updating the baseline"
+
+        print(f"{stage:<16} {reference:>8.0f}ms {value:>8.0f}ms {change:>+8.1%} {tolerance:>10.0%}  {status}")
+
+    # Same latent: the numerics are unchanged. Otherwise the audio may still be close enough,
+    # e.g. after a change of kernel or of compiler.
+    if summary["latent_checksum"] == baseline["latent_checksum"]:
+        print(f"latent checksum  {summary['latent_checksum']}  ok")
+    else:
+        error = audio_error(summary["audio_fingerprint"], baseline["audio_fingerprint"])
+        print(f"latent checksum  {baseline['latent_checksum']} -> {summary['latent_checksum']}  changed")
+        print(f"audio error      {error:.4f} (tolerance {scenario['audio_tolerance']})")
+        if error > scenario["audio_tolerance"]:
+            failures.append(f"the audio differs from the baseline by {error:.4f} (tolerance {scenario['audio_tolerance']})")
+
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Performance regression test of the audiogen app")
+    parser.add_argument("--binary", help="Path to the audiogen executable")
+    parser.add_argument("--models", help="Models directory passed to -m")
+    parser.add_argument("--backend", default="litert", help="Backend passed to -b")
+    parser.add_argument("--scenario", help="Name of the scenario to run (see scenarios.json)")
+    parser.add_argument("--scenarios", default=os.path.join(SCRIPT_DIR, "scenarios.json"), help="Scenarios file")
+    parser.add_argument("--baseline-dir", default=os.path.join(SCRIPT_DIR, "baselines"), help="Directory of the baseline files")
+    parser.add_argument("--host-class", default=None, help="Baseline to compare against (Default: derived from the CPU)")
+    parser.add_argument("--threads", type=int, default=None, help="Override the number of threads of the scenario")
+    parser.add_argument("--repeats", type=int, default=None, help="Override the number of timed runs of the scenario")
+    parser.add_argument("--tolerance", type=float, default=None, help="Override the relative tolerance of every stage")
+    parser.add_argument("--update-baseline", action="store_true", help="Record the results as the new baseline")
+    parser.add_argument(
+        "--allow-missing-baseline",
+        action="store_true",
+        help="Without a baseline, still run the scenario and check that it succeeds and is deterministic",
+    )
+    parser.add_argument("--list-scenarios", action="store_true", help="Print the scenario names and exit")
+    args = parser.parse_args()
+
+    scenarios = load_json(args.scenarios)
+    if args.list_scenarios:
+        print("\n".join(scenario["name"] for scenario in scenarios["scenarios"]))
+        return 0
+
+    if not args.binary or not args.scenario:
+        parser.error("--binary and --scenario are required")
+    if not args.models or not os.path.isdir(args.models):
+        print(f"SKIPPED: models directory '{args.models}' not found (set AUDIOGEN_PERF_MODELS_PATH)")
+        return EXIT_SKIPPED
+
+    scenario = get_scenario(scenarios, args.scenario)
+    if args.threads is not None:
+        scenario["num_threads"] = args.threads
+    if args.repeats is not None:
+        scenario["repeats"] = args.repeats
+
+    host_class = args.host_class or get_host_class()
+    baseline_path = os.path.join(args.baseline_dir, host_class + ".json")
+    baselines = load_json(baseline_path) if os.path.exists(baseline_path) else {}
+    baseline = baselines.get(args.backend, {}).get(args.scenario)
+
+    if baseline is None and not args.update_baseline and not args.allow_missing_baseline:
+        print(f"SKIPPED: no baseline for {args.backend}/{args.scenario} in {baseline_path}")
+        print("Record one on a quiet machine with --update-baseline")
+        return EXIT_SKIPPED
+
+    print(f"Scenario {args.scenario} ({args.backend}, {scenario['num_threads']} threads, "
+          f"median of {scenario['repeats']} runs), host class {host_class}")
+
+    with tempfile.TemporaryDirectory() as work_dir:
+        reports = run_scenario(args, scenario, work_dir)
+
+    # The same scenario must give the same latent on every run
+    checksums = sorted(set(report["latent_checksum"] for report in reports))
+    if len(checksums) > 1:
+        print(f"FAILED: the latent differs between the runs: {', '.join(checksums)}")
+        return 1
+
+    summary = summarize(reports)
+    if any(not math.isfinite(value) for value in summary["audio_fingerprint"]):
+        print("FAILED: the audio is not finite")
+        return 1
+
+    if baseline is None and not args.update_baseline:
+        print(f"No baseline for {args.backend}/{args.scenario} in {baseline_path}, the timings are not compared")
+        print(f"latent checksum  {summary['latent_checksum']}  same on the {len(reports)} runs")
+        print("PASSED")
+        return 0
+
+    if args.update_baseline:
+        summary["num_threads"] = scenario["num_threads"]
+        summary["repeats"] = scenario["repeats"]
+        baselines.setdefault(args.backend, {})[args.scenario] = summary
+        os.makedirs(args.baseline_dir, exist_ok=True)
+        with open(baseline_path, "w", encoding="utf-8") as f:
+            json.dump(baselines, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"Baseline recorded in {baseline_path}")
+        return 0
+
+    if baseline.get("num_threads") != scenario["num_threads"]:
+        print(f"SKIPPED: the baseline was recorded with {baseline.get('num_threads')} threads, "
+              f"not {scenario['num_threads']}")
+        return EXIT_SKIPPED
+
+    failures = compare(scenario, summary, baseline, args.tolerance)
+    if failures:
+        print("FAILED:")
+        for failure in failures:
+            print(f"  - {failure}")
+        return 1
+
+    print("PASSED")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
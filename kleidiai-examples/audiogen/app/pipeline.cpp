@@ -0,0 +1,911 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pipeline.h"
+#include "alloc_counter.h"
+#include "audio_io.h"
+#include "common.h"
+#include "dit_capture.h"
+#include "latent_io.h"
+#include "metrics.h"
+#include "result_cache.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+
+#include <sentencepiece_processor.h>
+
+namespace audiogen {
+
+// T5 end-of-sequence token
+constexpr int32_t k_t5_eos_id = 1;
+
+// The chunks of the encoder overlap by 1/8 of the encoder input
+constexpr size_t k_encoder_overlap_divisor = 8;
+
+void fill_random_norm_dist(float* buff, size_t buff_sz, size_t seed) {
+    std::mt19937 gen(seed);
+    std::normal_distribution<float> dis(0.0f, 1.0f);
+
+    auto gen_fn = [&dis, &gen](){ return dis(gen); };
+    std::generate(buff, buff + buff_sz, gen_fn);
+}
+
+void fill_sigmas(std::vector<float>& arr, float start, float end, float sigma_max) {
+
+    const int32_t sz = static_cast<int32_t>(arr.size());
+    const float step = ((end - start) / static_cast<float> (sz - 1));
+
+    // Linspace
+    arr[0]      = start;
+    arr[sz - 1] = end;
+
+    for(int32_t i = 1; i < sz - 1; ++i) {
+        arr[i] = arr[i - 1] + step;
+    }
+
+    // Sigmoid(-logsnr)
+    for(int32_t i = 0; i < sz; ++i) {
+        arr[i] = 1.0f / (1.0f + std::exp(arr[i])) ;
+    }
+
+    arr[0]      = sigma_max;
+    arr[sz - 1] = k_sigma_min;
+}
+
+size_t fill_truncated_sigmas(std::vector<float>& arr, size_t num_steps, float sigma_max) {
+    arr.resize(num_steps + 1);
+    fill_sigmas(arr, k_logsnr_max, 2.0f, k_sigma_max);
+
+    // The sigmas are decreasing, and the last one is 0
+    size_t num_dropped = 0;
+    while (num_dropped + 1 < num_steps && arr[num_dropped + 1] >= sigma_max) {
+        ++num_dropped;
+    }
+    arr[num_dropped] = sigma_max;
+    return num_dropped;
+}
+
+std::vector<std::string> find_conditioners_buckets(const Backend& backend, const std::string& models_base_path) {
+    std::vector<std::string> paths;
+    for (const size_t seq_len : k_t5_bucket_lengths) {
+        const std::string path = backend.conditioners_bucket_path(models_base_path, seq_len);
+        if (std::ifstream(path).good()) {
+            paths.push_back(path);
+        }
+    }
+    return paths;
+}
+
+float relative_change(const float* curr, const float* prev, size_t num_elems) {
+    double diff_sq = 0.0;
+    double norm_sq = 0.0;
+    for (size_t i = 0; i < num_elems; ++i) {
+        const double diff = curr[i] - prev[i];
+        diff_sq += diff * diff;
+        norm_sq += static_cast<double>(curr[i]) * curr[i];
+    }
+    if (norm_sq == 0.0) {
+        return diff_sq == 0.0 ? 0.0f : 1.0f;
+    }
+    return static_cast<float>(std::sqrt(diff_sq / norm_sq));
+}
+
+void sampler_ping_pong(float* dit_out_data, float* dit_x_in_data, float* noise, size_t dit_x_in_sz, float cur_t, float next_t, size_t seed) {
+    AUDIOGEN_TRACE("sampler");
+    AUDIOGEN_METRIC_TIMER(MetricStage::Sampler);
+
+    for(size_t i = 0; i < dit_x_in_sz; i++) {
+        dit_out_data[i] = dit_x_in_data[i] - ( cur_t * dit_out_data[i]);
+    }
+
+    {
+        AUDIOGEN_TRACE("noise");
+        fill_random_norm_dist(noise, dit_x_in_sz, seed);
+    }
+
+    // x = (1-t_next) * denoised + t_next * torch.randn_like(x)
+    for(size_t i = 0; i < dit_x_in_sz; i++) {
+        dit_x_in_data[i] = ((1.0f - next_t) * dit_out_data[i]) + (next_t * noise[i]);
+    }
+}
+
+// Zero the tensor, then write the values at the beginning of it
+// The cross-attention input is made of the T5 rows followed by the seconds_total row. The
+// conditioners exported for shorter prompts have fewer T5 rows: the missing ones are padding,
+// which the conditioners zero (t5_proj * attention_mask), so they are zeroed here as well. The DiT
+// keeps all its rows, since it attends to the zero rows too (with a logit of 0, not -inf).
+static void copy_cross_attention(const TensorView& t5_out, const TensorView& dit_in) {
+    const size_t row_size = static_cast<size_t>(dit_in.dims[2]);
+    const size_t dit_t5_rows = static_cast<size_t>(dit_in.dims[1]) - 1;
+    const size_t out_t5_rows = static_cast<size_t>(t5_out.dims[1]) - 1;
+    const size_t num_copied = std::min(out_t5_rows, dit_t5_rows);
+
+    const float* src = t5_out.as<float>();
+    float* dst = dit_in.as<float>();
+    memcpy(dst, src, num_copied * row_size * sizeof(float));
+    std::fill(dst + num_copied * row_size, dst + dit_t5_rows * row_size, 0.0f);
+    memcpy(dst + dit_t5_rows * row_size, src + out_t5_rows * row_size, row_size * sizeof(float));
+}
+
+static void fill_int_tensor(const TensorView& tensor, const std::vector<int32_t>& values) {
+    const size_t num_elems = tensor.num_elems();
+    AUDIOGEN_CHECK(values.size() <= num_elems);
+
+    if (tensor.type == DataType::Int64) {
+        int64_t* data = tensor.as<int64_t>();
+        std::fill(data, data + num_elems, 0);
+        std::copy(values.begin(), values.end(), data);
+    } else {
+        AUDIOGEN_CHECK(tensor.type == DataType::Int32);
+        int32_t* data = tensor.as<int32_t>();
+        std::fill(data, data + num_elems, 0);
+        std::copy(values.begin(), values.end(), data);
+    }
+}
+
+Pipeline::Pipeline(Backend& backend, const std::string& models_base_path)
+    : backend_(backend), models_base_path_(models_base_path) {}
+
+Pipeline::~Pipeline() = default;
+
+void Pipeline::load() {
+    load_models(false);
+}
+
+void Pipeline::load_decoder() {
+    load_models(true);
+}
+
+void Pipeline::load_models(bool decoder_only) {
+    const std::string t5_path = backend_.model_path(models_base_path_, ModelKind::Conditioners);
+    const std::string dit_path = backend_.model_path(models_base_path_, ModelKind::DiT);
+    const std::string autoencoder_path = backend_.model_path(models_base_path_, ModelKind::Decoder);
+
+    // The models and the tokenizer are independent, so they are loaded (and the delegates
+    // initialized) concurrently, to cut the cold start time
+    struct LoadTask {
+        std::string name;
+        std::string model_path;     // Empty for the tokenizer
+        std::function<void()> load;
+    };
+    auto load_model = [this](const std::string& path, ModelKind kind) -> std::shared_ptr<Model> {
+        if (model_cache_ != nullptr) {
+            return model_cache_->model(path, kind);
+        }
+        return backend_.load_model(path, kind, arena_.get());
+    };
+
+    std::vector<LoadTask> tasks;
+    std::vector<std::string> bucket_paths;
+    if (!decoder_only) {
+        tasks.push_back({"T5", t5_path, [&] { t5_ = load_model(t5_path, ModelKind::Conditioners); }});
+        bucket_paths = find_conditioners_buckets(backend_, models_base_path_);
+        t5_buckets_.assign(bucket_paths.size(), nullptr);
+        for (size_t i = 0; i < bucket_paths.size(); ++i) {
+            const std::string& path = bucket_paths[i];
+            tasks.push_back({"T5 " + path.substr(path.find_last_of('/') + 1), path, [&, i] {
+                t5_buckets_[i] = load_model(bucket_paths[i], ModelKind::Conditioners);
+            }});
+        }
+        tasks.push_back({"DiT", dit_path, [&] { dit_ = load_model(dit_path, ModelKind::DiT); }});
+    }
+    tasks.push_back({"AutoEncoder", autoencoder_path, [&] { autoencoder_ = load_model(autoencoder_path, ModelKind::Decoder); }});
+    if (!decoder_only) {
+        tasks.push_back({"Tokenizer", "", [&] {
+            const std::string tokenizer_path = models_base_path_ + "/spiece.model";
+            if (model_cache_ != nullptr) {
+                tokenizer_ = model_cache_->tokenizer(tokenizer_path);
+                return;
+            }
+            tokenizer_ = std::make_shared<sentencepiece::SentencePieceProcessor>();
+            AUDIOGEN_CHECK(tokenizer_->Load(tokenizer_path).ok());
+        }});
+    }
+
+    // One arena for all the models, sized up front from their memory plans
+    size_t arena_size = 0;
+    for (const auto& task : tasks) {
+        if (!task.model_path.empty() && model_cache_ == nullptr) {
+            arena_size += backend_.planned_memory_size(task.model_path);
+        }
+    }
+    if (arena_size > 0) {
+        arena_ = std::make_unique<MemoryArena>(arena_size, backend_.memory_options());
+    }
+
+    // The memory options only apply to what the runtimes map while loading
+    const MappingSnapshot mappings_before = take_mapping_snapshot();
+
+    load_timeline_.assign(tasks.size(), LoadEvent());
+    const long start_load = time_in_ms();
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        threads.emplace_back([&, i]() {
+            LoadEvent& event = load_timeline_[i];
+            event.name = tasks[i].name;
+            event.start_ms = time_in_ms() - start_load;
+            tasks[i].load();
+            event.end_ms = time_in_ms() - start_load;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // By ascending sequence length, for set_prompt() to pick the first one the prompt fits in
+    const size_t ids_idx = backend_.layout().t5_ids_in_idx;
+    std::sort(t5_buckets_.begin(), t5_buckets_.end(), [ids_idx](const std::shared_ptr<Model>& a, const std::shared_ptr<Model>& b) {
+        return a->input(ids_idx).num_elems() < b->input(ids_idx).num_elems();
+    });
+
+    // The packed weights and the arenas allocated by the runtimes now exist
+    apply_memory_options(backend_.memory_options(), mappings_before);
+
+    if (dit_ != nullptr) {
+        noise_.resize(dit_->input(backend_.layout().dit_x_in_idx).num_elems());
+        prev_denoised_.resize(noise_.size());
+    }
+}
+
+void Pipeline::warmup() {
+    const MappingSnapshot mappings_before = take_mapping_snapshot();
+
+    std::vector<Model*> models = {t5_.get(), dit_.get(), autoencoder_.get()};
+    for (const auto& bucket : t5_buckets_) {
+        models.push_back(bucket.get());
+    }
+    for (Model* model : models) {
+        if (model == nullptr) {
+            continue;
+        }
+        for (size_t i = 0; i < model->num_inputs(); ++i) {
+            const TensorView input = model->input(i);
+            if (input.type == DataType::Float32) {
+                fill_random_norm_dist(input.as<float>(), input.num_elems(), i);
+            } else {
+                fill_int_tensor(input, {});
+            }
+        }
+        AUDIOGEN_CHECK(model->invoke());
+    }
+
+    // Some delegates allocate their workspace on the first run
+    apply_memory_options(backend_.memory_options(), mappings_before);
+}
+
+// Exponential moving average, which follows the load of the host within a few generations
+static void update_stage_cost(float& cost_ms, float measured_ms) {
+    constexpr float k_weight = 0.3f;
+    cost_ms = cost_ms > 0.0f ? cost_ms + k_weight * (measured_ms - cost_ms) : measured_ms;
+}
+
+const StageCosts& Pipeline::calibrate() {
+    AUDIOGEN_CHECK(t5_ != nullptr && dit_ != nullptr && autoencoder_ != nullptr);
+    const TensorLayout& layout = backend_.layout();
+    warmup();
+
+    // One more run of each model, warm this time
+    auto time_invoke = [](Model& model) {
+        const long long start = time_in_ns();
+        AUDIOGEN_CHECK(model.invoke());
+        return static_cast<float>(time_in_ns() - start) / 1e6f;
+    };
+
+    *t5_->input(layout.t5_audio_len_in_idx).as<float>() = static_cast<float>(k_audio_len_sec_default);
+    *dit_->input(layout.dit_t_in_idx).as<float>() = k_sigma_max;
+
+    stage_costs_.t5_ms = time_invoke(*t5_);
+    // A DiT step is the invoke and the sampler, whose cost is negligible in comparison
+    stage_costs_.dit_step_ms = time_invoke(*dit_);
+    stage_costs_.autoencoder_ms = time_invoke(*autoencoder_);
+    return stage_costs_;
+}
+
+std::string Pipeline::encoder_cache_path(uint64_t audio_hash) {
+    // The model is hashed once, a different export (or backend) gives a different latent
+    if (encoder_model_hash_ == 0) {
+        encoder_model_hash_ = hash_file(backend_.model_path(models_base_path_, ModelKind::Encoder));
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx_%016llx.latent",
+        static_cast<unsigned long long>(audio_hash), static_cast<unsigned long long>(encoder_model_hash_));
+    return encoder_cache_dir_ + "/" + name;
+}
+
+std::vector<float> Pipeline::encode_chunks(const std::vector<float>& left_ch, const std::vector<float>& right_ch, size_t& num_frames) {
+    if (encoder_ == nullptr) {
+        encoder_ = backend_.load_model(backend_.model_path(models_base_path_, ModelKind::Encoder), ModelKind::Encoder);
+    }
+
+    const TensorView encoder_in = encoder_->input(0);
+    const TensorView encoder_out = encoder_->output(0);
+    AUDIOGEN_CHECK(encoder_out.dims.size() == 3);
+
+    // Divided by 2 because we have two channels
+    const size_t window = encoder_in.num_elems() / 2;
+    const size_t num_channels = static_cast<size_t>(encoder_out.dims[1]);
+    const size_t window_frames = static_cast<size_t>(encoder_out.dims[2]);
+    const size_t samples_per_frame = window / window_frames;
+    AUDIOGEN_CHECK(samples_per_frame * window_frames == window);
+
+    const size_t num_samples = std::min(left_ch.size(), right_ch.size());
+    num_frames = std::max<size_t>(1, (num_samples + samples_per_frame - 1) / samples_per_frame);
+
+    // The chunks overlap, so that every latent frame is computed with some context on both
+    // sides, and are crossfaded linearly over the overlap
+    const size_t overlap = num_frames > window_frames ? window_frames / k_encoder_overlap_divisor : 0;
+    const size_t hop = window_frames - overlap;
+
+    std::vector<float> latent(num_channels * num_frames, 0.0f);
+    std::vector<float> weights(num_frames, 0.0f);
+
+    float* packed = encoder_in.as<float>();
+    const float* encoded = encoder_out.as<float>();
+
+    auto start_encoder = time_in_ms();
+    size_t num_chunks = 0;
+    for (size_t start_frame = 0;; start_frame += hop) {
+        // Pack the data planar (L then R), padding with zeros
+        const size_t first_sample = start_frame * samples_per_frame;
+        const size_t chunk_len = std::min(window, num_samples - std::min(num_samples, first_sample));
+        std::fill(packed, packed + encoder_in.num_elems(), 0.0f);
+        std::copy(left_ch.begin() + first_sample, left_ch.begin() + first_sample + chunk_len, packed);
+        std::copy(right_ch.begin() + first_sample, right_ch.begin() + first_sample + chunk_len, packed + window);
+
+        {
+            AUDIOGEN_TRACE("encoder_invoke", static_cast<int64_t>(num_chunks));
+            AUDIOGEN_METRIC_TIMER(MetricStage::Encoder);
+            AUDIOGEN_CHECK(encoder_->invoke());
+        }
+        num_chunks++;
+
+        const bool first_chunk = start_frame == 0;
+        const bool last_chunk = start_frame + window_frames >= num_frames;
+        for (size_t j = 0; j < window_frames && start_frame + j < num_frames; ++j) {
+            float weight = 1.0f;
+            if (!first_chunk && j < overlap) {
+                weight = (j + 1.0f) / (overlap + 1.0f);
+            }
+            if (!last_chunk && j >= window_frames - overlap) {
+                weight = std::min(weight, (window_frames - j) / (overlap + 1.0f));
+            }
+            weights[start_frame + j] += weight;
+            for (size_t c = 0; c < num_channels; ++c) {
+                latent[c * num_frames + start_frame + j] += weight * encoded[c * window_frames + j];
+            }
+        }
+        if (last_chunk) {
+            break;
+        }
+    }
+    auto end_encoder = time_in_ms();
+
+    for (size_t c = 0; c < num_channels; ++c) {
+        for (size_t f = 0; f < num_frames; ++f) {
+            latent[c * num_frames + f] /= weights[f];
+        }
+    }
+
+    fprintf(stderr, "Encoder time: %ld ms (%zu chunks)\n", end_encoder - start_encoder, num_chunks);
+    return latent;
+}
+
+std::vector<float> Pipeline::encode_audio(const std::string& audio_input_path, size_t& num_frames) {
+    std::vector<float> left_ch_input;
+    std::vector<float> right_ch_input;
+
+    // Read input audio file
+    read_wav(audio_input_path, left_ch_input, right_ch_input);
+    return encode_audio(audio_input_path, left_ch_input, right_ch_input, num_frames);
+}
+
+std::vector<float> Pipeline::encode_audio(const std::string& audio_input_path, const std::vector<float>& left_ch_input,
+                                          const std::vector<float>& right_ch_input, size_t& num_frames) {
+    fprintf(stderr, "Using %s as an audio input file...\n", audio_input_path.c_str());
+
+    // Keyed by the samples rather than by the file, so that only the audio matters
+    uint64_t audio_hash = hash_bytes(left_ch_input.data(), left_ch_input.size() * sizeof(float));
+    audio_hash = hash_bytes(right_ch_input.data(), right_ch_input.size() * sizeof(float), audio_hash);
+
+    if (audio_hash != encoded_audio_hash_ || encoded_latent_.empty()) {
+        encoded_latent_.clear();
+
+        const std::string cache_path = encoder_cache_dir_.empty() ? "" : encoder_cache_path(audio_hash);
+        if (!cache_path.empty() && std::ifstream(cache_path).good()) {
+            const std::unique_ptr<LatentFile> cached = LatentFile::open(cache_path);
+            if (cached != nullptr && cached->info().dims.size() == 3) {
+                encoded_latent_.assign(cached->data(), cached->data() + cached->info().num_elems());
+                encoded_num_frames_ = static_cast<size_t>(cached->info().dims[2]);
+                fprintf(stderr, "Encoded audio read from %s\n", cache_path.c_str());
+                metrics_add(MetricCounter::EncoderCacheDiskHits);
+            }
+        }
+
+        if (encoded_latent_.empty()) {
+            metrics_add(MetricCounter::EncoderCacheMisses);
+            encoded_latent_ = encode_chunks(left_ch_input, right_ch_input, encoded_num_frames_);
+
+            if (!cache_path.empty()) {
+                LatentInfo info;
+                info.prompt = audio_input_path;
+                info.audio_len_sec = static_cast<float>(left_ch_input.size()) / k_audio_sr;
+                info.dims = {1, static_cast<int64_t>(encoded_latent_.size() / encoded_num_frames_), static_cast<int64_t>(encoded_num_frames_)};
+
+                // Written under a temporary name, so that a concurrent reader never sees a partial file
+                const std::string tmp_path = cache_path + ".tmp" + std::to_string(audio_hash ^ reinterpret_cast<uintptr_t>(this));
+                save_latent(tmp_path, info, encoded_latent_.data());
+                if (std::rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+                    std::remove(tmp_path.c_str());
+                }
+            }
+        }
+        encoded_audio_hash_ = audio_hash;
+    } else {
+        metrics_add(MetricCounter::EncoderCacheMemoryHits);
+    }
+
+    // The encoder model is released unless the pipeline is long-lived, to avoid overloading memory
+    if (!keep_encoder_loaded_) {
+        encoder_.reset();
+    }
+
+    num_frames = encoded_num_frames_;
+    return encoded_latent_;
+}
+
+Model& Pipeline::set_prompt(const std::string& prompt) {
+    const TensorLayout& layout = backend_.layout();
+
+    AUDIOGEN_TRACE("tokenize");
+
+    std::vector<int32_t> ids;
+    tokenizer_->Encode(prompt, &ids);
+
+    // Make sure we have the EOS token at the end, and that the prompt fits in the T5 sequence
+    const size_t t5_seq_len = t5_->input(layout.t5_ids_in_idx).num_elems();
+    if (ids.empty() || ids.back() != k_t5_eos_id) {
+        ids.push_back(k_t5_eos_id);
+    }
+    if (ids.size() > t5_seq_len) {
+        fprintf(stderr, "Prompt truncated to %zu tokens\n", t5_seq_len);
+        ids.resize(t5_seq_len);
+        ids.back() = k_t5_eos_id;
+    }
+
+    // The shortest sequence the prompt fits in, since the padding costs as much as the prompt.
+    // The buckets are sorted by length.
+    Model* t5 = t5_.get();
+    for (const auto& bucket : t5_buckets_) {
+        if (bucket->input(layout.t5_ids_in_idx).num_elems() >= ids.size()) {
+            t5 = bucket.get();
+            break;
+        }
+    }
+
+    fill_int_tensor(t5->input(layout.t5_ids_in_idx), ids);
+    fill_int_tensor(t5->input(layout.t5_attnmask_in_idx), std::vector<int32_t>(ids.size(), 1));
+    return *t5;
+}
+
+uint64_t Pipeline::result_key(const GenerationParams& params) {
+    // The files the output depends on, the encoder excepted since the input audio is hashed through its latent
+    if (models_fingerprint_ == 0) {
+        std::vector<std::string> paths = {
+            models_base_path_ + "/spiece.model",
+            backend_.model_path(models_base_path_, ModelKind::Conditioners),
+            backend_.model_path(models_base_path_, ModelKind::DiT),
+            backend_.model_path(models_base_path_, ModelKind::Decoder),
+        };
+        for (const std::string& bucket_path : find_conditioners_buckets(backend_, models_base_path_)) {
+            paths.push_back(bucket_path);
+        }
+
+        uint64_t fingerprint = hash_bytes(backend_.name(), strlen(backend_.name()));
+        for (const std::string& path : paths) {
+            const uint64_t file_fingerprint = result_cache_->file_fingerprint(path);
+            fingerprint = hash_bytes(&file_fingerprint, sizeof(file_fingerprint), fingerprint);
+        }
+        models_fingerprint_ = fingerprint;
+    }
+
+    uint64_t key = models_fingerprint_;
+    auto hash_value = [&key](const auto& value) {
+        key = hash_bytes(&value, sizeof(value), key);
+    };
+    auto hash_floats = [&key, &hash_value](const std::vector<float>& values) {
+        hash_value(values.size());
+        key = hash_bytes(values.data(), values.size() * sizeof(float), key);
+    };
+
+    // Everything the generation depends on, but the deadline: a result computed in full serves any deadline
+    hash_value(params.prompt.size());
+    key = hash_bytes(params.prompt.data(), params.prompt.size(), key);
+    hash_value(static_cast<uint64_t>(params.seed));
+    hash_value(static_cast<uint64_t>(params.num_steps));
+    hash_value(params.audio_len_sec);
+    hash_value(params.sigma_max);
+    hash_floats(params.init_latent);
+    hash_value(static_cast<uint64_t>(params.init_latent_frames));
+    hash_value(params.init_offset_sec);
+    hash_floats(params.resume_latent);
+    hash_value(static_cast<uint64_t>(params.resume_step));
+    hash_value(params.convergence_threshold);
+    return key;
+}
+
+// The key is a 64-bit hash, so a hit is only used if the stored info is the one of the request
+static bool cached_result_matches(const LatentInfo& info, const GenerationParams& params, size_t num_elems) {
+    return info.prompt == params.prompt && info.seed == params.seed && info.num_steps == params.num_steps &&
+           info.step == info.num_steps && info.audio_len_sec == params.audio_len_sec &&
+           info.sigma_max == params.sigma_max && info.num_elems() == num_elems;
+}
+
+GenerationResult Pipeline::generate(const GenerationParams& params,
+                                    const ProgressCallback& on_step,
+                                    const std::atomic<bool>* cancel_requested) {
+    if (result_cache_ == nullptr) {
+        return run_generation(params, on_step, cancel_requested);
+    }
+
+    // Held until the result is stored, so that the identical requests wait for it instead of running
+    ResultCache::Lease lease = result_cache_->acquire(result_key(params));
+
+    const TensorView dit_x_in = latent();
+    const LatentFile* cached_latent = lease.latent();
+    if (cached_latent == nullptr || !cached_result_matches(cached_latent->info(), params, dit_x_in.num_elems())) {
+        metrics_add(MetricCounter::ResultCacheMisses);
+        GenerationResult result = run_generation(params, on_step, cancel_requested);
+
+        const bool complete = !result.cancelled && !result.deadline_cut && result.num_steps_planned == params.num_steps;
+        if (complete) {
+            LatentInfo info;
+            info.prompt        = params.prompt;
+            info.seed          = params.seed;
+            info.num_steps     = static_cast<uint32_t>(params.num_steps);
+            info.step          = static_cast<uint32_t>(params.num_steps);
+            info.audio_len_sec = params.audio_len_sec;
+            info.sigma_max     = params.sigma_max;
+            info.dims          = dit_x_in.dims;
+            lease.store(info, dit_x_in.as<float>(), result.left_ch, result.right_ch, result.num_samples);
+        }
+        return result;
+    }
+
+    metrics_add(lease.waited() ? MetricCounter::ResultCacheCoalesced : MetricCounter::ResultCacheHits);
+    fprintf(stderr, "Result read from the cache%s\n", lease.waited() ? ", computed by an identical request" : "");
+
+    // The state of the pipeline is the one of a generation: latent() and the output buffers hold the result
+    GenerationResult result;
+    result.cache_hit = true;
+    result.num_steps_planned = cached_latent->info().num_steps;
+    result.first_step = result.num_steps_planned;
+    memcpy(dit_x_in.data, cached_latent->data(), dit_x_in.num_elems() * sizeof(float));
+    if (!params.decode) {
+        return result;
+    }
+
+    const TensorView autoencoder_out = autoencoder_->output(0);
+    const LatentFile* cached_audio = lease.audio();
+    if (cached_audio != nullptr && cached_result_matches(cached_audio->info(), params, autoencoder_out.num_elems())) {
+        memcpy(autoencoder_out.data, cached_audio->data(), autoencoder_out.num_elems() * sizeof(float));
+        result.num_samples = autoencoder_out.num_elems() / 2;
+        result.left_ch = autoencoder_out.as<float>();
+        result.right_ch = autoencoder_out.as<float>() + result.num_samples;
+        return result;
+    }
+
+    // Only the latent was requested so far
+    const GenerationResult decoded = decode(dit_x_in.as<float>(), dit_x_in.num_elems());
+    result.left_ch = decoded.left_ch;
+    result.right_ch = decoded.right_ch;
+    result.num_samples = decoded.num_samples;
+    result.autoencoder_ms = decoded.autoencoder_ms;
+    lease.store(cached_latent->info(), nullptr, result.left_ch, result.right_ch, result.num_samples);
+    return result;
+}
+
+GenerationResult Pipeline::run_generation(const GenerationParams& params,
+                                          const ProgressCallback& on_step,
+                                          const std::atomic<bool>* cancel_requested) {
+    const TensorLayout& layout = backend_.layout();
+    size_t num_steps = params.num_steps;
+    GenerationResult result;
+
+    const long start_generate = time_in_ms();
+    const bool has_deadline = params.deadline_ms > 0;
+    // Time still needed after the diffusion
+    const float autoencoder_cost_ms = params.decode ? stage_costs_.autoencoder_ms : 0.0f;
+
+    auto is_cancelled = [cancel_requested]() {
+        return cancel_requested != nullptr && cancel_requested->load();
+    };
+
+    // ----- Run T5
+    // ----------------------------------
+    Model& t5 = set_prompt(params.prompt);
+    result.t5_seq_len = t5.input(layout.t5_ids_in_idx).num_elems();
+
+    const TensorView t5_time_in = t5.input(layout.t5_audio_len_in_idx);
+    AUDIOGEN_CHECK(t5_time_in.num_elems() == 1);
+    *t5_time_in.as<float>() = params.audio_len_sec;
+
+    auto start_t5 = time_in_ms();
+    {
+        AUDIOGEN_TRACE("t5_invoke");
+        AUDIOGEN_METRIC_TIMER(MetricStage::T5);
+        AUDIOGEN_CHECK(t5.invoke());
+    }
+    auto end_t5 = time_in_ms();
+
+    // Since the crossattn and global conditioner are constants, we can initialize these 2 inputs
+    // of DiT outside the diffusion for loop
+    const TensorView dit_crossattn_in = dit_->input(layout.dit_crossattn_in_idx);
+    const TensorView dit_globalcond_in = dit_->input(layout.dit_globalcond_in_idx);
+    const TensorView t5_crossattn_out = t5.output(layout.t5_crossattn_out_idx);
+    const TensorView t5_globalcond_out = t5.output(layout.t5_globalcond_out_idx);
+    AUDIOGEN_CHECK(t5_crossattn_out.dims.size() == 3 && dit_crossattn_in.dims.size() == 3);
+    AUDIOGEN_CHECK(t5_crossattn_out.dims[2] == dit_crossattn_in.dims[2]);
+    AUDIOGEN_CHECK(t5_globalcond_out.num_elems() >= dit_globalcond_in.num_elems());
+
+    {
+        AUDIOGEN_TRACE("copy_conditioning");
+        copy_cross_attention(t5_crossattn_out, dit_crossattn_in);
+        memcpy(dit_globalcond_in.data, t5_globalcond_out.data, dit_globalcond_in.num_elems() * sizeof(float));
+    }
+
+    // ----- Initialize the T and X buffers
+    // ----------------------------------
+    const TensorView dit_x_in = dit_->input(layout.dit_x_in_idx);
+    const TensorView dit_t_in = dit_->input(layout.dit_t_in_idx);
+    const TensorView dit_out = dit_->output(layout.dit_out_idx);
+    AUDIOGEN_CHECK(dit_t_in.num_elems() == 1);
+    AUDIOGEN_CHECK(dit_out.num_elems() == dit_x_in.num_elems());
+
+    float* dit_x_in_data = dit_x_in.as<float>();
+    const size_t dit_x_num_elems = dit_x_in.num_elems();
+
+    const bool resume = !params.resume_latent.empty();
+    AUDIOGEN_CHECK(!resume || params.resume_step < num_steps);
+
+    if (resume) {
+        // The checkpoint already holds the noise and the input audio, if any
+        AUDIOGEN_CHECK(params.resume_latent.size() == dit_x_num_elems);
+        memcpy(dit_x_in_data, params.resume_latent.data(), dit_x_num_elems * sizeof(float));
+    } else {
+        // Fill x tensor with noise
+        AUDIOGEN_TRACE("noise");
+        fill_random_norm_dist(dit_x_in_data, dit_x_num_elems, params.seed);
+    }
+
+    const float sigma_max = params.sigma_max;
+    if (!resume && !params.init_latent.empty()) {
+        // Window of the latent of the input audio starting at init_offset_sec, zero-padded past its end
+        AUDIOGEN_CHECK(dit_x_in.dims.size() == 3);
+        const size_t num_channels = static_cast<size_t>(dit_x_in.dims[1]);
+        const size_t num_frames = static_cast<size_t>(dit_x_in.dims[2]);
+        const size_t init_frames = params.init_latent_frames != 0 ? params.init_latent_frames : num_frames;
+        AUDIOGEN_CHECK(params.init_latent.size() == num_channels * init_frames);
+
+        const size_t samples_per_frame = autoencoder_->output(0).num_elems() / 2 / num_frames;
+        const size_t offset = static_cast<size_t>(params.init_offset_sec * k_audio_sr / samples_per_frame);
+
+        for (size_t c = 0; c < num_channels; ++c) {
+            for (size_t f = 0; f < num_frames; ++f) {
+                const size_t i = c * num_frames + f;
+                const float init = offset + f < init_frames ? params.init_latent[c * init_frames + offset + f] : 0.0f;
+                dit_x_in_data[i] = init * (1 - sigma_max) + dit_x_in_data[i] * sigma_max;
+            }
+        }
+    }
+
+    // Pre-compute the sigmas, only the steps below sigma_max are run
+    size_t num_dropped = fill_truncated_sigmas(t_buffer_, num_steps, sigma_max);
+
+    // Deadline control: as many steps as the measured step time allows, once T5 has run.
+    // A checkpoint keeps its schedule, the deadline then only cuts it short.
+    if (has_deadline && !resume && stage_costs_.dit_step_ms > 0.0f) {
+        const float budget_ms = params.deadline_ms - (time_in_ms() - start_generate) - autoencoder_cost_ms;
+        const size_t affordable = budget_ms > 0.0f ? static_cast<size_t>(budget_ms / stage_costs_.dit_step_ms) : 0;
+        const size_t max_steps_run = std::max(affordable, std::min(k_deadline_min_steps, num_steps - num_dropped));
+        // Coarser schedules until the steps below sigma_max fit
+        while (num_steps > 1 && num_steps - num_dropped > max_steps_run) {
+            num_dropped = fill_truncated_sigmas(t_buffer_, --num_steps, sigma_max);
+        }
+    }
+    result.num_steps_planned = num_steps;
+
+    const size_t first_step = std::max(resume ? params.resume_step : 0, num_dropped);
+    result.first_step = first_step;
+
+    // ----- Run the diffusion
+    // ----------------------------------
+    const bool adaptive = params.convergence_threshold > 0.0f;
+    if (adaptive) {
+        result.convergence_trace.reserve(num_steps - first_step);
+    }
+
+    // Capture of the DiT steps, for the next generation only
+    std::unique_ptr<DitCaptureWriter> dit_capture;
+    if (!dit_capture_path_.empty()) {
+        dit_capture = std::make_unique<DitCaptureWriter>(dit_capture_path_, dit_x_in, dit_crossattn_in, dit_globalcond_in);
+        dit_capture_path_.clear();
+    }
+
+    // All the views are fetched above, so nothing in this loop should allocate
+    const size_t heap_allocs_before = heap_allocation_count();
+    float* dit_out_data = dit_out.as<float>();
+    float* dit_t_in_data = dit_t_in.as<float>();
+
+    auto start_dit = time_in_ms();
+
+    for (size_t i = first_step; i < num_steps; ++i) {
+        if (is_cancelled()) {
+            fprintf(stderr, "Generation cancelled after %zu/%zu DiT steps\n", i, num_steps);
+            result.cancelled = true;
+            return result;
+        }
+
+        const float curr_t = t_buffer_[i];
+        const float next_t = t_buffer_[i + 1];
+        *dit_t_in_data = curr_t;
+
+        float change = -1.0f;
+        bool converged = false;
+        bool out_of_time = false;
+
+        auto start_step = time_in_ms();
+        {
+            AUDIOGEN_TRACE("dit_step", static_cast<int64_t>(i));
+
+            // Run DiT
+            {
+                AUDIOGEN_TRACE("dit_invoke", static_cast<int64_t>(i));
+                AUDIOGEN_METRIC_TIMER(MetricStage::DiTStep);
+                AUDIOGEN_CHECK(dit_->invoke());
+            }
+
+            if (dit_capture != nullptr) {
+                dit_capture->write_step(static_cast<uint32_t>(i), curr_t, dit_x_in_data, dit_out_data);
+            }
+
+            // The output of DiT is combined with the current x and t tensors to
+            // generate the next x tensor for DiT
+            sampler_ping_pong(dit_out_data, dit_x_in_data, noise_.data(), dit_x_num_elems, curr_t, next_t, params.seed + i + 4564);
+
+            // Adaptive step termination: compare the denoised estimate with the one of the previous step
+            if (adaptive) {
+                AUDIOGEN_TRACE("convergence");
+                if (i > first_step) {
+                    change = relative_change(dit_out_data, prev_denoised_.data(), dit_x_num_elems);
+                    result.convergence_trace.push_back(change);
+                }
+                converged = i > first_step && i + 1 < num_steps && change < params.convergence_threshold;
+                if (!converged) {
+                    memcpy(prev_denoised_.data(), dit_out_data, dit_x_num_elems * sizeof(float));
+                }
+            }
+
+            // Deadline control: stop if the next step, at the pace of this run, would not leave
+            // enough time for the autoencoder. At least k_deadline_min_steps steps are run.
+            if (has_deadline && !converged && i + 1 < num_steps && i + 1 - first_step >= k_deadline_min_steps) {
+                const long now = time_in_ms();
+                const float step_ms = static_cast<float>(now - start_dit) / static_cast<float>(i + 1 - first_step);
+                out_of_time = (now - start_generate) + step_ms + autoencoder_cost_ms > params.deadline_ms;
+            }
+
+            if (converged || out_of_time) {
+                // Jump to the final sigma: at t = 0, the sampler gives x = denoised
+                memcpy(dit_x_in_data, dit_out_data, dit_x_num_elems * sizeof(float));
+            }
+        }
+        auto end_step = time_in_ms();
+        result.num_steps_run = i + 1 - first_step;
+
+        // After the sampler, the DiT output holds the denoised estimate of this step
+        if (on_step) {
+            on_step({i + 1, num_steps, curr_t, next_t, end_step - start_step, end_step - start_dit, change}, dit_out_data);
+        }
+
+        if (converged || out_of_time) {
+            result.num_steps_skipped = num_steps - (i + 1);
+            result.deadline_cut = out_of_time;
+            break;
+        }
+    }
+    auto end_dit = time_in_ms();
+    result.dit_heap_allocs = heap_allocation_count() - heap_allocs_before;
+
+    if (dit_capture != nullptr) {
+        fprintf(stderr, "DiT capture: %zu steps written\n", dit_capture->num_steps());
+    }
+
+    if (is_cancelled()) {
+        fprintf(stderr, "Generation cancelled before the autoencoder\n");
+        result.cancelled = true;
+        return result;
+    }
+
+    result.t5_ms = end_t5 - start_t5;
+    result.dit_ms = end_dit - start_dit;
+    update_stage_cost(stage_costs_.t5_ms, static_cast<float>(result.t5_ms));
+    if (result.num_steps_run > 0) {
+        update_stage_cost(stage_costs_.dit_step_ms, static_cast<float>(result.dit_ms) / result.num_steps_run);
+    }
+
+    if (!params.decode) {
+        return result;
+    }
+
+    const GenerationResult decoded = decode(dit_x_in_data, dit_x_num_elems);
+    result.left_ch = decoded.left_ch;
+    result.right_ch = decoded.right_ch;
+    result.num_samples = decoded.num_samples;
+    result.autoencoder_ms = decoded.autoencoder_ms;
+    return result;
+}
+
+GenerationResult Pipeline::decode(const float* latent, size_t num_elems) {
+    GenerationResult result;
+
+    // ----- Run the autoencoder
+    // ----------------------------------
+    auto start_autoencoder = time_in_ms();
+
+    // Initialize the autoencoder's input
+    const TensorView autoencoder_in = autoencoder_->input(0);
+    AUDIOGEN_CHECK(autoencoder_in.num_elems() == num_elems);
+    {
+        AUDIOGEN_TRACE("copy_latent");
+        memcpy(autoencoder_in.data, latent, num_elems * sizeof(float));
+    }
+
+    {
+        AUDIOGEN_TRACE("autoencoder_invoke");
+        AUDIOGEN_METRIC_TIMER(MetricStage::Autoencoder);
+        AUDIOGEN_CHECK(autoencoder_->invoke());
+    }
+
+    auto end_autoencoder = time_in_ms();
+
+    const TensorView autoencoder_out = autoencoder_->output(0);
+    result.num_samples = autoencoder_out.num_elems() / 2;
+    result.left_ch = autoencoder_out.as<float>();
+    result.right_ch = autoencoder_out.as<float>() + result.num_samples;
+    result.autoencoder_ms = end_autoencoder - start_autoencoder;
+    update_stage_cost(stage_costs_.autoencoder_ms, static_cast<float>(result.autoencoder_ms));
+    return result;
+}
+
+TensorView Pipeline::decoder_input() {
+    return autoencoder_->input(0);
+}
+
+TensorView Pipeline::latent() {
+    return dit_->input(backend_.layout().dit_x_in_idx);
+}
+
+} // namespace audiogen
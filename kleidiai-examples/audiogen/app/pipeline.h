@@ -0,0 +1,315 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "backend.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sentencepiece {
+class SentencePieceProcessor;
+}
+
+namespace audiogen {
+
+class ResultCache;
+
+constexpr size_t k_seed_default = 99;
+constexpr size_t k_audio_len_sec_default = 10;
+constexpr size_t k_num_steps_default = 8;
+
+// -- Fill sigmas params
+constexpr float k_logsnr_max = -6.0f;
+constexpr float k_sigma_min = 0.0f;
+constexpr float k_sigma_max = 1.0f;
+
+// -- Token-length buckets: sequence lengths the conditioners may be exported for, next to the
+// full-length model, so that short prompts are not run with the padding of the longest ones
+constexpr size_t k_t5_bucket_lengths[] = {8, 16, 32, 64};
+
+// -- Progress reporting
+struct StepProgress {
+    size_t step;        // 1-based index of the completed step
+    size_t num_steps;
+    float  curr_t;
+    float  next_t;
+    long   step_ms;     // Time spent in this step (DiT + sampler)
+    long   elapsed_ms;  // Time spent in the diffusion loop so far
+    float  change;      // Relative change of the denoised estimate since the previous step, < 0 for the first step
+};
+
+// -- Deadline control
+constexpr size_t k_deadline_min_steps = 2;
+
+// Cost of each stage, measured by Pipeline::calibrate() and then averaged over the generations
+struct StageCosts {
+    float t5_ms = 0.0f;
+    float dit_step_ms = 0.0f;
+    float autoencoder_ms = 0.0f;
+};
+
+// -- Startup timeline
+struct LoadEvent {
+    std::string name;
+    long start_ms = 0;  // Relative to the start of Pipeline::load()
+    long end_ms   = 0;
+};
+
+// Called after every DiT step. The denoised estimate of the step is passed
+// along, so that a caller can build a preview without decoding the audio.
+using ProgressCallback = std::function<void(const StepProgress& progress, const float* denoised)>;
+
+struct GenerationParams {
+    std::string prompt;
+    size_t seed          = k_seed_default;
+    size_t num_steps     = k_num_steps_default;
+    float audio_len_sec  = static_cast<float>(k_audio_len_sec_default);
+    // Noise level of the first step. Below 1, only the steps of the schedule below it are run
+    // (see fill_truncated_sigmas()), so a light style transfer costs a fraction of num_steps.
+    float sigma_max      = k_sigma_max;
+
+    // Latent of the input audio for style transfer (see Pipeline::encode_audio()), with shape
+    // [channels, init_latent_frames]. Empty for text-to-audio.
+    std::vector<float> init_latent;
+    size_t init_latent_frames = 0;  // 0 if the latent has the length of the DiT input
+    float init_offset_sec = 0.0f;   // Start of the window of init_latent used, zero-padded past its end
+
+    // Resume the diffusion from a checkpoint: x after resume_step steps of the same schedule (same
+    // num_steps and sigma_max), with the shape of the DiT input. The seed then only drives the noise
+    // of the remaining steps, and the prompt may differ from the one of the checkpoint, to get cheap
+    // variations of a clip. Empty to start from noise.
+    std::vector<float> resume_latent;
+    size_t resume_step = 0;
+
+    // Adaptive step termination: once the relative change of the denoised estimate between two
+    // steps falls below this threshold, the remaining steps are skipped and the sampler jumps to
+    // the final sigma (x = denoised). 0 always runs num_steps steps.
+    float convergence_threshold = 0.0f;
+
+    // Deadline of the whole generation (T5, DiT and autoencoder) from the call to generate(), 0 for none.
+    // The number of steps is reduced up front from the stage costs (see Pipeline::calibrate()), down to
+    // k_deadline_min_steps, and the last steps are skipped (x = denoised) if the steps run slower
+    // than predicted.
+    long deadline_ms = 0;
+
+    // Run the autoencoder after the diffusion. When false, the generation stops at the
+    // final latent (see Pipeline::latent()), which can be decoded later with Pipeline::decode().
+    bool decode = true;
+};
+
+struct GenerationResult {
+    bool cancelled = false;
+    size_t num_steps_run = 0;       // In this generation, i.e. after first_step
+    size_t num_steps_skipped = 0;   // By the adaptive step termination or the deadline control
+
+    // Deadline control: number of steps of the schedule, i.e. GenerationParams::num_steps unless
+    // reduced to meet the deadline, and whether the steps had to be cut short
+    size_t num_steps_planned = 0;
+    bool deadline_cut = false;
+
+    // Index of the first step run in the schedule: GenerationParams::resume_step, or the steps
+    // above sigma_max, whichever is later
+    size_t first_step = 0;
+
+    // Relative change of the denoised estimate after each step, from the second step
+    std::vector<float> convergence_trace;
+
+    // Read from the ResultCache: no model was run, but the autoencoder if only the latent was cached
+    bool cache_hit = false;
+
+    long t5_ms = 0;
+    long dit_ms = 0;
+    size_t t5_seq_len = 0;          // Sequence length of the conditioners run for the prompt
+    long autoencoder_ms = 0;
+
+    // Heap allocations made during the DiT loop, progress callback included.
+    // Only counted when built with AUDIOGEN_COUNT_ALLOCATIONS (see alloc_counter.h).
+    size_t dit_heap_allocs = 0;
+
+    // Planar stereo output of the autoencoder, valid until the next call to generate() or decode().
+    // Not set if GenerationParams::decode is false. It may be post-processed in place (see postprocess.h).
+    float* left_ch = nullptr;
+    float* right_ch = nullptr;
+    size_t num_samples = 0;
+};
+
+// Source of the models and of the tokenizer of the pipelines, so that the pipelines using identical
+// files share a single copy of them (see ModelRegistry). Must be thread-safe, since the models of a
+// pipeline are loaded concurrently. The shared models are only used by one pipeline at a time.
+class ModelCache {
+public:
+    virtual ~ModelCache() = default;
+
+    virtual std::shared_ptr<Model> model(const std::string& path, ModelKind kind) = 0;
+    virtual std::shared_ptr<sentencepiece::SentencePieceProcessor> tokenizer(const std::string& path) = 0;
+};
+
+void fill_random_norm_dist(float* buff, size_t buff_sz, size_t seed);
+
+void fill_sigmas(std::vector<float>& arr, float start, float end, float sigma_max);
+
+// Sigmas of the num_steps schedule of text-to-audio, without the steps above sigma_max: the input
+// audio mixed with noise at sigma_max replaces them. Returns the number of steps dropped; the
+// first step run then starts at sigma_max. Nothing is dropped for sigma_max = 1.
+size_t fill_truncated_sigmas(std::vector<float>& arr, size_t num_steps, float sigma_max);
+
+// Paths of the conditioners exported for the k_t5_bucket_lengths present in the models directory
+std::vector<std::string> find_conditioners_buckets(const Backend& backend, const std::string& models_base_path);
+
+// ||curr - prev|| / ||curr||, 0 if both are zero
+float relative_change(const float* curr, const float* prev, size_t num_elems);
+
+// x = (1 - t_next) * denoised + t_next * noise, with denoised = x - t_curr * v.
+// On return, dit_out_data holds the denoised estimate.
+void sampler_ping_pong(float* dit_out_data, float* dit_x_in_data, float* noise, size_t dit_x_in_sz, float cur_t, float next_t, size_t seed);
+
+// Text-to-audio (and audio-to-audio) generation with Stable Audio Open Small,
+// independent of the runtime executing the submodules
+class Pipeline {
+public:
+    Pipeline(Backend& backend, const std::string& models_base_path);
+    ~Pipeline();
+
+    // Load the models and the tokenizer through this cache instead of the backend. To be set
+    // before load(), the cache must outlive the pipeline.
+    void set_model_cache(ModelCache* cache) { model_cache_ = cache; }
+
+    // Load the T5, DiT and autoencoder models and the tokenizer, each on its own thread. The
+    // conditioners exported for shorter prompts (see find_conditioners_buckets()) are loaded as well.
+    void load();
+
+    // Load the autoencoder only, to decode latents generated elsewhere with decode()
+    void load_decoder();
+
+    // When each model started and finished loading during the last call to load()
+    const std::vector<LoadEvent>& load_timeline() const { return load_timeline_; }
+
+    // Run every model once, to warm up the delegates before the first generation
+    void warmup();
+
+    // Warm up, then time one run of each model, as a starting point for the deadline control.
+    // Needs the models loaded by load().
+    const StageCosts& calibrate();
+
+    // Running average of the cost of each stage, 0 until measured
+    const StageCosts& stage_costs() const { return stage_costs_; }
+
+    // Encode a WAV file of any length into a latent usable as GenerationParams::init_latent,
+    // with num_frames latent frames. Files longer than the encoder input are encoded in
+    // overlapping chunks, crossfaded in the latent space. The latent is kept in memory and,
+    // if enabled, in the encoder cache, so that a reference track is only encoded once.
+    std::vector<float> encode_audio(const std::string& audio_input_path, size_t& num_frames);
+
+    // Same, for the planar channels of a WAV file already read, named after it in the encoder cache
+    std::vector<float> encode_audio(const std::string& audio_input_path, const std::vector<float>& left_ch_input,
+                                    const std::vector<float>& right_ch_input, size_t& num_frames);
+
+    // Directory of the encoded audio, keyed by the hash of the audio samples and of the encoder
+    // model. Disabled if empty (default).
+    void set_encoder_cache_dir(const std::string& dir) { encoder_cache_dir_ = dir; }
+
+    // Keep the encoder loaded between two calls to encode_audio(), for long-lived pipelines.
+    // By default it is released on return, to avoid overloading memory.
+    void set_keep_encoder_loaded(bool keep) { keep_encoder_loaded_ = keep; }
+
+    // Look the generations up in this cache first, and store their results in it. The generations cut
+    // short by the deadline control or cancelled are not stored. The cache must outlive the pipeline.
+    void set_result_cache(ResultCache* cache) { result_cache_ = cache; }
+
+    // Write the inputs and the output of the DiT at every step of the next generation to this file
+    // (see dit_capture.h), to benchmark the DiT alone on real data. Not written on a result cache hit,
+    // so the app does not use the cache when capturing.
+    void set_dit_capture_path(const std::string& path) { dit_capture_path_ = path; }
+
+    // The cancellation request, if any, is checked between two DiT steps and before the autoencoder
+    GenerationResult generate(const GenerationParams& params,
+                              const ProgressCallback& on_step = nullptr,
+                              const std::atomic<bool>* cancel_requested = nullptr);
+
+    // Run the autoencoder only. The latent must have the shape of the DiT output, i.e. of decoder_input().
+    GenerationResult decode(const float* latent, size_t num_elems);
+
+    // Input of the autoencoder, to check the shape of a latent before decode(). Needs load() or load_decoder().
+    TensorView decoder_input();
+
+    // Latent of the last generation, i.e. the input of the autoencoder
+    TensorView latent();
+
+    Backend& backend() { return backend_; }
+
+private:
+    void load_models(bool decoder_only);
+    GenerationResult run_generation(const GenerationParams& params, const ProgressCallback& on_step,
+                                    const std::atomic<bool>* cancel_requested);
+    // Key of the generation in the result cache
+    uint64_t result_key(const GenerationParams& params);
+    // Fill the inputs of the shortest conditioners the tokens of the prompt fit in, and return them
+    Model& set_prompt(const std::string& prompt);
+
+    // Latent of the whole audio, with shape [channels, num_frames]
+    std::vector<float> encode_chunks(const std::vector<float>& left_ch, const std::vector<float>& right_ch, size_t& num_frames);
+    // Path of the latent of the given audio in the encoder cache
+    std::string encoder_cache_path(uint64_t audio_hash);
+
+    Backend& backend_;
+    std::string models_base_path_;
+
+    ModelCache* model_cache_ = nullptr;
+    std::shared_ptr<sentencepiece::SentencePieceProcessor> tokenizer_;
+
+    // Planned memory of the models, declared first so that it outlives them.
+    // Not used by the models of a ModelCache, which own their memory.
+    std::unique_ptr<MemoryArena> arena_;
+    std::shared_ptr<Model> t5_;
+    std::vector<std::shared_ptr<Model>> t5_buckets_;   // By ascending sequence length
+    std::shared_ptr<Model> dit_;
+    std::shared_ptr<Model> autoencoder_;
+
+    std::vector<LoadEvent> load_timeline_;
+    StageCosts stage_costs_;
+
+    // Loaded on the first call to encode_audio()
+    std::unique_ptr<Model> encoder_;
+    bool keep_encoder_loaded_ = false;
+    std::string encoder_cache_dir_;
+    uint64_t encoder_model_hash_ = 0;
+
+    // Latent of the last encoded audio, with shape [channels, frames]
+    uint64_t encoded_audio_hash_ = 0;
+    std::vector<float> encoded_latent_;
+    size_t encoded_num_frames_ = 0;
+
+    ResultCache* result_cache_ = nullptr;
+    uint64_t models_fingerprint_ = 0;
+
+    std::string dit_capture_path_;
+
+    // Scratch buffers reused across the generations
+    std::vector<float> t_buffer_;
+    std::vector<float> noise_;
+    std::vector<float> prev_denoised_;
+};
+
+} // namespace audiogen
@@ -0,0 +1,392 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "postprocess.h"
+#include "common.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+namespace audiogen {
+namespace {
+
+constexpr double k_pi = 3.14159265358979323846;
+
+// Samples processed at once by each stage of the chain
+constexpr size_t k_block_size = 4096;
+
+constexpr double k_dc_cutoff_hz = 5.0;
+constexpr double k_limiter_attack_ms = 1.5;
+constexpr double k_limiter_release_ms = 50.0;
+
+// Kaiser window of the interpolation filter
+constexpr double k_kaiser_beta = 5.0;
+
+// Modified Bessel function of the first kind, order 0
+double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+inline float db_to_gain(double db) {
+    return static_cast<float>(std::pow(10.0, db / 20.0));
+}
+
+// Half-cosine ramp from 0 (x = 0) to 1 (x = 1)
+inline float fade_gain(double x) {
+    return static_cast<float>(0.5 - 0.5 * std::cos(k_pi * x));
+}
+
+} // namespace
+
+// -- LoudnessMeter
+// The K-weighting filters are defined for 48 kHz in BS.1770, so they are derived from
+// their analog prototypes for the actual sample rate
+LoudnessMeter::LoudnessMeter(int32_t sample_rate) {
+    const double fs = static_cast<double>(sample_rate);
+
+    {
+        const double f0 = 1681.974450955533;
+        const double gain_db = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = std::tan(k_pi * f0 / fs);
+        const double vh = std::pow(10.0, gain_db / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        pre_filter_ = {(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                       2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+    }
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = std::tan(k_pi * f0 / fs);
+        const double a0 = 1.0 + k / q + k * k;
+        rlb_filter_ = {1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+    }
+
+    sub_block_len_ = static_cast<size_t>(std::lround(0.1 * fs));
+}
+
+void LoudnessMeter::process(const float* left_ch, const float* right_ch, size_t num_samples) {
+    const float* channels[2] = {left_ch, right_ch};
+
+    size_t i = 0;
+    while (i < num_samples) {
+        const size_t n = std::min(num_samples - i, sub_block_len_ - sub_block_pos_);
+
+        for (size_t c = 0; c < 2; ++c) {
+            const float* x = channels[c] + i;
+            double* s = state_[c];
+            double energy = 0.0;
+            for (size_t j = 0; j < n; ++j) {
+                // Direct form I, s = {x1, x2, y1, y2, z1, z2}: the output y of the first stage is
+                // the input of the second one, so they share its history
+                const double in = x[j];
+                const double y = pre_filter_.b0 * in + pre_filter_.b1 * s[0] + pre_filter_.b2 * s[1]
+                               - pre_filter_.a1 * s[2] - pre_filter_.a2 * s[3];
+                const double z = rlb_filter_.b0 * y + rlb_filter_.b1 * s[2] + rlb_filter_.b2 * s[3]
+                               - rlb_filter_.a1 * s[4] - rlb_filter_.a2 * s[5];
+                s[1] = s[0];
+                s[0] = in;
+                s[3] = s[2];
+                s[2] = y;
+                s[5] = s[4];
+                s[4] = z;
+                energy += z * z;
+            }
+            sub_block_energy_ += energy;
+        }
+        i += n;
+        sub_block_pos_ += n;
+
+        if (sub_block_pos_ == sub_block_len_) {
+            sub_block_energies_.push_back(sub_block_energy_);
+            sub_block_energy_ = 0.0;
+            sub_block_pos_ = 0;
+        }
+    }
+}
+
+double LoudnessMeter::integrated_lufs() const {
+    // Mean square of each 400 ms block, i.e. of 4 consecutive sub-blocks
+    std::vector<double> blocks;
+    for (size_t j = 3; j < sub_block_energies_.size(); ++j) {
+        const double energy = sub_block_energies_[j - 3] + sub_block_energies_[j - 2]
+                            + sub_block_energies_[j - 1] + sub_block_energies_[j];
+        blocks.push_back(energy / static_cast<double>(4 * sub_block_len_));
+    }
+
+    auto loudness = [](double mean_square) { return -0.691 + 10.0 * std::log10(mean_square); };
+
+    auto gated_mean = [&](double threshold_lufs) {
+        double sum = 0.0;
+        size_t count = 0;
+        for (const double z : blocks) {
+            if (z > 0.0 && loudness(z) > threshold_lufs) {
+                sum += z;
+                ++count;
+            }
+        }
+        return count > 0 ? sum / static_cast<double>(count) : 0.0;
+    };
+
+    const double abs_gated = gated_mean(-70.0);
+    if (abs_gated <= 0.0) {
+        return -std::numeric_limits<double>::infinity();
+    }
+
+    const double rel_gated = gated_mean(loudness(abs_gated) - 10.0);
+    return loudness(rel_gated);
+}
+
+// -- TruePeakLimiter
+TruePeakLimiter::TruePeakLimiter(int32_t sample_rate, float ceiling_dbtp, float input_gain)
+    : ceiling_(db_to_gain(ceiling_dbtp)), input_gain_(input_gain) {
+    const double fs = static_cast<double>(sample_rate);
+    release_coeff_ = static_cast<float>(1.0 - std::exp(-1000.0 / (k_limiter_release_ms * fs)));
+    attack_len_ = std::max<size_t>(1, static_cast<size_t>(std::lround(k_limiter_attack_ms * fs / 1000.0)));
+
+    // The gain of a sample must cover the peaks interpolated up to k_interp_delay samples later,
+    // and reach its value over the attack
+    latency_ = k_interp_delay + attack_len_;
+
+    // Windowed sinc with a cutoff at the Nyquist frequency of the input, split into its phases.
+    // The taps of each phase are stored from the oldest sample to the newest.
+    constexpr size_t num_taps = k_oversampling * k_taps_per_phase;
+    for (size_t p = 0; p < k_oversampling; ++p) {
+        double sum = 0.0;
+        for (size_t j = 0; j < k_taps_per_phase; ++j) {
+            const size_t i = p + k_oversampling * j;
+            const double t = (static_cast<double>(i) - (num_taps - 1) / 2.0) / k_oversampling;
+            const double sinc = t == 0.0 ? 1.0 : std::sin(k_pi * t) / (k_pi * t);
+            const double x = 2.0 * i / (num_taps - 1) - 1.0;
+            const double window = bessel_i0(k_kaiser_beta * std::sqrt(1.0 - x * x)) / bessel_i0(k_kaiser_beta);
+            interp_[p][k_taps_per_phase - 1 - j] = static_cast<float>(sinc * window);
+            sum += sinc * window;
+        }
+        // Unity gain at DC for every phase
+        for (size_t j = 0; j < k_taps_per_phase; ++j) {
+            interp_[p][j] = static_cast<float>(interp_[p][j] / sum);
+        }
+    }
+
+    for (auto& delay : delay_) {
+        delay.assign(latency_, 0.0f);
+    }
+    min_index_.resize(latency_ + 1);
+    min_value_.resize(latency_ + 1);
+    attack_.assign(attack_len_ + 1, 1.0f);
+    attack_sum_ = static_cast<double>(attack_len_ + 1);
+}
+
+float TruePeakLimiter::true_peak(const float* history) const {
+    // The interpolated samples lie between the 6th and 5th newest input samples
+    float peak = std::max(std::fabs(history[k_taps_per_phase - 1 - k_interp_delay]),
+                          std::fabs(history[k_taps_per_phase - k_interp_delay]));
+    for (size_t p = 0; p < k_oversampling; ++p) {
+        float y = 0.0f;
+        for (size_t j = 0; j < k_taps_per_phase; ++j) {
+            y += interp_[p][j] * history[j];
+        }
+        peak = std::max(peak, std::fabs(y));
+    }
+    return peak;
+}
+
+bool TruePeakLimiter::step(float left, float right, float* out_left, float* out_right) {
+    const size_t t = num_samples_ + num_flushed_;
+
+    // Gain needed by the samples around the interpolated peaks
+    history_[0][history_pos_] = history_[0][history_pos_ + k_taps_per_phase] = left;
+    history_[1][history_pos_] = history_[1][history_pos_ + k_taps_per_phase] = right;
+    const size_t start = history_pos_ + 1;
+    history_pos_ = (history_pos_ + 1) % k_taps_per_phase;
+
+    const float peak = input_gain_ * std::max(true_peak(&history_[0][start]), true_peak(&history_[1][start]));
+    const float needed = peak > ceiling_ ? ceiling_ / peak : 1.0f;
+
+    // Minimum over the last latency_ + 1 samples, with a monotonic queue
+    const size_t capacity = min_value_.size();
+    while (min_tail_ > min_head_ && min_value_[(min_tail_ - 1) % capacity] >= needed) {
+        --min_tail_;
+    }
+    min_index_[min_tail_ % capacity] = t;
+    min_value_[min_tail_ % capacity] = needed;
+    ++min_tail_;
+    while (min_index_[min_head_ % capacity] + capacity <= t) {
+        ++min_head_;
+    }
+    const float window_min = min_value_[min_head_ % capacity];
+
+    // The moving average over the attack ramps the gain down smoothly, and stays below the
+    // gain needed by every sample since each value it averages already covers it
+    float& oldest = attack_[t % attack_.size()];
+    attack_sum_ += window_min - oldest;
+    oldest = window_min;
+    const float target = static_cast<float>(attack_sum_ / static_cast<double>(attack_.size()));
+
+    gain_ = target < gain_ ? target : gain_ + (target - gain_) * release_coeff_;
+
+    // Delay line
+    const size_t slot = t % delay_[0].size();
+    const float delayed_left = delay_[0][slot];
+    const float delayed_right = delay_[1][slot];
+    delay_[0][slot] = left;
+    delay_[1][slot] = right;
+
+    if (t < latency_) {
+        return false;
+    }
+    *out_left = delayed_left * input_gain_ * gain_;
+    *out_right = delayed_right * input_gain_ * gain_;
+    return true;
+}
+
+size_t TruePeakLimiter::process(const float* left_ch, const float* right_ch, size_t num_samples,
+                                float* out_left_ch, float* out_right_ch) {
+    AUDIOGEN_CHECK(num_flushed_ == 0);
+
+    size_t num_out = 0;
+    for (size_t i = 0; i < num_samples; ++i) {
+        // Read before writing, the output may be the input lagging behind
+        const float left = left_ch[i];
+        const float right = right_ch[i];
+        if (step(left, right, out_left_ch + num_out, out_right_ch + num_out)) {
+            ++num_out;
+        }
+        ++num_samples_;
+    }
+    return num_out;
+}
+
+size_t TruePeakLimiter::flush(float* out_left_ch, float* out_right_ch) {
+    // Push silence until every sample received has come out
+    size_t num_out = 0;
+    while (num_flushed_ < latency_) {
+        if (step(0.0f, 0.0f, out_left_ch + num_out, out_right_ch + num_out)) {
+            ++num_out;
+        }
+        ++num_flushed_;
+    }
+    return num_out;
+}
+
+// -- Chain
+void postprocess(float* left_ch, float* right_ch, size_t num_samples, int32_t sample_rate,
+                 const PostProcessOptions& options) {
+    AUDIOGEN_TRACE("postprocess");
+
+    const double fs = static_cast<double>(sample_rate);
+    float* channels[2] = {left_ch, right_ch};
+
+    // One-pole high pass: y[n] = x[n] - x[n-1] + r * y[n-1]
+    const float dc_coeff = static_cast<float>(std::exp(-2.0 * k_pi * k_dc_cutoff_hz / fs));
+    float dc_state[2][2] = {};  // {x[n-1], y[n-1]} per channel
+
+    const size_t fade_in_len = std::min(num_samples, static_cast<size_t>(options.fade_in_ms * fs / 1000.0));
+    const size_t fade_out_len = std::min(num_samples, static_cast<size_t>(options.fade_out_ms * fs / 1000.0));
+
+    LoudnessMeter meter(sample_rate);
+
+    // Without loudness normalization, the limiter runs in the same pass as the other stages
+    std::unique_ptr<TruePeakLimiter> limiter;
+    if (options.limit_true_peak && !options.normalize_loudness) {
+        limiter = std::make_unique<TruePeakLimiter>(sample_rate, options.true_peak_dbtp);
+    }
+    size_t num_limited = 0;
+
+    for (size_t pos = 0; pos < num_samples; pos += k_block_size) {
+        const size_t n = std::min(k_block_size, num_samples - pos);
+
+        if (options.remove_dc) {
+            for (size_t c = 0; c < 2; ++c) {
+                float* x = channels[c] + pos;
+                float prev_x = dc_state[c][0];
+                float prev_y = dc_state[c][1];
+                for (size_t i = 0; i < n; ++i) {
+                    const float y = x[i] - prev_x + dc_coeff * prev_y;
+                    prev_x = x[i];
+                    prev_y = y;
+                    x[i] = y;
+                }
+                dc_state[c][0] = prev_x;
+                dc_state[c][1] = prev_y;
+            }
+        }
+
+        // Fades, only on the blocks overlapping them
+        if (pos < fade_in_len) {
+            const size_t end = std::min(n, fade_in_len - pos);
+            for (size_t i = 0; i < end; ++i) {
+                const float g = fade_gain(static_cast<double>(pos + i) / fade_in_len);
+                left_ch[pos + i] *= g;
+                right_ch[pos + i] *= g;
+            }
+        }
+        if (pos + n > num_samples - fade_out_len) {
+            const size_t begin = std::max(pos, num_samples - fade_out_len) - pos;
+            for (size_t i = begin; i < n; ++i) {
+                const float g = fade_gain(static_cast<double>(num_samples - 1 - (pos + i)) / fade_out_len);
+                left_ch[pos + i] *= g;
+                right_ch[pos + i] *= g;
+            }
+        }
+
+        if (options.normalize_loudness) {
+            meter.process(left_ch + pos, right_ch + pos, n);
+        }
+
+        if (limiter) {
+            num_limited += limiter->process(left_ch + pos, right_ch + pos, n, left_ch + num_limited, right_ch + num_limited);
+        }
+    }
+
+    if (options.normalize_loudness) {
+        const double loudness = meter.integrated_lufs();
+        // Silent clips are left as they are
+        const float gain = std::isfinite(loudness) ? db_to_gain(options.target_lufs - loudness) : 1.0f;
+
+        if (options.limit_true_peak) {
+            limiter = std::make_unique<TruePeakLimiter>(sample_rate, options.true_peak_dbtp, gain);
+            for (size_t pos = 0; pos < num_samples; pos += k_block_size) {
+                const size_t n = std::min(k_block_size, num_samples - pos);
+                num_limited += limiter->process(left_ch + pos, right_ch + pos, n, left_ch + num_limited, right_ch + num_limited);
+            }
+        } else {
+            for (size_t i = 0; i < num_samples; ++i) {
+                left_ch[i] *= gain;
+                right_ch[i] *= gain;
+            }
+        }
+    }
+
+    if (limiter) {
+        num_limited += limiter->flush(left_ch + num_limited, right_ch + num_limited);
+        AUDIOGEN_CHECK(num_limited == num_samples);
+    }
+}
+
+} // namespace audiogen
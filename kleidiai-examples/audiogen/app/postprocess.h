@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audiogen {
+
+// -- Post-processing of the generated audio
+// Applied in place on the planar output of the autoencoder, before the file is written,
+// so that no external tool has to read and rewrite the audio.
+struct PostProcessOptions {
+    bool  remove_dc          = false;
+    float fade_in_ms         = 0.0f;
+    float fade_out_ms        = 0.0f;
+    bool  normalize_loudness = false;
+    float target_lufs        = -14.0f;   // Integrated loudness (ITU-R BS.1770)
+    bool  limit_true_peak    = false;
+    float true_peak_dbtp     = -1.0f;    // Ceiling of the limiter
+
+    bool enabled() const {
+        return remove_dc || fade_in_ms > 0.0f || fade_out_ms > 0.0f || normalize_loudness || limit_true_peak;
+    }
+};
+
+// Integrated loudness of a stereo signal as defined by ITU-R BS.1770-4 (K-weighting,
+// 400 ms blocks overlapping by 75%, absolute and relative gates). Fed block by block.
+class LoudnessMeter {
+public:
+    explicit LoudnessMeter(int32_t sample_rate);
+
+    void process(const float* left_ch, const float* right_ch, size_t num_samples);
+
+    // In LUFS, -infinity if every block is below the absolute gate (or the clip is shorter than 400 ms)
+    double integrated_lufs() const;
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    Biquad pre_filter_;  // High shelf, models the acoustic effect of the head
+    Biquad rlb_filter_;  // High pass
+    double state_[2][6] = {};  // Per channel, direct form I state of the two stages
+
+    size_t sub_block_len_;  // 100 ms
+    size_t sub_block_pos_ = 0;
+    double sub_block_energy_ = 0.0;
+    std::vector<double> sub_block_energies_;
+};
+
+// Look-ahead limiter keeping the true peak (estimated with a 4x oversampling, as in BS.1770)
+// below a ceiling. A gain can be applied to the input, e.g. to normalize the loudness in the
+// same pass. The output is delayed by latency() samples.
+class TruePeakLimiter {
+public:
+    TruePeakLimiter(int32_t sample_rate, float ceiling_dbtp, float input_gain = 1.0f);
+
+    size_t latency() const { return latency_; }
+
+    // Limit num_samples input samples. The output of the samples received latency() samples
+    // earlier is written to out_left_ch and out_right_ch, and the number of output samples is
+    // returned (less than num_samples at the start of the stream). The output buffers may be the
+    // input buffers or lag behind them, to process a buffer in place.
+    size_t process(const float* left_ch, const float* right_ch, size_t num_samples,
+                   float* out_left_ch, float* out_right_ch);
+
+    // Output the samples still in the delay line. Returns their number, at most latency().
+    size_t flush(float* out_left_ch, float* out_right_ch);
+
+private:
+    // Peak of the interpolated signal around the oldest samples of the history
+    float true_peak(const float* history) const;
+    // Returns false while the delay line is filling up
+    bool step(float left, float right, float* out_left, float* out_right);
+
+    static constexpr size_t k_oversampling = 4;
+    static constexpr size_t k_taps_per_phase = 12;
+    // Delay of the interpolation filter, in input samples
+    static constexpr size_t k_interp_delay = k_taps_per_phase / 2;
+
+    float ceiling_;
+    float input_gain_;
+    float release_coeff_;
+    size_t attack_len_;
+    size_t latency_;
+
+    // Polyphase interpolation filter, [phase][tap]
+    float interp_[k_oversampling][k_taps_per_phase];
+    // Last input samples of each channel, stored twice so that they are contiguous from any position
+    float history_[2][2 * k_taps_per_phase] = {};
+    size_t history_pos_ = 0;
+
+    // Delay line of the input samples
+    std::vector<float> delay_[2];
+    size_t num_samples_ = 0;     // Received so far
+    size_t num_flushed_ = 0;     // Zeros pushed by flush()
+
+    // Sliding minimum of the gain needed by each sample, over the look-ahead window
+    std::vector<size_t> min_index_;
+    std::vector<float> min_value_;
+    size_t min_head_ = 0;
+    size_t min_tail_ = 0;
+
+    // Moving average of the sliding minimum, over the attack
+    std::vector<float> attack_;
+    double attack_sum_ = 0.0;
+
+    float gain_ = 1.0f;
+};
+
+// Run the post-processing chain in place, in blocks: DC removal, fades, loudness normalization
+// and true-peak limiting. The loudness normalization needs the integrated loudness of the whole
+// clip, so it reads the buffer twice.
+void postprocess(float* left_ch, float* right_ch, size_t num_samples, int32_t sample_rate,
+                 const PostProcessOptions& options);
+
+} // namespace audiogen
@@ -0,0 +1,273 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Python module over the generation pipeline (see "Python bindings" in the README).
+// The models stay loaded in a pyaudiogen.Pipeline object, the GIL is released while the
+// models run, and the audio and the latent are returned as NumPy arrays viewing the
+// buffers of the pipeline, without any copy.
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+#include "audio_io.h"
+#include "backend.h"
+#include "pipeline.h"
+#include "result_cache.h"
+
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace audiogen {
+namespace {
+
+// The pipelines of a process using the same cache directory share a ResultCache, so that their
+// identical requests are coalesced
+static std::shared_ptr<ResultCache> shared_result_cache(const std::string& dir, size_t max_bytes) {
+    static std::mutex cache_mutex;
+    static std::map<std::string, std::weak_ptr<ResultCache>> caches;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::shared_ptr<ResultCache> cache = caches[dir].lock();
+    if (cache == nullptr) {
+        cache = std::make_shared<ResultCache>(dir, max_bytes);
+        caches[dir] = cache;
+    }
+    return cache;
+}
+
+class PyPipeline {
+public:
+    PyPipeline(const std::string& models_base_path, size_t num_threads, const std::string& backend_name, bool warmup,
+               const std::string& result_cache_dir, size_t result_cache_size_mb) {
+        backend_ = create_backend(backend_name, num_threads);
+        if (backend_ == nullptr) {
+            throw py::value_error("Backend not available in this build: " + backend_name);
+        }
+
+        // The pipeline exits on a missing file, which would take the interpreter down with it
+        std::vector<std::string> paths = {models_base_path + "/spiece.model"};
+        for (const ModelKind kind : {ModelKind::Conditioners, ModelKind::DiT, ModelKind::Decoder}) {
+            paths.push_back(backend_->model_path(models_base_path, kind));
+        }
+        for (const auto& path : paths) {
+            if (!std::ifstream(path)) {
+                throw std::runtime_error("Cannot open " + path);
+            }
+        }
+
+        pipeline_ = std::make_unique<Pipeline>(*backend_, models_base_path);
+        // The encoder is only loaded for style transfer, keep it for the next calls as well
+        pipeline_->set_keep_encoder_loaded(true);
+        if (!result_cache_dir.empty()) {
+            result_cache_ = shared_result_cache(result_cache_dir, result_cache_size_mb * 1024 * 1024);
+            pipeline_->set_result_cache(result_cache_.get());
+        }
+
+        py::gil_scoped_release release;
+        pipeline_->load();
+        // Also times each stage, for deadline_ms to apply from the first generation
+        if (warmup) {
+            pipeline_->calibrate();
+        }
+    }
+
+    // The arrays keep the Python pipeline object alive, and are overwritten by the next call
+    // to generate() or decode() on it
+    static py::dict generate(py::object self, const GenerationParams& params, const std::string& init_audio, py::object on_step) {
+        PyPipeline& pipeline = self.cast<PyPipeline&>();
+
+        // The pipeline exits on invalid parameters and audio files, as for the model files above
+        if (params.num_steps == 0) {
+            throw py::value_error("num_steps must be at least 1");
+        }
+        if (!(params.sigma_max > 0.0f && params.sigma_max <= 1.0f)) {
+            throw py::value_error("sigma_max must be in (0, 1]");
+        }
+        if (!(params.audio_len_sec > 0.0f && std::isfinite(params.audio_len_sec))) {
+            throw py::value_error("audio_len_sec must be positive");
+        }
+        if (!(params.convergence_threshold >= 0.0f) || params.deadline_ms < 0) {
+            throw py::value_error("convergence_threshold and deadline_ms cannot be negative");
+        }
+        std::vector<float> init_left_ch;
+        std::vector<float> init_right_ch;
+        if (!init_audio.empty()) {
+            std::string error;
+            py::gil_scoped_release release;
+            if (!try_read_wav(init_audio, init_left_ch, init_right_ch, error)) {
+                throw std::runtime_error(error);
+            }
+        }
+
+        // Python exceptions raised during the diffusion (Ctrl+C included) cancel the generation
+        // and are raised again once it has stopped
+        std::atomic<bool> cancel_requested{false};
+        std::exception_ptr error;
+        const ProgressCallback callback = [&](const StepProgress& progress, const float*) {
+            py::gil_scoped_acquire acquire;
+            try {
+                if (PyErr_CheckSignals() != 0) {
+                    throw py::error_already_set();
+                }
+                if (!on_step.is_none()) {
+                    on_step(progress.step, progress.num_steps, progress.step_ms);
+                }
+            } catch (...) {
+                error = std::current_exception();
+                cancel_requested = true;
+            }
+        };
+
+        GenerationParams run_params = params;
+        GenerationResult result;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(pipeline.mutex_);
+            if (!init_audio.empty()) {
+                run_params.init_latent = pipeline.pipeline_->encode_audio(init_audio, init_left_ch, init_right_ch,
+                                                                          run_params.init_latent_frames);
+            }
+            result = pipeline.pipeline_->generate(run_params, callback, &cancel_requested);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        py::dict out;
+        if (result.left_ch != nullptr) {
+            out["audio"] = audio_view(result, self);
+        } else {
+            out["audio"] = py::none();
+        }
+        out["latent"] = pipeline.latent_view(self);
+        out["num_steps_run"] = result.num_steps_run;
+        out["num_steps_skipped"] = result.num_steps_skipped;
+        out["first_step"] = result.first_step;
+        out["num_steps_planned"] = result.num_steps_planned;
+        out["deadline_cut"] = result.deadline_cut;
+        out["cache_hit"] = result.cache_hit;
+        out["t5_ms"] = result.t5_ms;
+        out["t5_seq_len"] = result.t5_seq_len;
+        out["dit_ms"] = result.dit_ms;
+        out["autoencoder_ms"] = result.autoencoder_ms;
+        return out;
+    }
+
+    static py::array_t<float> decode(py::object self, py::array_t<float, py::array::c_style | py::array::forcecast> latent) {
+        PyPipeline& pipeline = self.cast<PyPipeline&>();
+
+        const size_t num_elems = pipeline.pipeline_->latent().num_elems();
+        if (static_cast<size_t>(latent.size()) != num_elems) {
+            throw py::value_error("The latent must have " + std::to_string(num_elems) + " elements");
+        }
+
+        GenerationResult result;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(pipeline.mutex_);
+            result = pipeline.pipeline_->decode(latent.data(), num_elems);
+        }
+        return audio_view(result, self);
+    }
+
+    py::array_t<float> latent_view(py::handle owner) {
+        const TensorView latent = pipeline_->latent();
+
+        std::vector<py::ssize_t> shape(latent.dims.begin(), latent.dims.end());
+        std::vector<py::ssize_t> strides(shape.size());
+        py::ssize_t stride = sizeof(float);
+        for (size_t i = shape.size(); i-- > 0;) {
+            strides[i] = stride;
+            stride *= shape[i];
+        }
+        return py::array_t<float>(shape, strides, latent.as<float>(), owner);
+    }
+
+private:
+    // [2, num_samples] view over the planar output of the autoencoder
+    static py::array_t<float> audio_view(const GenerationResult& result, py::handle owner) {
+        const py::ssize_t channel_stride = (result.right_ch - result.left_ch) * static_cast<py::ssize_t>(sizeof(float));
+        return py::array_t<float>({py::ssize_t(2), static_cast<py::ssize_t>(result.num_samples)},
+                                  {channel_stride, static_cast<py::ssize_t>(sizeof(float))},
+                                  result.left_ch, owner);
+    }
+
+    // The pipeline uses the backend and the cache, so it is declared last to be destroyed first
+    std::unique_ptr<Backend> backend_;
+    std::shared_ptr<ResultCache> result_cache_;
+    std::unique_ptr<Pipeline> pipeline_;
+
+    // Serializes the calls from several Python threads, taken without the GIL
+    std::mutex mutex_;
+};
+
+} // namespace
+} // namespace audiogen
+
+PYBIND11_MODULE(pyaudiogen, m) {
+    using namespace audiogen;
+
+    m.doc() = "Stable Audio Open Small generation pipeline";
+    m.attr("SAMPLE_RATE") = k_audio_sr;
+
+    py::class_<PyPipeline>(m, "Pipeline")
+        .def(py::init<const std::string&, size_t, const std::string&, bool, const std::string&, size_t>(),
+            py::arg("models_base_path"), py::arg("num_threads") = 4,
+            py::arg("backend") = AUDIOGEN_DEFAULT_BACKEND, py::arg("warmup") = true,
+            py::arg("result_cache_dir") = "", py::arg("result_cache_size_mb") = 1024,
+            "Load the models, once for all the generations of this object. With warmup, each stage is also\n"
+            "timed once, so that deadline_ms applies from the first generation")
+        .def("generate",
+            [](py::object self, const std::string& prompt, size_t seed, size_t num_steps, float audio_len_sec,
+               float sigma_max, float convergence_threshold, long deadline_ms, bool decode,
+               const std::string& init_audio, py::object on_step) {
+                GenerationParams params;
+                params.prompt                = prompt;
+                params.seed                  = seed;
+                params.num_steps             = num_steps;
+                params.audio_len_sec         = audio_len_sec;
+                params.sigma_max             = sigma_max;
+                params.convergence_threshold = convergence_threshold;
+                params.deadline_ms           = deadline_ms;
+                params.decode                = decode;
+                return PyPipeline::generate(self, params, init_audio, on_step);
+            },
+            py::arg("prompt"), py::arg("seed") = k_seed_default, py::arg("num_steps") = k_num_steps_default,
+            py::arg("audio_len_sec") = static_cast<float>(k_audio_len_sec_default), py::arg("sigma_max") = k_sigma_max,
+            py::arg("convergence_threshold") = 0.0f, py::arg("deadline_ms") = 0, py::arg("decode") = true,
+            py::arg("init_audio") = "", py::arg("on_step") = py::none(),
+            "Generate a clip. Returns a dict with the audio ([2, num_samples] float32, None if not decoded),\n"
+            "the latent and the timings. The arrays view the buffers of the pipeline: they are overwritten\n"
+            "by the next call to generate() or decode(), copy them to keep them.\n"
+            "on_step(step, num_steps, step_ms) is called after each DiT step.")
+        .def("decode", &PyPipeline::decode, py::arg("latent"),
+            "Run the autoencoder on a latent with the shape of Pipeline.latent(). Returns a view, as generate()")
+        .def("latent", [](py::object self) { return self.cast<PyPipeline&>().latent_view(self); },
+            "View over the latent of the last generation");
+}
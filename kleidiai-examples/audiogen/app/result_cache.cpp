@@ -0,0 +1,210 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "result_cache.h"
+#include "common.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace audiogen {
+
+namespace fs = std::filesystem;
+
+constexpr size_t k_fingerprint_head_size = 1 << 20;
+
+ResultCache::ResultCache(const std::string& dir, size_t max_bytes) : dir_(dir), max_bytes_(max_bytes) {
+    std::error_code error;
+    fs::create_directories(dir_, error);
+    if (error) {
+        fprintf(stderr, "Warning: cannot create the result cache directory %s: %s\n", dir_.c_str(), error.message().c_str());
+    }
+}
+
+uint64_t ResultCache::file_fingerprint(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = fingerprints_.find(path);
+        if (it != fingerprints_.end()) {
+            return it->second;
+        }
+    }
+
+    // A missing file (e.g. an optional token-length bucket) has a fingerprint as well
+    std::error_code error;
+    const uint64_t size = fs::exists(path, error) ? static_cast<uint64_t>(fs::file_size(path, error)) : 0;
+    const int64_t mtime = size != 0 ? static_cast<int64_t>(fs::last_write_time(path, error).time_since_epoch().count()) : 0;
+
+    std::vector<char> head(k_fingerprint_head_size);
+    std::ifstream in(path, std::ios::binary);
+    in.read(head.data(), static_cast<std::streamsize>(head.size()));
+
+    uint64_t fingerprint = hash_bytes(head.data(), static_cast<size_t>(in.gcount()));
+    fingerprint = hash_bytes(&size, sizeof(size), fingerprint);
+    fingerprint = hash_bytes(&mtime, sizeof(mtime), fingerprint);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    fingerprints_[path] = fingerprint;
+    return fingerprint;
+}
+
+std::string ResultCache::entry_path(uint64_t key, const char* extension) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(key), extension);
+    return dir_ + "/" + name;
+}
+
+ResultCache::Lease ResultCache::acquire(uint64_t key) {
+    Lease lease(this, key);
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (in_flight_.count(key) != 0) {
+            lease.waited_ = true;
+            released_.wait(lock);
+        }
+        in_flight_.insert(key);
+    }
+
+    // Read without holding the lock, the lease keeps the other requests of the key waiting
+    const std::string latent_path = entry_path(key, ".latent");
+    if (std::ifstream(latent_path).good()) {
+        lease.latent_ = LatentFile::open(latent_path);
+    }
+    const std::string audio_path = entry_path(key, ".audio");
+    if (lease.latent_ != nullptr && std::ifstream(audio_path).good()) {
+        lease.audio_ = LatentFile::open(audio_path);
+    }
+
+    // Recently used entries are evicted last
+    if (lease.latent_ != nullptr) {
+        std::error_code error;
+        const auto now = fs::file_time_type::clock::now();
+        fs::last_write_time(latent_path, now, error);
+        if (lease.audio_ != nullptr) {
+            fs::last_write_time(audio_path, now, error);
+        }
+    }
+    return lease;
+}
+
+void ResultCache::release(uint64_t key) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_flight_.erase(key);
+    }
+    released_.notify_all();
+}
+
+ResultCache::Lease::Lease(Lease&& other) noexcept
+    : cache_(other.cache_), key_(other.key_), waited_(other.waited_),
+      latent_(std::move(other.latent_)), audio_(std::move(other.audio_)) {
+    other.cache_ = nullptr;
+}
+
+ResultCache::Lease::~Lease() {
+    if (cache_ != nullptr) {
+        cache_->release(key_);
+    }
+}
+
+// Written next to the entry and then renamed, so that another process sharing the directory
+// never reads a partial file
+static void save_entry_file(const std::string& path, const LatentInfo& info, const float* data) {
+    const std::string tmp_path = path + ".tmp" + std::to_string(time_in_ns());
+    save_latent(tmp_path, info, data);
+
+    std::error_code error;
+    fs::rename(tmp_path, path, error);
+    if (error) {
+        fprintf(stderr, "Warning: cannot write %s: %s\n", path.c_str(), error.message().c_str());
+        fs::remove(tmp_path, error);
+    }
+}
+
+void ResultCache::Lease::store(const LatentInfo& info, const float* latent,
+                               const float* left_ch, const float* right_ch, size_t num_samples) {
+    AUDIOGEN_CHECK(cache_ != nullptr);
+
+    if (latent != nullptr) {
+        save_entry_file(cache_->entry_path(key_, ".latent"), info, latent);
+    }
+    if (left_ch != nullptr) {
+        // Planar, as the output of the autoencoder
+        std::vector<float> audio(left_ch, left_ch + num_samples);
+        audio.insert(audio.end(), right_ch, right_ch + num_samples);
+
+        LatentInfo audio_info = info;
+        audio_info.dims = {2, static_cast<int64_t>(num_samples)};
+        save_entry_file(cache_->entry_path(key_, ".audio"), audio_info, audio.data());
+    }
+    cache_->evict();
+}
+
+void ResultCache::evict() {
+    if (max_bytes_ == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(evict_mutex_);
+
+    // The files of an entry are evicted together, from the least recently used entry
+    struct Entry {
+        uint64_t size = 0;
+        fs::file_time_type last_used = fs::file_time_type::min();
+        std::vector<fs::path> files;
+    };
+    std::map<std::string, Entry> entries;   // By key
+    uint64_t total_size = 0;
+
+    std::error_code error;
+    for (const auto& file : fs::directory_iterator(dir_, error)) {
+        const std::string extension = file.path().extension().string();
+        if (!file.is_regular_file(error) || (extension != ".latent" && extension != ".audio")) {
+            continue;
+        }
+        Entry& entry = entries[file.path().stem().string()];
+        const uint64_t size = file.file_size(error);
+        entry.size += size;
+        entry.last_used = std::max(entry.last_used, file.last_write_time(error));
+        entry.files.push_back(file.path());
+        total_size += size;
+    }
+    if (total_size <= max_bytes_) {
+        return;
+    }
+
+    std::vector<const Entry*> by_age;
+    for (const auto& entry : entries) {
+        by_age.push_back(&entry.second);
+    }
+    std::sort(by_age.begin(), by_age.end(), [](const Entry* a, const Entry* b) { return a->last_used < b->last_used; });
+
+    for (const Entry* entry : by_age) {
+        if (total_size <= max_bytes_) {
+            break;
+        }
+        // An entry mapped by a reader stays readable until unmapped (on POSIX)
+        for (const fs::path& path : entry->files) {
+            fs::remove(path, error);
+        }
+        total_size -= entry->size;
+    }
+}
+
+} // namespace audiogen
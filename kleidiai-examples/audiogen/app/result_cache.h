@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "latent_io.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace audiogen {
+
+// Results of the generations, on disk, keyed by a hash of everything they depend on (models,
+// prompt, seed, schedule, length, input audio...), so that identical requests (client retries,
+// popular presets) are only run once. Each entry holds the final latent (<key>.latent, which
+// --decode can read) and, once decoded, the audio before post-processing (<key>.audio, planar,
+// in the same container). The least recently used entries are evicted past the size cap.
+//
+// Identical requests running concurrently (e.g. on several workers) are coalesced: the first one
+// runs the generation, the others wait for its result. Thread-safe, shared by the pipelines.
+class ResultCache {
+public:
+    // A max_bytes of 0 never evicts
+    ResultCache(const std::string& dir, size_t max_bytes);
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Identity of a model file, for the keys: its size, modification time and the hash of its
+    // first MiB. Computed once per path, so that the models are not read again on every request.
+    uint64_t file_fingerprint(const std::string& path);
+
+    // Exclusive access to a key, from acquire() until destroyed, at which point the next request
+    // of the same key (if any) looks the cache up again
+    class Lease {
+    public:
+        ~Lease();
+
+        Lease(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+
+        // Null if not cached. The audio may be missing when only the latent was requested before.
+        const LatentFile* latent() const { return latent_.get(); }
+        const LatentFile* audio() const { return audio_.get(); }
+
+        // Whether another request of the same key was running when this one started
+        bool waited() const { return waited_; }
+
+        // Save the latent unless null, e.g. when it was already cached, and the audio unless left_ch is
+        // null. The info of the audio is the one of the latent, with the dims of the audio.
+        void store(const LatentInfo& info, const float* latent,
+                   const float* left_ch, const float* right_ch, size_t num_samples);
+
+    private:
+        friend class ResultCache;
+        Lease(ResultCache* cache, uint64_t key) : cache_(cache), key_(key) {}
+
+        ResultCache* cache_;
+        uint64_t key_;
+        bool waited_ = false;
+        std::unique_ptr<LatentFile> latent_;
+        std::unique_ptr<LatentFile> audio_;
+    };
+
+    // Wait until no other request of this key is running, then look it up
+    Lease acquire(uint64_t key);
+
+private:
+    std::string entry_path(uint64_t key, const char* extension) const;
+    void release(uint64_t key);
+    // Remove the least recently used entries until the directory fits in max_bytes_
+    void evict();
+
+    std::string dir_;
+    size_t max_bytes_;
+
+    std::mutex mutex_;
+    std::condition_variable released_;
+    std::set<uint64_t> in_flight_;
+    std::map<std::string, uint64_t> fingerprints_;  // By path
+
+    // Serializes the eviction scans
+    std::mutex evict_mutex_;
+};
+
+} // namespace audiogen
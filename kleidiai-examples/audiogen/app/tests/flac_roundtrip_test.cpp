@@ -0,0 +1,243 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Round trip of the FLAC encoder through the reference decoder: synthetic signals are encoded with
+// several options, then `flac -t` checks the CRCs and the MD5 of the STREAMINFO, and the decoded
+// samples are compared with the quantized input. Exits with 77 (skipped) when flac is not installed.
+
+#include "flac_encoder.h"
+#include "audio_io.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audiogen;
+
+namespace {
+
+constexpr int32_t k_exit_skipped = 77;
+
+struct Signal {
+    std::string name;
+    size_t num_samples;
+    std::function<void(std::vector<float>& left_ch, std::vector<float>& right_ch)> fill;
+};
+
+struct Config {
+    std::string name;
+    FlacOptions options;
+};
+
+std::vector<Signal> get_signals() {
+    constexpr double k_pi = 3.14159265358979323846;
+    // Not a multiple of any block size of the configs, so the last frame is always partial
+    constexpr size_t k_num_samples = 3 * 44100 + 1237;
+
+    return {
+        {"silence", k_num_samples, [](std::vector<float>& l, std::vector<float>& r) {
+            std::fill(l.begin(), l.end(), 0.0f);
+            std::fill(r.begin(), r.end(), 0.0f);
+        }},
+        // Same on both channels: the side channel is zero
+        {"sine_mono", k_num_samples, [=](std::vector<float>& l, std::vector<float>& r) {
+            for (size_t i = 0; i < l.size(); ++i) {
+                l[i] = r[i] = static_cast<float>(0.5 * std::sin(2.0 * k_pi * 440.0 * i / k_audio_sr));
+            }
+        }},
+        {"sine_stereo", k_num_samples, [=](std::vector<float>& l, std::vector<float>& r) {
+            for (size_t i = 0; i < l.size(); ++i) {
+                l[i] = static_cast<float>(0.7 * std::sin(2.0 * k_pi * 440.0 * i / k_audio_sr));
+                r[i] = static_cast<float>(0.3 * std::sin(2.0 * k_pi * 660.0 * i / k_audio_sr + 1.0));
+            }
+        }},
+        // Nothing to predict: the verbatim subframes and the widest Rice parameters
+        {"white_noise", k_num_samples, [](std::vector<float>& l, std::vector<float>& r) {
+            std::mt19937 rng(42);
+            std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+            for (size_t i = 0; i < l.size(); ++i) {
+                l[i] = dist(rng);
+                r[i] = dist(rng);
+            }
+        }},
+        // Clipped to the extreme values of the sample format
+        {"full_scale_clipping", k_num_samples, [=](std::vector<float>& l, std::vector<float>& r) {
+            for (size_t i = 0; i < l.size(); ++i) {
+                l[i] = static_cast<float>(1.5 * std::sin(2.0 * k_pi * 100.0 * i / k_audio_sr));
+                r[i] = (i / 50) % 2 == 0 ? 2.0f : -2.0f;
+            }
+        }},
+        {"chirp_and_noise", k_num_samples, [=](std::vector<float>& l, std::vector<float>& r) {
+            std::mt19937 rng(7);
+            std::normal_distribution<float> dist(0.0f, 0.01f);
+            for (size_t i = 0; i < l.size(); ++i) {
+                const double t = static_cast<double>(i) / k_audio_sr;
+                l[i] = static_cast<float>(0.8 * std::sin(2.0 * k_pi * (50.0 + 2000.0 * t) * t)) + dist(rng);
+                r[i] = l[i] * 0.9f + dist(rng);
+            }
+        }},
+        // Shorter than any block
+        {"short", 10, [](std::vector<float>& l, std::vector<float>& r) {
+            for (size_t i = 0; i < l.size(); ++i) {
+                l[i] = 0.1f * static_cast<float>(i);
+                r[i] = -0.05f * static_cast<float>(i);
+            }
+        }},
+    };
+}
+
+std::vector<Config> get_configs() {
+    std::vector<Config> configs;
+
+    Config config;
+    config.name = "default";
+    configs.push_back(config);
+
+    config = Config();
+    config.name = "24bit";
+    config.options.bits_per_sample = 24;
+    configs.push_back(config);
+
+    // A block size without a code of its own, stored at the end of the frame header
+    config = Config();
+    config.name = "block1000_fixed";
+    config.options.block_size = 1000;
+    config.options.max_lpc_order = 0;
+    configs.push_back(config);
+
+    config = Config();
+    config.name = "block192_lpc32";
+    config.options.block_size = 192;
+    config.options.max_lpc_order = 32;
+    configs.push_back(config);
+
+    // Frame numbers past 127 take several bytes of the UTF-8 coding
+    config = Config();
+    config.name = "block16_24bit";
+    config.options.block_size = 16;
+    config.options.bits_per_sample = 24;
+    config.options.num_threads = 1;
+    configs.push_back(config);
+
+    return configs;
+}
+
+// Same quantization as FlacWriter::write()
+int32_t quantize(float value, uint32_t bits_per_sample) {
+    const double scale = static_cast<double>(1 << (bits_per_sample - 1));
+    const int64_t max_value = (1 << (bits_per_sample - 1)) - 1;
+    const int64_t v = std::llround(value * scale);
+    return static_cast<int32_t>(std::max(-max_value - 1, std::min(max_value, v)));
+}
+
+// Returns an empty string on success, the reason of the failure otherwise
+std::string check_round_trip(const std::string& flac, const std::string& output_dir, const Signal& signal, const Config& config) {
+    std::vector<float> left_ch(signal.num_samples);
+    std::vector<float> right_ch(signal.num_samples);
+    signal.fill(left_ch, right_ch);
+
+    const std::string path = output_dir + "/" + signal.name + "_" + config.name + ".flac";
+    {
+        // In uneven chunks, as the streaming writer receives them
+        FlacWriter writer(path, config.options, k_audio_sr);
+        for (size_t offset = 0, chunk = 777; offset < signal.num_samples; offset += chunk, chunk = chunk * 3 % 5000 + 1) {
+            const size_t n = std::min(chunk, signal.num_samples - offset);
+            writer.write(left_ch.data() + offset, right_ch.data() + offset, n);
+        }
+    }
+
+    // CRC-8 of the frame headers, CRC-16 of the frames and MD5 of the whole stream
+    if (std::system(("\"" + flac + "\" -t -s \"" + path + "\"").c_str()) != 0) {
+        return "flac -t failed";
+    }
+
+    const std::string raw_path = path + ".raw";
+    const std::string decode = "\"" + flac + "\" -d -s -f --force-raw-format --endian=little --sign=signed -o \"" +
+                               raw_path + "\" \"" + path + "\"";
+    if (std::system(decode.c_str()) != 0) {
+        return "flac -d failed";
+    }
+    std::ifstream raw(raw_path, std::ios::binary);
+    const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(raw)), std::istreambuf_iterator<char>());
+
+    const uint32_t bytes_per_sample = config.options.bits_per_sample / 8;
+    if (bytes.size() != signal.num_samples * 2 * bytes_per_sample) {
+        return "decoded " + std::to_string(bytes.size()) + " bytes, expected " +
+               std::to_string(signal.num_samples * 2 * bytes_per_sample);
+    }
+    for (size_t i = 0; i < signal.num_samples * 2; ++i) {
+        uint32_t v = 0;
+        for (uint32_t b = 0; b < bytes_per_sample; ++b) {
+            v |= static_cast<uint32_t>(bytes[i * bytes_per_sample + b]) << (8 * b);
+        }
+        // Sign extension
+        const uint32_t shift = 32 - config.options.bits_per_sample;
+        const int32_t decoded = static_cast<int32_t>(v << shift) >> shift;
+
+        const float input = (i % 2 == 0 ? left_ch : right_ch)[i / 2];
+        const int32_t expected = quantize(input, config.options.bits_per_sample);
+        if (decoded != expected) {
+            return "sample " + std::to_string(i / 2) + " of channel " + std::to_string(i % 2) + " decoded as " +
+                   std::to_string(decoded) + ", expected " + std::to_string(expected);
+        }
+    }
+    std::remove(raw_path.c_str());
+    return "";
+}
+
+} // namespace
+
+int main(int32_t argc, char** argv) {
+    std::string flac;
+    std::string output_dir = ".";
+    for (int32_t i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--flac") == 0) {
+            flac = argv[i + 1];
+        } else if (strcmp(argv[i], "--output_dir") == 0) {
+            output_dir = argv[i + 1];
+        }
+    }
+    if (flac.empty() || flac.find("NOTFOUND") != std::string::npos) {
+        printf("SKIPPED: the flac command line tool is not installed\n");
+        return k_exit_skipped;
+    }
+
+    size_t num_failed = 0;
+    for (const Signal& signal : get_signals()) {
+        for (const Config& config : get_configs()) {
+            const std::string error = check_round_trip(flac, output_dir, signal, config);
+            printf("%-20s %-16s %s\n", signal.name.c_str(), config.name.c_str(), error.empty() ? "ok" : error.c_str());
+            num_failed += error.empty() ? 0 : 1;
+        }
+    }
+
+    if (num_failed > 0) {
+        printf("FAILED: %zu round trips\n", num_failed);
+        return EXIT_FAILURE;
+    }
+    printf("PASSED\n");
+    return EXIT_SUCCESS;
+}
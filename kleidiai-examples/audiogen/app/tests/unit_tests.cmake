@@ -0,0 +1,36 @@
+#
+# SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its affiliates <open-source-office@arm.com>
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+
+# Tests of the components of the app which do not need the models, shared by the LiteRT and the
+# ExecuTorch apps. Run with: ctest -L unit
+find_program(AUDIOGEN_FLAC_EXECUTABLE flac DOC "Reference FLAC decoder used by the FLAC round-trip test")
+
+set(AUDIOGEN_UNIT_TESTS_DIR ${CMAKE_CURRENT_LIST_DIR})
+set(AUDIOGEN_UNIT_TESTS_APP_DIR ${CMAKE_CURRENT_LIST_DIR}/..)
+
+function(audiogen_add_unit_tests)
+  find_package(Threads REQUIRED)
+
+  # FLAC encoder against the reference decoder (skipped if flac is not installed)
+  add_executable(audiogen_flac_roundtrip
+    ${AUDIOGEN_UNIT_TESTS_DIR}/flac_roundtrip_test.cpp
+    ${AUDIOGEN_UNIT_TESTS_APP_DIR}/flac_encoder.cpp
+    ${AUDIOGEN_UNIT_TESTS_APP_DIR}/trace.cpp
+  )
+  target_include_directories(audiogen_flac_roundtrip PRIVATE ${AUDIOGEN_UNIT_TESTS_APP_DIR})
+  target_link_libraries(audiogen_flac_roundtrip PRIVATE Threads::Threads)
+
+  set(output_dir ${CMAKE_BINARY_DIR}/flac_roundtrip)
+  file(MAKE_DIRECTORY ${output_dir})
+  add_test(
+    NAME flac_roundtrip
+    COMMAND audiogen_flac_roundtrip --flac ${AUDIOGEN_FLAC_EXECUTABLE} --output_dir ${output_dir}
+  )
+  set_tests_properties(flac_roundtrip PROPERTIES
+    LABELS unit
+    SKIP_RETURN_CODE 77
+  )
+endfunction()
@@ -0,0 +1,269 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "throughput.h"
+#include "audio_io.h"
+#include "backend.h"
+#include "common.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace audiogen {
+
+// Parse a CPU list of the kernel, e.g. "0-3,8-11"
+static std::vector<int32_t> parse_cpu_list(const std::string& cpu_list) {
+    std::vector<int32_t> cpus;
+    std::istringstream ranges(cpu_list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        const size_t dash = range.find('-');
+        const int32_t first = std::stoi(range.substr(0, dash));
+        const int32_t last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int32_t cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// Split the CPUs into num_chunks contiguous chunks of (almost) the same size
+static void split_cpus(const std::vector<int32_t>& cpus, size_t num_chunks, std::vector<std::vector<int32_t>>& chunks) {
+    for (size_t i = 0; i < num_chunks; ++i) {
+        const size_t begin = i * cpus.size() / num_chunks;
+        const size_t end = (i + 1) * cpus.size() / num_chunks;
+        chunks.emplace_back(cpus.begin() + begin, cpus.begin() + end);
+    }
+}
+
+#if defined(__linux__)
+
+std::vector<std::vector<int32_t>> partition_cpus(size_t num_workers) {
+    cpu_set_t allowed_set;
+    CPU_ZERO(&allowed_set);
+    AUDIOGEN_CHECK(sched_getaffinity(0, sizeof(allowed_set), &allowed_set) == 0);
+
+    std::vector<int32_t> allowed;
+    for (int32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed_set)) {
+            allowed.push_back(cpu);
+        }
+    }
+    AUDIOGEN_CHECK(!allowed.empty());
+
+    std::vector<std::vector<int32_t>> partitions;
+    if (allowed.size() < num_workers) {
+        fprintf(stderr, "Warning: %zu workers for %zu CPUs, some workers share a CPU\n", num_workers, allowed.size());
+        for (size_t i = 0; i < num_workers; ++i) {
+            partitions.push_back({allowed[i % allowed.size()]});
+        }
+        return partitions;
+    }
+
+    // CPUs of each NUMA node this process may run on
+    std::vector<std::vector<int32_t>> nodes;
+    for (size_t node = 0;; ++node) {
+        std::ifstream cpu_list_file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!cpu_list_file.is_open()) {
+            break;
+        }
+        std::string cpu_list;
+        std::getline(cpu_list_file, cpu_list);
+
+        std::vector<int32_t> node_cpus;
+        for (const int32_t cpu : parse_cpu_list(cpu_list)) {
+            if (CPU_ISSET(cpu, &allowed_set)) {
+                node_cpus.push_back(cpu);
+            }
+        }
+        if (!node_cpus.empty()) {
+            nodes.push_back(node_cpus);
+        }
+    }
+
+    const size_t workers_per_node = nodes.empty() ? 0 : num_workers / nodes.size();
+    const bool per_node = nodes.size() > 1 && num_workers % nodes.size() == 0 &&
+        std::all_of(nodes.begin(), nodes.end(), [workers_per_node](const std::vector<int32_t>& node_cpus) {
+            return node_cpus.size() >= workers_per_node;
+        });
+
+    if (per_node) {
+        for (const auto& node_cpus : nodes) {
+            split_cpus(node_cpus, workers_per_node, partitions);
+        }
+    } else {
+        // Neighbouring CPU ids usually share a cluster (and its L2/L3 cache)
+        split_cpus(allowed, num_workers, partitions);
+    }
+    return partitions;
+}
+
+static void pin_current_thread(const std::vector<int32_t>& cpus) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (const int32_t cpu : cpus) {
+        CPU_SET(cpu, &cpu_set);
+    }
+    // pid 0 is the calling thread. The threads it creates afterwards inherit its affinity.
+    if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+        fprintf(stderr, "Warning: failed to pin the worker thread\n");
+    }
+}
+
+#else
+
+std::vector<std::vector<int32_t>> partition_cpus(size_t num_workers) {
+    return std::vector<std::vector<int32_t>>(num_workers);
+}
+
+static void pin_current_thread(const std::vector<int32_t>&) {}
+
+#endif
+
+static std::string format_cpus(const std::vector<int32_t>& cpus) {
+    if (cpus.empty()) {
+        return "any";
+    }
+    std::string formatted;
+    for (const int32_t cpu : cpus) {
+        formatted += (formatted.empty() ? "" : ",") + std::to_string(cpu);
+    }
+    return formatted;
+}
+
+ThroughputStats run_workers(const WorkerOptions& options, const std::vector<Job>& jobs,
+                            const std::atomic<bool>* cancel_requested) {
+    const std::vector<std::vector<int32_t>> cpu_sets = partition_cpus(options.num_workers);
+
+    std::atomic<size_t> next_job{0};
+    // Each job is only written by the worker which popped it
+    std::vector<uint8_t> job_done(jobs.size(), 0);
+
+    metrics_set(MetricGauge::QueueDepth, static_cast<int64_t>(jobs.size()));
+    metrics_set(MetricGauge::Workers, static_cast<int64_t>(options.num_workers));
+    metrics_set(MetricGauge::ThreadsPerWorker, static_cast<int64_t>(options.num_threads_per_worker));
+
+    auto is_cancelled = [cancel_requested]() {
+        return cancel_requested != nullptr && cancel_requested->load();
+    };
+
+    auto worker_main = [&](size_t worker_idx) {
+        const std::vector<int32_t>& cpus = cpu_sets[worker_idx];
+
+        // Pin the thread before the backend is created, so that the thread pool of its
+        // delegates is spawned on the same CPUs
+        pin_current_thread(cpus);
+        if (!cpus.empty() && cpus.size() < options.num_threads_per_worker) {
+            fprintf(stderr, "Warning: worker %zu runs %zu threads on %zu CPUs\n",
+                worker_idx, options.num_threads_per_worker, cpus.size());
+        }
+        fprintf(stderr, "Worker %zu: CPUs %s\n", worker_idx, format_cpus(cpus).c_str());
+
+        std::unique_ptr<Backend> backend = create_backend(options.backend, options.num_threads_per_worker);
+        AUDIOGEN_CHECK(backend != nullptr);
+        backend->set_memory_options(options.memory_options);
+
+        // The frames of each clip are encoded on the CPUs of the worker
+        FlacOptions flac_options = options.flac_options;
+        flac_options.num_threads = static_cast<uint32_t>(options.num_threads_per_worker);
+
+        // Each variant is loaded when a job first needs it
+        ModelRegistry registry(*backend, options.variants, options.memory_budget);
+        registry.set_pipeline_setup([&](Pipeline& pipeline) {
+            // The workers are long-lived, so the encoder stays loaded once a job needs it
+            pipeline.set_encoder_cache_dir(options.encoder_cache_dir);
+            pipeline.set_keep_encoder_loaded(true);
+            pipeline.set_result_cache(options.result_cache);
+            if (options.calibrate) {
+                pipeline.calibrate();
+            } else if (options.warmup) {
+                pipeline.warmup();
+            }
+        });
+
+        while (!is_cancelled()) {
+            const size_t job_idx = next_job.fetch_add(1);
+            if (job_idx >= jobs.size()) {
+                break;
+            }
+            const Job& job = jobs[job_idx];
+            metrics_set(MetricGauge::QueueDepth, static_cast<int64_t>(jobs.size() - job_idx - 1));
+            metrics_add(MetricGauge::ActiveJobs, 1);
+
+            const long start_job = time_in_ms();
+            const long long start_job_ns = time_in_ns();
+            Pipeline* pipeline = registry.get(job.variant);
+            AUDIOGEN_CHECK(pipeline != nullptr);
+
+            GenerationParams params = job.params;
+            if (!job.audio_input_path.empty()) {
+                params.init_latent = pipeline->encode_audio(job.audio_input_path, params.init_latent_frames);
+            }
+            const GenerationResult result = pipeline->generate(params, nullptr, cancel_requested);
+            if (result.cancelled) {
+                metrics_add(MetricCounter::JobsCancelled);
+                metrics_add(MetricGauge::ActiveJobs, -1);
+                break;
+            }
+            if (options.postprocess_options.enabled()) {
+                postprocess(result.left_ch, result.right_ch, result.num_samples, k_audio_sr, options.postprocess_options);
+            }
+            save_audio(job.output_file, result.left_ch, result.right_ch, result.num_samples, flac_options);
+            job_done[job_idx] = 1;
+            metrics_add(MetricCounter::JobsDone);
+            metrics_add(MetricCounter::WorkerBusyNs, static_cast<uint64_t>(time_in_ns() - start_job_ns));
+            metrics_add(MetricGauge::ActiveJobs, -1);
+
+            fprintf(stderr, "Worker %zu: job %zu/%zu done in %ld ms (%s%s)\n",
+                worker_idx, job_idx + 1, jobs.size(), time_in_ms() - start_job, job.output_file.c_str(),
+                result.cache_hit ? ", cached" : "");
+        }
+    };
+
+    const long start = time_in_ms();
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < options.num_workers; ++i) {
+        workers.emplace_back(worker_main, i);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    ThroughputStats stats;
+    stats.wall_ms = time_in_ms() - start;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (job_done[i]) {
+            stats.num_jobs_done++;
+            stats.audio_sec += jobs[i].params.audio_len_sec;
+        }
+    }
+    return stats;
+}
+
+} // namespace audiogen
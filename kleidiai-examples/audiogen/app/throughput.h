@@ -0,0 +1,76 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "flac_encoder.h"
+#include "memory.h"
+#include "model_registry.h"
+#include "pipeline.h"
+#include "postprocess.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace audiogen {
+
+struct Job {
+    GenerationParams params;
+    std::string output_file;
+    std::string audio_input_path;   // Input audio for style transfer, encoded by the worker. Empty for text-to-audio.
+    std::string variant;            // Name of the model variant running the job, one of WorkerOptions::variants
+};
+
+struct WorkerOptions {
+    std::string backend;
+    // The model sets, kept loaded by each worker within the memory budget (0 for no limit)
+    std::vector<ModelVariant> variants;
+    size_t memory_budget = 0;
+    size_t num_workers = 1;
+    size_t num_threads_per_worker = 1;
+    MemoryOptions memory_options;
+    bool warmup = false;
+    bool calibrate = false;     // Measure the stage costs for the deadline control (implies warmup)
+    FlacOptions flac_options;   // For the jobs writing .flac files
+    PostProcessOptions postprocess_options;
+    std::string encoder_cache_dir;
+    // Shared by the workers, so that the identical jobs running at the same time are only run once.
+    // Null for none.
+    ResultCache* result_cache = nullptr;
+};
+
+struct ThroughputStats {
+    size_t num_jobs_done = 0;
+    float audio_sec = 0.0f;     // Length of the audio generated by all the workers
+    long wall_ms = 0;           // From the start of the workers, model loading included
+};
+
+// Split the CPUs this process may run on into num_workers disjoint sets. When the workers
+// can be spread evenly over the NUMA nodes, each set stays within a single node.
+// The sets are empty on platforms without thread affinity (e.g. macOS).
+std::vector<std::vector<int32_t>> partition_cpus(size_t num_workers);
+
+// Run the jobs with num_workers pipelines, each on its own thread pinned to its own set of
+// CPUs, pulling the next job from a shared queue until it is empty or cancellation is requested
+ThroughputStats run_workers(const WorkerOptions& options, const std::vector<Job>& jobs,
+                            const std::atomic<bool>* cancel_requested = nullptr);
+
+} // namespace audiogen
@@ -0,0 +1,269 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trace.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace audiogen {
+
+namespace detail {
+std::atomic<bool> g_trace_enabled{false};
+}
+
+namespace {
+
+// Reserved per thread up front, so that recording does not allocate in the DiT loop
+constexpr size_t k_events_reserved = 4096;
+
+struct TraceEvent {
+    const char* name;
+    int64_t arg;
+    long long start_ns;
+    long long end_ns;
+    TraceCounters counters;
+};
+
+struct ThreadBuffer {
+    uint32_t tid = 0;
+    std::vector<TraceEvent> events;
+};
+
+std::mutex g_buffers_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+thread_local ThreadBuffer* t_buffer = nullptr;
+
+long long g_trace_start_ns = 0;
+bool g_hw_counters = false;
+
+// The buffers outlive their threads, so the spans of the workers can still be written at exit
+static ThreadBuffer& get_thread_buffer() {
+    if (t_buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(g_buffers_mutex);
+        g_buffers.push_back(std::make_unique<ThreadBuffer>());
+        t_buffer = g_buffers.back().get();
+        t_buffer->tid = static_cast<uint32_t>(g_buffers.size());
+        t_buffer->events.reserve(k_events_reserved);
+    }
+    return *t_buffer;
+}
+
+#if defined(__linux__)
+// One group of counters (cycles leading instructions and cache misses) per thread of the process.
+// A group is read in a single syscall.
+std::vector<int32_t> g_group_fds;
+
+static int32_t open_counter(pid_t tid, uint64_t config, int32_t group_fd) {
+    perf_event_attr attr = {};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int32_t>(syscall(SYS_perf_event_open, &attr, tid, -1, group_fd, 0));
+}
+
+static bool open_counters() {
+    DIR* dir = opendir("/proc/self/task");
+    if (dir == nullptr) {
+        return false;
+    }
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        const pid_t tid = static_cast<pid_t>(atoi(entry->d_name));
+        const int32_t leader = open_counter(tid, PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (leader < 0) {
+            continue;
+        }
+        if (open_counter(tid, PERF_COUNT_HW_INSTRUCTIONS, leader) < 0 ||
+            open_counter(tid, PERF_COUNT_HW_CACHE_MISSES, leader) < 0) {
+            close(leader);
+            continue;
+        }
+        g_group_fds.push_back(leader);
+    }
+    closedir(dir);
+    return !g_group_fds.empty();
+}
+
+static void read_counters(TraceCounters& counters) {
+    counters = TraceCounters();
+    for (const int32_t fd : g_group_fds) {
+        uint64_t values[1 + 3];
+        if (read(fd, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values))) {
+            continue;
+        }
+        counters.cycles += values[1];
+        counters.instructions += values[2];
+        counters.llc_misses += values[3];
+    }
+}
+#else
+static bool open_counters() {
+    return false;
+}
+
+static void read_counters(TraceCounters& counters) {
+    counters = TraceCounters();
+}
+#endif
+
+} // namespace
+
+void TraceSpan::begin(const char* name, int64_t arg) {
+    name_ = name;
+    arg_ = arg;
+    if (g_hw_counters) {
+        read_counters(start_counters_);
+    }
+    start_ns_ = time_in_ns();
+}
+
+void TraceSpan::end() {
+    const long long end_ns = time_in_ns();
+
+    TraceEvent event = {name_, arg_, start_ns_, end_ns, TraceCounters()};
+    if (g_hw_counters) {
+        read_counters(event.counters);
+        event.counters.cycles -= start_counters_.cycles;
+        event.counters.instructions -= start_counters_.instructions;
+        event.counters.llc_misses -= start_counters_.llc_misses;
+    }
+    get_thread_buffer().events.push_back(event);
+}
+
+void trace_start(bool hw_counters) {
+    g_trace_start_ns = time_in_ns();
+    if (hw_counters && !g_hw_counters) {
+        g_hw_counters = open_counters();
+        if (!g_hw_counters) {
+            fprintf(stderr, "Warning: the hardware counters are not available (see /proc/sys/kernel/perf_event_paranoid)\n");
+        }
+    }
+    // The buffer of this thread is allocated now, rather than in the first span
+    get_thread_buffer();
+    detail::g_trace_enabled = true;
+}
+
+bool trace_write_json(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        fprintf(stderr, "ERROR: Cannot write the trace to %s\n", path.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_buffers_mutex);
+
+    // Complete events ("X"), with the timestamps in microseconds
+    char line[512];
+    bool first = true;
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+    for (const auto& buffer : g_buffers) {
+        for (const auto& event : buffer->events) {
+            snprintf(line, sizeof(line), "%s{\"name\": \"%s\", \"cat\": \"audiogen\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, \"args\": {",
+                first ? "" : ",\n", event.name, buffer->tid,
+                (event.start_ns - g_trace_start_ns) / 1000.0, (event.end_ns - event.start_ns) / 1000.0);
+            out << line;
+            first = false;
+
+            const char* separator = "";
+            if (event.arg >= 0) {
+                out << "\"arg\": " << event.arg;
+                separator = ", ";
+            }
+            if (g_hw_counters) {
+                const double ipc = event.counters.cycles > 0 ? static_cast<double>(event.counters.instructions) / event.counters.cycles : 0.0;
+                snprintf(line, sizeof(line), "%s\"cycles\": %llu, \"instructions\": %llu, \"llc_misses\": %llu, \"ipc\": %.3f",
+                    separator, static_cast<unsigned long long>(event.counters.cycles),
+                    static_cast<unsigned long long>(event.counters.instructions),
+                    static_cast<unsigned long long>(event.counters.llc_misses), ipc);
+                out << line;
+            }
+            out << "}}";
+        }
+    }
+    out << "\n]}\n";
+    return !out.fail();
+}
+
+void trace_print_summary() {
+    struct Stats {
+        size_t count = 0;
+        double sum_us = 0.0;
+        double sum_sq_us = 0.0;
+        double min_us = INFINITY;
+        double max_us = 0.0;
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;
+        uint64_t llc_misses = 0;
+    };
+
+    std::lock_guard<std::mutex> lock(g_buffers_mutex);
+
+    // Sorted by name, so that the output is stable
+    std::map<std::string, Stats> stats;
+    for (const auto& buffer : g_buffers) {
+        for (const auto& event : buffer->events) {
+            Stats& s = stats[event.name];
+            const double us = (event.end_ns - event.start_ns) / 1000.0;
+            s.count++;
+            s.sum_us += us;
+            s.sum_sq_us += us * us;
+            s.min_us = std::min(s.min_us, us);
+            s.max_us = std::max(s.max_us, us);
+            s.cycles += event.counters.cycles;
+            s.instructions += event.counters.instructions;
+            s.llc_misses += event.counters.llc_misses;
+        }
+    }
+
+    fprintf(stderr, "%-20s %6s %12s %12s %12s %10s", "span", "count", "mean (us)", "min (us)", "max (us)", "stddev");
+    fprintf(stderr, g_hw_counters ? " %6s %14s\n" : "\n", "IPC", "LLC misses");
+    for (const auto& entry : stats) {
+        const Stats& s = entry.second;
+        const double mean = s.sum_us / s.count;
+        const double stddev = std::sqrt(std::max(0.0, s.sum_sq_us / s.count - mean * mean));
+        fprintf(stderr, "%-20s %6zu %12.1f %12.1f %12.1f %10.1f", entry.first.c_str(), s.count, mean, s.min_us, s.max_us, stddev);
+        if (g_hw_counters) {
+            const double ipc = s.cycles > 0 ? static_cast<double>(s.instructions) / s.cycles : 0.0;
+            fprintf(stderr, " %6.2f %14llu\n", ipc, static_cast<unsigned long long>(s.llc_misses));
+        } else {
+            fprintf(stderr, "\n");
+        }
+    }
+}
+
+} // namespace audiogen
@@ -0,0 +1,93 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace audiogen {
+
+// -- Hot-path tracing
+// Spans with a nanosecond resolution around the stages of a generation (tokenization, each DiT
+// invoke, the sampler, the noise, the copies, the audio I/O), optionally with the hardware
+// counters of the process. Disabled by default: a span then costs a relaxed load and a branch.
+
+// Start recording the spans. With hw_counters, the cycles, instructions and last level cache
+// misses are read at both ends of every span (Linux only, subject to perf_event_paranoid).
+// The counters cover the threads existing at this point, so call it once the models are loaded,
+// for the thread pools of the delegates to be counted as well.
+void trace_start(bool hw_counters);
+
+// Write the spans recorded so far in the Chrome trace event format (chrome://tracing or Perfetto)
+bool trace_write_json(const std::string& path);
+
+// Print the count, mean, min, max and standard deviation of the spans, per name
+void trace_print_summary();
+
+namespace detail {
+extern std::atomic<bool> g_trace_enabled;
+}
+
+inline bool trace_enabled() {
+    return detail::g_trace_enabled.load(std::memory_order_relaxed);
+}
+
+struct TraceCounters {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t llc_misses = 0;
+};
+
+// Records the time (and the counters) between its construction and its destruction.
+// The name must be a string literal, it is not copied.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, int64_t arg = -1) {
+        if (trace_enabled()) {
+            begin(name, arg);
+        }
+    }
+
+    ~TraceSpan() {
+        if (name_ != nullptr) {
+            end();
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    void begin(const char* name, int64_t arg);
+    void end();
+
+    const char* name_ = nullptr;
+    int64_t arg_ = -1;
+    long long start_ns_ = 0;
+    TraceCounters start_counters_;
+};
+
+#define AUDIOGEN_TRACE_CONCAT_IMPL(a, b) a##b
+#define AUDIOGEN_TRACE_CONCAT(a, b) AUDIOGEN_TRACE_CONCAT_IMPL(a, b)
+
+// Trace the rest of the scope, e.g. AUDIOGEN_TRACE("dit_invoke") or AUDIOGEN_TRACE("dit_step", step)
+#define AUDIOGEN_TRACE(...) ::audiogen::TraceSpan AUDIOGEN_TRACE_CONCAT(trace_span_, __LINE__)(__VA_ARGS__)
+
+} // namespace audiogen
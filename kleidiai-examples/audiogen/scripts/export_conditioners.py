@@ -235,33 +235,42 @@ def export_conditioners(args) -> None:
     # Load the conditioners and the t5 model
     conditioners = get_conditioners_module(model=model)
     conditioners = conditioners.to(dtype).eval().requires_grad_(False)
-    conditioners_example_input = get_conditioners_example_input(
-        seq_length=128, seconds_total=10.0
-    )
-    # Export the conditioners first to ONNX
-    logging.info("Starting Conditioners export to ONNX...\n")
-    onnx_model_path = convert_conditioners_to_onnx(
-        conditioners,
-        conditioners_example_input,
-        output_path="./conditioners.onnx",
-    )
-    logging.info(
-        "Conditioners in ONNX format has been saved to %s/conditioners.onnx",
-        onnx_model_path,
-    )
-    logging.info("Starting ONNX to LiteRT conversion...\n")
-    # Convert the ONNX model to LiteRT format - Use command line for faster conversion
-    onnx2tf_command = [
-        "onnx2tf",
-        "-i",
-        str(onnx_model_path),
-        "-o",
-        "./conditioners_tflite",
-    ]
-    # Call the command line tool
-    subprocess.run(onnx2tf_command, check=True)
+
+    # The full-length model, then one model per token-length bucket. The app runs the shortest
+    # one the prompt fits in. The outputs of a bucket shorter than 64 tokens have fewer T5 rows,
+    # the app zero-fills the missing ones as the padding of the full-length model.
+    exports = [("conditioners", 128)]
+    exports += [(f"conditioners_L{seq_length}", seq_length) for seq_length in args.t5_buckets]
+
+    for name, seq_length in exports:
+        conditioners_example_input = get_conditioners_example_input(
+            seq_length=seq_length, seconds_total=10.0
+        )
+        # Export the conditioners first to ONNX
+        logging.info("Starting Conditioners export to ONNX (%d tokens)...\n", seq_length)
+        onnx_model_path = convert_conditioners_to_onnx(
+            conditioners,
+            conditioners_example_input,
+            output_path=f"./{name}.onnx",
+        )
+        logging.info(
+            "Conditioners in ONNX format has been saved to %s",
+            onnx_model_path,
+        )
+        logging.info("Starting ONNX to LiteRT conversion...\n")
+        # Convert the ONNX model to LiteRT format - Use command line for faster conversion.
+        # The models are named after the ONNX model, e.g. conditioners_L16_float32.tflite
+        onnx2tf_command = [
+            "onnx2tf",
+            "-i",
+            str(onnx_model_path),
+            "-o",
+            "./conditioners_tflite",
+        ]
+        # Call the command line tool
+        subprocess.run(onnx2tf_command, check=True)
     logging.info(
-        "Conditioners in LiteRT format has been saved to %s/conditioners_tflite",
+        "Conditioners in LiteRT format have been saved to ./conditioners_tflite",
     )
 
 
@@ -282,6 +291,14 @@ def main():
         help="Path to the model checkpoint file.",
         required=True,
     )
+    parser.add_argument(
+        "--t5_buckets",
+        type=int,
+        nargs="*",
+        choices=[8, 16, 32, 64],
+        default=[],
+        help="Also export the conditioners for prompts of at most these numbers of tokens.",
+    )
     export_conditioners(parser.parse_args())
 
 